@@ -29,9 +29,21 @@
 #include "audio/audiostream.h"
 #include "audio/timestamp.h"
 
+#include "common/atomic.h"
+
+#if defined(__SSE2__) && !defined(OUTPUT_UNSIGNED_AUDIO)
+#include <emmintrin.h>
+#define MIXER_CLAMP_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(OUTPUT_UNSIGNED_AUDIO)
+#include <arm_neon.h>
+#define MIXER_CLAMP_NEON
+#endif
 
 namespace Audio {
 
+/** Handle value of the free slots of the channel table. */
+static const uint32 kNoHandle = 0xFFFFFFFF;
+
 #pragma mark -
 #pragma mark --- Channel classes ---
 #pragma mark -
@@ -46,7 +58,8 @@ public:
 	~Channel();
 
 	/**
-	 * Mixes the channel's samples into the given buffer.
+	 * Mixes the channel's samples into the given buffer, either clamping
+	 * them to int16 samples, or adding them to int32 sums unclamped.
 	 *
 	 * @param data buffer where to mix the data
 	 * @param len  number of sample *pairs*. So a value of
@@ -54,7 +67,8 @@ public:
 	 *             16 bits, for a total of 40 bytes.
 	 * @return number of sample pairs processed (which can still be silence!)
 	 */
-	int mix(int16 *data, uint len);
+	template<class Sample>
+	int mix(Sample *data, uint len);
 
 	/**
 	 * Queries whether the channel is still playing or not.
@@ -157,6 +171,13 @@ private:
 
 	Mixer *_mixer;
 
+	// The audio thread updates the time of the channel, which the callers
+	// read through getElapsedTime(). _timeSeq is odd during an update, and
+	// changes with each of them.
+	volatile uint32 _timeSeq;
+	void beginTimeUpdate() { Common::atomicIncrement(&_timeSeq); }
+	void endTimeUpdate() { Common::atomicIncrement(&_timeSeq); }
+
 	uint32 _samplesConsumed;
 	uint32 _samplesDecoded;
 	uint32 _mixerTimeStamp;
@@ -173,24 +194,39 @@ private:
 #pragma mark -
 
 
+void Mixer::setChannelVolumes(const ChannelVolume *volumes, uint count) {
+	for (uint i = 0; i < count; i++) {
+		setChannelVolume(volumes[i].handle, volumes[i].volume);
+		setChannelBalance(volumes[i].handle, volumes[i].balance);
+	}
+}
+
 MixerImpl::MixerImpl(OSystem *system, uint sampleRate)
-	: _syst(system), _mutex(), _sampleRate(sampleRate), _mixerReady(false), _handleSeed(0), _soundTypeSettings() {
+	: _syst(system), _mutex(), _sampleRate(sampleRate), _mixerReady(false), _handleSeed(0), _soundTypeSettings(),
+	  _commandHead(0), _commandTail(0), _hasPendingCommands(0), _callbackCount(0), _accumulate(true), _mixBuffer(0), _mixBufferSize(0) {
 
 	assert(sampleRate > 0);
 
-	for (int i = 0; i != NUM_CHANNELS; i++)
-		_channels[i] = 0;
+	for (int i = 0; i != NUM_CHANNELS; i++) {
+		_channels[i].channel = 0;
+		_channels[i].handle = kNoHandle;
+	}
 }
 
 MixerImpl::~MixerImpl() {
 	for (int i = 0; i != NUM_CHANNELS; i++)
-		delete _channels[i];
+		delete _channels[i].channel;
+	delete[] _mixBuffer;
 }
 
 void MixerImpl::setReady(bool ready) {
 	_mixerReady = ready;
 }
 
+void MixerImpl::setAccumulate(bool accumulate) {
+	Common::atomicStore(&_accumulate, accumulate);
+}
+
 uint MixerImpl::getOutputRate() const {
 	return _sampleRate;
 }
@@ -198,7 +234,7 @@ uint MixerImpl::getOutputRate() const {
 void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
 	int index = -1;
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] == 0) {
+		if (_channels[i].channel == 0) {
 			index = i;
 			break;
 		}
@@ -209,17 +245,154 @@ void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
 		return;
 	}
 
-	_channels[index] = chan;
-
 	SoundHandle chanHandle;
 	chanHandle._val = index + (_handleSeed * NUM_CHANNELS);
 
 	chan->setHandle(chanHandle);
 	_handleSeed++;
+
+	ChannelSlot &slot = _channels[index];
+	slot.permanent = chan->isPermanent();
+	slot.volume = chan->getVolume();
+	slot.balance = chan->getBalance();
+	Common::atomicStore(&slot.id, (uint32)chan->getId());
+	Common::atomicStore(&slot.type, (uint32)chan->getType());
+
+	// Publish the channel only once it is complete, and its handle last
+	Common::atomicStore(&slot.channel, chan);
+	Common::atomicStore(&slot.handle, chanHandle._val);
+
 	if (handle)
 		*handle = chanHandle;
 }
 
+int MixerImpl::findChannel(SoundHandle handle) const {
+	const int index = handle._val % NUM_CHANNELS;
+	if (!_channels[index].channel || _channels[index].handle != handle._val)
+		return -1;
+	return index;
+}
+
+Channel *MixerImpl::detachChannel(int index) {
+	ChannelSlot &slot = _channels[index];
+	Channel *chan = slot.channel;
+	Common::atomicStore(&slot.handle, kNoHandle);
+	Common::atomicStore(&slot.channel, (Channel *)0);
+	return chan;
+}
+
+void MixerImpl::waitForCallback() {
+	// A callback which started before the channels were detached may still
+	// be mixing them, but the next ones will not see them any more
+	const uint32 count = Common::atomicLoad(&_callbackCount);
+	if (count & 1) {
+		while (Common::atomicLoad(&_callbackCount) == count)
+			_syst->delayMillis(1);
+	}
+}
+
+void MixerImpl::deleteChannels(Channel **chans, uint count) {
+	if (!count)
+		return;
+
+	waitForCallback();
+	for (uint i = 0; i < count; i++)
+		delete chans[i];
+}
+
+void MixerImpl::collectFinishedChannels() {
+	Channel *finished[NUM_CHANNELS];
+	uint count = 0;
+	for (int i = 0; i != NUM_CHANNELS; i++) {
+		if (_channels[i].channel && Common::atomicLoad(&_channels[i].handle) == kNoHandle)
+			finished[count++] = detachChannel(i);
+	}
+	deleteChannels(finished, count);
+}
+
+void MixerImpl::pushCommand(CommandType type, uint32 handle, int value) {
+	Command cmd;
+	cmd.type = type;
+	cmd.handle = handle;
+	cmd.value = value;
+
+	// Keep the commands in order behind those which are still waiting
+	flushPendingCommands();
+	const uint32 head = _commandHead;
+	if (!_pendingCommands.empty() || head - Common::atomicLoad(&_commandTail) == COMMAND_QUEUE_SIZE) {
+		// The audio thread is falling behind, or is not running at all
+		_pendingCommands.push(cmd);
+		Common::atomicStore(&_hasPendingCommands, 1);
+		return;
+	}
+
+	_commands[head & (COMMAND_QUEUE_SIZE - 1)] = cmd;
+	Common::atomicStore(&_commandHead, head + 1);
+}
+
+void MixerImpl::flushPendingCommands() {
+	uint32 head = _commandHead;
+	const uint32 tail = Common::atomicLoad(&_commandTail);
+	if (_pendingCommands.empty() || head - tail == COMMAND_QUEUE_SIZE)
+		return;
+
+	while (!_pendingCommands.empty() && head - tail != COMMAND_QUEUE_SIZE) {
+		_commands[head & (COMMAND_QUEUE_SIZE - 1)] = _pendingCommands.pop();
+		head++;
+	}
+	Common::atomicStore(&_commandHead, head);
+	Common::atomicStore(&_hasPendingCommands, !_pendingCommands.empty());
+}
+
+void MixerImpl::retryPendingCommands() {
+	// The status queries are polled by the engines, so the commands which
+	// did not fit get through once the audio thread catches up, even if no
+	// other command follows them
+	if (Common::atomicLoad(&_hasPendingCommands)) {
+		Common::StackLock lock(_mutex);
+		flushPendingCommands();
+	}
+}
+
+void MixerImpl::runCommands() {
+	const uint32 head = Common::atomicLoad(&_commandHead);
+	uint32 tail = _commandTail;
+
+	for (; tail != head; tail++) {
+		const Command &cmd = _commands[tail & (COMMAND_QUEUE_SIZE - 1)];
+
+		if (cmd.type == kCommandUpdateVolumes) {
+			for (int i = 0; i != NUM_CHANNELS; i++) {
+				Channel *chan = Common::atomicLoad(&_channels[i].channel);
+				if (chan && chan->getType() == cmd.value)
+					chan->notifyGlobalVolChange();
+			}
+			continue;
+		}
+
+		// Ignore the commands for sounds which were stopped since
+		Channel *chan = Common::atomicLoad(&_channels[cmd.handle % NUM_CHANNELS].channel);
+		if (!chan || chan->getHandle()._val != cmd.handle)
+			continue;
+
+		switch (cmd.type) {
+		case kCommandVolume:
+			chan->setVolume(cmd.value);
+			break;
+		case kCommandBalance:
+			chan->setBalance(cmd.value);
+			break;
+		case kCommandPause:
+			chan->pause(cmd.value != 0);
+			break;
+		default:
+			break;
+		}
+	}
+
+	Common::atomicStore(&_commandTail, tail);
+}
+
 void MixerImpl::playStream(
 			SoundType type,
 			SoundHandle *handle,
@@ -238,10 +411,13 @@ void MixerImpl::playStream(
 
 	assert(_mixerReady);
 
+	flushPendingCommands();
+	collectFinishedChannels();
+
 	// Prevent duplicate sounds
 	if (id != -1) {
 		for (int i = 0; i != NUM_CHANNELS; i++)
-			if (_channels[i] != 0 && _channels[i]->getId() == id) {
+			if (_channels[i].channel != 0 && (int)_channels[i].id == id) {
 				// Delete the stream if were asked to auto-dispose it.
 				// Note: This could cause trouble if the client code does not
 				// yet expect the stream to be gone. The primary example to
@@ -265,10 +441,40 @@ void MixerImpl::playStream(
 	insertChannel(handle, chan);
 }
 
+/**
+ * Clamps the 32 bit sums of the channels into the 16 bit output.
+ */
+static void clampMix(const int32 *in, int16 *out, uint count) {
+	uint i = 0;
+#if defined(MIXER_CLAMP_SSE2)
+	for (; i + 8 <= count; i += 8) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(in + i + 4));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+	}
+#elif defined(MIXER_CLAMP_NEON)
+	for (; i + 8 <= count; i += 8) {
+		int16x4_t lo = vqmovn_s32(vld1q_s32(in + i));
+		int16x4_t hi = vqmovn_s32(vld1q_s32(in + i + 4));
+		vst1q_s16(out + i, vcombine_s16(lo, hi));
+	}
+#endif
+	for (; i < count; i++) {
+		const int16 val = CLIP<int32>(in[i], ST_SAMPLE_MIN, ST_SAMPLE_MAX);
+#ifdef OUTPUT_UNSIGNED_AUDIO
+		out[i] = val ^ 0x8000;
+#else
+		out[i] = val;
+#endif
+	}
+}
+
 int MixerImpl::mixCallback(byte *samples, uint len) {
 	assert(samples);
 
-	Common::StackLock lock(_mutex);
+	// No lock here: the callers only reach the channels through the command
+	// queue, and wait for an odd count to change before deleting one
+	Common::atomicIncrement(&_callbackCount);
 
 	int16 *buf = (int16 *)samples;
 	// we store stereo, 16-bit samples
@@ -278,67 +484,94 @@ int MixerImpl::mixCallback(byte *samples, uint len) {
 	// Since the mixer callback has been called, the mixer must be ready...
 	_mixerReady = true;
 
-	//  zero the buf
-	memset(buf, 0, 2 * len * sizeof(int16));
+	runCommands();
+
+	// The channels are summed in 32 bits and clamped at the end, if enabled
+	int32 *sum = 0;
+	if (Common::atomicLoad(&_accumulate)) {
+		if (_mixBufferSize < 2 * len) {
+			delete[] _mixBuffer;
+			_mixBuffer = new int32[2 * len];
+			_mixBufferSize = 2 * len;
+		}
+		sum = _mixBuffer;
+		memset(sum, 0, 2 * len * sizeof(int32));
+	} else {
+		//  zero the buf
+		memset(buf, 0, 2 * len * sizeof(int16));
+	}
 
 	// mix all channels
 	int res = 0, tmp;
-	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i]) {
-			if (_channels[i]->isFinished()) {
-				delete _channels[i];
-				_channels[i] = 0;
-			} else if (!_channels[i]->isPaused()) {
-				tmp = _channels[i]->mix(buf, len);
-
-				if (tmp > res)
-					res = tmp;
-			}
+	for (int i = 0; i != NUM_CHANNELS; i++) {
+		if (Common::atomicLoad(&_channels[i].handle) == kNoHandle)
+			continue;
+		Channel *chan = Common::atomicLoad(&_channels[i].channel);
+		if (!chan)
+			continue;
+
+		if (chan->isFinished()) {
+			// The next caller of the mixer deletes it
+			Common::atomicStore(&_channels[i].handle, kNoHandle);
+		} else if (!chan->isPaused()) {
+			if (sum)
+				tmp = chan->mix(sum, len);
+			else
+				tmp = chan->mix(buf, len);
+
+			if (tmp > res)
+				res = tmp;
 		}
+	}
+
+	if (sum)
+		clampMix(sum, buf, 2 * len);
+
+	Common::atomicIncrement(&_callbackCount);
 
 	return res;
 }
 
 void MixerImpl::stopAll() {
 	Common::StackLock lock(_mutex);
+	Channel *stopped[NUM_CHANNELS];
+	uint count = 0;
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && !_channels[i]->isPermanent()) {
-			delete _channels[i];
-			_channels[i] = 0;
-		}
+		if (_channels[i].channel != 0 && !_channels[i].permanent)
+			stopped[count++] = detachChannel(i);
 	}
+	deleteChannels(stopped, count);
 }
 
 void MixerImpl::stopID(int id) {
 	Common::StackLock lock(_mutex);
+	Channel *stopped[NUM_CHANNELS];
+	uint count = 0;
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && _channels[i]->getId() == id) {
-			delete _channels[i];
-			_channels[i] = 0;
-		}
+		if (_channels[i].channel != 0 && (int)_channels[i].id == id)
+			stopped[count++] = detachChannel(i);
 	}
+	deleteChannels(stopped, count);
 }
 
 void MixerImpl::stopHandle(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
 
 	// Simply ignore stop requests for handles of sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findChannel(handle);
+	if (index == -1)
 		return;
 
-	delete _channels[index];
-	_channels[index] = 0;
+	Channel *chan = detachChannel(index);
+	deleteChannels(&chan, 1);
 }
 
 void MixerImpl::muteSoundType(SoundType type, bool mute) {
 	assert(0 <= type && type < ARRAYSIZE(_soundTypeSettings));
-	_soundTypeSettings[type].mute = mute;
 
-	for (int i = 0; i != NUM_CHANNELS; ++i) {
-		if (_channels[i] && _channels[i]->getType() == type)
-			_channels[i]->notifyGlobalVolChange();
-	}
+	Common::StackLock lock(_mutex);
+	_soundTypeSettings[type].mute = mute;
+	pushCommand(kCommandUpdateVolumes, kNoHandle, type);
 }
 
 bool MixerImpl::isSoundTypeMuted(SoundType type) const {
@@ -349,37 +582,58 @@ bool MixerImpl::isSoundTypeMuted(SoundType type) const {
 void MixerImpl::setChannelVolume(SoundHandle handle, byte volume) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findChannel(handle);
+	if (index == -1)
 		return;
 
-	_channels[index]->setVolume(volume);
+	_channels[index].volume = volume;
+	pushCommand(kCommandVolume, handle._val, volume);
 }
 
 byte MixerImpl::getChannelVolume(SoundHandle handle) {
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	Common::StackLock lock(_mutex);
+
+	const int index = findChannel(handle);
+	if (index == -1)
 		return 0;
 
-	return _channels[index]->getVolume();
+	return _channels[index].volume;
 }
 
 void MixerImpl::setChannelBalance(SoundHandle handle, int8 balance) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findChannel(handle);
+	if (index == -1)
 		return;
 
-	_channels[index]->setBalance(balance);
+	_channels[index].balance = balance;
+	pushCommand(kCommandBalance, handle._val, balance);
 }
 
 int8 MixerImpl::getChannelBalance(SoundHandle handle) {
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	Common::StackLock lock(_mutex);
+
+	const int index = findChannel(handle);
+	if (index == -1)
 		return 0;
 
-	return _channels[index]->getBalance();
+	return _channels[index].balance;
+}
+
+void MixerImpl::setChannelVolumes(const ChannelVolume *volumes, uint count) {
+	Common::StackLock lock(_mutex);
+
+	for (uint i = 0; i < count; i++) {
+		const int index = findChannel(volumes[i].handle);
+		if (index == -1)
+			continue;
+
+		_channels[index].volume = volumes[i].volume;
+		_channels[index].balance = volumes[i].balance;
+		pushCommand(kCommandVolume, volumes[i].handle._val, volumes[i].volume);
+		pushCommand(kCommandBalance, volumes[i].handle._val, volumes[i].balance);
+	}
 }
 
 uint32 MixerImpl::getSoundElapsedTime(SoundHandle handle) {
@@ -389,27 +643,27 @@ uint32 MixerImpl::getSoundElapsedTime(SoundHandle handle) {
 Timestamp MixerImpl::getElapsedTime(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	flushPendingCommands();
+	const int index = findChannel(handle);
+	if (index == -1)
 		return Timestamp(0, _sampleRate);
 
-	return _channels[index]->getElapsedTime();
+	return _channels[index].channel->getElapsedTime();
 }
 
 void MixerImpl::pauseAll(bool paused) {
 	Common::StackLock lock(_mutex);
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0) {
-			_channels[i]->pause(paused);
-		}
+		if (_channels[i].channel != 0 && _channels[i].handle != kNoHandle)
+			pushCommand(kCommandPause, _channels[i].handle, paused);
 	}
 }
 
 void MixerImpl::pauseID(int id, bool paused) {
 	Common::StackLock lock(_mutex);
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && _channels[i]->getId() == id) {
-			_channels[i]->pause(paused);
+		if (_channels[i].channel != 0 && _channels[i].handle != kNoHandle && (int)_channels[i].id == id) {
+			pushCommand(kCommandPause, _channels[i].handle, paused);
 			return;
 		}
 	}
@@ -419,40 +673,54 @@ void MixerImpl::pauseHandle(SoundHandle handle, bool paused) {
 	Common::StackLock lock(_mutex);
 
 	// Simply ignore (un)pause requests for sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	if (findChannel(handle) == -1)
 		return;
 
-	_channels[index]->pause(paused);
+	pushCommand(kCommandPause, handle._val, paused);
 }
 
+/*
+ * The status queries below read the channel table without locking. A slot
+ * gets its id and type before its handle, so they belong to the handle
+ * read before them if it is unchanged after them.
+ */
+
 bool MixerImpl::isSoundIDActive(int id) {
-	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i] && _channels[i]->getId() == id)
+	retryPendingCommands();
+	for (int i = 0; i != NUM_CHANNELS; i++) {
+		const uint32 val = Common::atomicLoad(&_channels[i].handle);
+		if (val != kNoHandle && (int)Common::atomicLoad(&_channels[i].id) == id &&
+				Common::atomicLoad(&_channels[i].handle) == val)
 			return true;
+	}
 	return false;
 }
 
 int MixerImpl::getSoundID(SoundHandle handle) {
-	Common::StackLock lock(_mutex);
+	retryPendingCommands();
 	const int index = handle._val % NUM_CHANNELS;
-	if (_channels[index] && _channels[index]->getHandle()._val == handle._val)
-		return _channels[index]->getId();
+	if (Common::atomicLoad(&_channels[index].handle) == handle._val) {
+		const int id = Common::atomicLoad(&_channels[index].id);
+		if (Common::atomicLoad(&_channels[index].handle) == handle._val)
+			return id;
+	}
 	return 0;
 }
 
 bool MixerImpl::isSoundHandleActive(SoundHandle handle) {
-	Common::StackLock lock(_mutex);
+	retryPendingCommands();
 	const int index = handle._val % NUM_CHANNELS;
-	return _channels[index] && _channels[index]->getHandle()._val == handle._val;
+	return Common::atomicLoad(&_channels[index].handle) == handle._val;
 }
 
 bool MixerImpl::hasActiveChannelOfType(SoundType type) {
-	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i] && _channels[i]->getType() == type)
+	retryPendingCommands();
+	for (int i = 0; i != NUM_CHANNELS; i++) {
+		const uint32 val = Common::atomicLoad(&_channels[i].handle);
+		if (val != kNoHandle && Common::atomicLoad(&_channels[i].type) == (uint32)type &&
+				Common::atomicLoad(&_channels[i].handle) == val)
 			return true;
+	}
 	return false;
 }
 
@@ -470,11 +738,7 @@ void MixerImpl::setVolumeForSoundType(SoundType type, int volume) {
 
 	Common::StackLock lock(_mutex);
 	_soundTypeSettings[type].volume = volume;
-
-	for (int i = 0; i != NUM_CHANNELS; ++i) {
-		if (_channels[i] && _channels[i]->getType() == type)
-			_channels[i]->notifyGlobalVolChange();
-	}
+	pushCommand(kCommandUpdateVolumes, kNoHandle, type);
 }
 
 int MixerImpl::getVolumeForSoundType(SoundType type) const {
@@ -491,7 +755,7 @@ int MixerImpl::getVolumeForSoundType(SoundType type) const {
 Channel::Channel(Mixer *mixer, Mixer::SoundType type, AudioStream *stream,
                  DisposeAfterUse::Flag autofreeStream, bool reverseStereo, int id, bool permanent)
     : _type(type), _mixer(mixer), _id(id), _permanent(permanent), _volume(Mixer::kMaxChannelVolume),
-      _balance(0), _pauseLevel(0), _samplesConsumed(0), _samplesDecoded(0), _mixerTimeStamp(0),
+      _balance(0), _pauseLevel(0), _timeSeq(0), _samplesConsumed(0), _samplesDecoded(0), _mixerTimeStamp(0),
       _pauseStartTime(0), _pauseTime(0), _autofreeStream(autofreeStream), _converter(0),
       _stream(stream) {
 	assert(mixer);
@@ -555,6 +819,7 @@ void Channel::updateChannelVolumes() {
 void Channel::pause(bool paused) {
 	//assert((paused && _pauseLevel >= 0) || (!paused && _pauseLevel));
 
+	beginTimeUpdate();
 	if (paused) {
 		_pauseLevel++;
 
@@ -568,6 +833,7 @@ void Channel::pause(bool paused) {
 			_pauseStartTime = 0;
 		}
 	}
+	endTimeUpdate();
 }
 
 Timestamp Channel::getElapsedTime() {
@@ -576,17 +842,29 @@ Timestamp Channel::getElapsedTime() {
 
 	Audio::Timestamp ts(0, rate);
 
-	if (_mixerTimeStamp == 0)
+	// Take a consistent copy of the time, retrying if it changed meanwhile
+	uint32 seq, samplesConsumed, mixerTimeStamp, pauseStartTime, pauseTime;
+	bool paused;
+	do {
+		seq = Common::atomicLoad(&_timeSeq);
+		samplesConsumed = _samplesConsumed;
+		mixerTimeStamp = _mixerTimeStamp;
+		pauseStartTime = _pauseStartTime;
+		pauseTime = _pauseTime;
+		paused = isPaused();
+	} while ((seq & 1) || Common::atomicLoad(&_timeSeq) != seq);
+
+	if (mixerTimeStamp == 0)
 		return ts;
 
-	if (isPaused())
-		delta = _pauseStartTime - _mixerTimeStamp;
+	if (paused)
+		delta = pauseStartTime - mixerTimeStamp;
 	else
-		delta = g_system->getMillis() - _mixerTimeStamp - _pauseTime;
+		delta = g_system->getMillis() - mixerTimeStamp - pauseTime;
 
 	// Convert the number of samples into a time duration.
 
-	ts = ts.addFrames(_samplesConsumed);
+	ts = ts.addFrames(samplesConsumed);
 	ts = ts.addMsecs(delta);
 
 	// In theory it would seem like a good idea to limit the approximation
@@ -598,7 +876,16 @@ Timestamp Channel::getElapsedTime() {
 	return ts;
 }
 
-int Channel::mix(int16 *data, uint len) {
+static int flowInto(RateConverter &converter, AudioStream &stream, int16 *data, uint len, st_volume_t volL, st_volume_t volR) {
+	return converter.flow(stream, data, len, volL, volR);
+}
+
+static int flowInto(RateConverter &converter, AudioStream &stream, int32 *data, uint len, st_volume_t volL, st_volume_t volR) {
+	return converter.flowAccumulate(stream, data, len, volL, volR);
+}
+
+template<class Sample>
+int Channel::mix(Sample *data, uint len) {
 	assert(_stream);
 
 	int res = 0;
@@ -607,10 +894,12 @@ int Channel::mix(int16 *data, uint len) {
 		// TODO: call drain method
 	} else {
 		assert(_converter);
+		beginTimeUpdate();
 		_samplesConsumed = _samplesDecoded;
 		_mixerTimeStamp = g_system->getMillis();
 		_pauseTime = 0;
-		res = _converter->flow(*_stream, data, len, _volL, _volR);
+		endTimeUpdate();
+		res = flowInto(*_converter, *_stream, data, len, _volL, _volR);
 		_samplesDecoded += res;
 	}
 
@@ -235,6 +235,25 @@ public:
 	 */
 	virtual int8 getChannelBalance(SoundHandle handle) = 0;
 
+	/**
+	 * The volume and balance of a channel, see setChannelVolumes().
+	 */
+	struct ChannelVolume {
+		SoundHandle handle;
+		byte volume;
+		int8 balance;
+	};
+
+	/**
+	 * Set the volume and balance of several channels at once. This is the
+	 * same as calling setChannelVolume() and setChannelBalance() for each of
+	 * them, but the mixer may do it in one go.
+	 *
+	 * @param volumes the channels to affect and their new settings
+	 * @param count the number of entries in volumes
+	 */
+	virtual void setChannelVolumes(const ChannelVolume *volumes, uint count);
+
 	/**
 	 * Get approximation of for how long the channel has been playing.
 	 */
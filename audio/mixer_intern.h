@@ -25,6 +25,7 @@
 
 #include "common/scummsys.h"
 #include "common/mutex.h"
+#include "common/queue.h"
 #include "audio/mixer.h"
 
 namespace Audio {
@@ -51,11 +52,50 @@ namespace Audio {
 class MixerImpl : public Mixer {
 private:
 	enum {
-		NUM_CHANNELS = 32
+		NUM_CHANNELS = 32,
+		COMMAND_QUEUE_SIZE = 256	// must be a power of two
+	};
+
+	enum CommandType {
+		kCommandVolume,
+		kCommandBalance,
+		kCommandPause,
+		kCommandUpdateVolumes
+	};
+
+	/**
+	 * A change to a channel, applied by the audio thread before mixing.
+	 * kCommandUpdateVolumes applies to all the channels whose sound type
+	 * is value, and ignores the handle.
+	 */
+	struct Command {
+		CommandType type;
+		uint32 handle;
+		int value;
+	};
+
+	/**
+	 * An entry of the channel table, which the audio thread reads without
+	 * locking. Only the callers of the mixer, serialized by _mutex, fill and
+	 * clear the slots: the audio thread mixes the channels, and merely frees
+	 * the handle of those which finished. Their Channel is deleted by the
+	 * next caller, once no callback can be mixing it any more.
+	 *
+	 * handle, id and type can be read without _mutex, for status queries;
+	 * the rest is owned by the callers.
+	 */
+	struct ChannelSlot {
+		Channel *volatile channel;
+		volatile uint32 handle;		// 0xFFFFFFFF when no sound is playing
+		volatile uint32 id;
+		volatile uint32 type;
+		bool permanent;
+		byte volume;
+		int8 balance;
 	};
 
 	OSystem *_syst;
-	Common::Mutex _mutex;
+	Common::Mutex _mutex;		// serializes the callers, never taken by mixCallback
 
 	const uint _sampleRate;
 	bool _mixerReady;
@@ -69,8 +109,32 @@ private:
 	};
 
 	SoundTypeSettings _soundTypeSettings[4];
-	Channel *_channels[NUM_CHANNELS];
+	ChannelSlot _channels[NUM_CHANNELS];
+
+	// Single producer, single consumer queue from the callers, holding
+	// _mutex, to the audio thread
+	Command _commands[COMMAND_QUEUE_SIZE];
+	volatile uint32 _commandHead;	// written by the callers
+	volatile uint32 _commandTail;	// written by the audio thread
+	Common::Queue<Command> _pendingCommands;	// which did not fit in the queue
+	volatile uint32 _hasPendingCommands;	// for the queries which do not lock
+
+	volatile uint32 _callbackCount;	// odd while mixCallback is running
+
+	volatile uint32 _accumulate;
+	int32 *_mixBuffer;		// 32 bit sums of the channels, when accumulating
+	uint _mixBufferSize;
 
+	void pushCommand(CommandType type, uint32 handle, int value);
+	void flushPendingCommands();
+	void retryPendingCommands();
+	void runCommands();
+
+	int findChannel(SoundHandle handle) const;
+	Channel *detachChannel(int index);
+	void waitForCallback();
+	void deleteChannels(Channel **chans, uint count);
+	void collectFinishedChannels();
 
 public:
 
@@ -108,6 +172,7 @@ public:
 	virtual byte getChannelVolume(SoundHandle handle);
 	virtual void setChannelBalance(SoundHandle handle, int8 balance);
 	virtual int8 getChannelBalance(SoundHandle handle);
+	virtual void setChannelVolumes(const ChannelVolume *volumes, uint count);
 
 	virtual uint32 getSoundElapsedTime(SoundHandle handle);
 	virtual Timestamp getElapsedTime(SoundHandle handle);
@@ -140,6 +205,14 @@ public:
 	 * their audio system has been completed.
 	 */
 	void setReady(bool ready);
+
+	/**
+	 * Sets whether the channels are summed into 32 bit samples which are
+	 * clamped once per buffer, rather than clamped after each channel.
+	 * Besides being faster, this keeps loud channels from clipping the
+	 * ones mixed after them. Enabled by default.
+	 */
+	void setAccumulate(bool accumulate);
 };
 
 
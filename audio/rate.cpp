@@ -35,6 +35,14 @@
 #include "common/textconsole.h"
 #include "common/util.h"
 
+#if defined(__SSE2__) && !defined(OUTPUT_UNSIGNED_AUDIO)
+#include <emmintrin.h>
+#define RATE_MIX_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(OUTPUT_UNSIGNED_AUDIO)
+#include <arm_neon.h>
+#define RATE_MIX_NEON
+#endif
+
 namespace Audio {
 
 
@@ -47,6 +55,183 @@ namespace Audio {
 #define INTERMEDIATE_BUFFER_SIZE 512
 
 
+#pragma mark --- Volume and mixing ---
+
+
+/*
+ * All the converters first resample a block of frames, and then scale
+ * them by the channel volumes and add them to the output in one pass,
+ * four frames at a time when SSE2 or NEON is available. The vector paths
+ * give exactly the same results as the C one: the volume is divided by
+ * kMaxMixerVolume rounding toward zero, and the sum is saturated.
+ */
+
+static inline void mixSample(st_sample_t &a, st_sample_t s, st_volume_t vol) {
+	clampedAdd(a, (s * (int)vol) / Audio::Mixer::kMaxMixerVolume);
+}
+
+static inline void mixSample(int32 &a, st_sample_t s, st_volume_t vol) {
+	a += (s * (int)vol) / Audio::Mixer::kMaxMixerVolume;
+}
+
+#if defined(RATE_MIX_SSE2)
+
+/**
+ * Scales four frames, mono or stereo, into eight 32 bit samples in output
+ * order. vol holds the volume of each output lane.
+ */
+template<bool stereo, bool reverseStereo>
+static inline void scaleFrames(const st_sample_t *in, __m128i vol, __m128i &lo, __m128i &hi) {
+	__m128i s;
+	if (stereo) {
+		s = _mm_loadu_si128((const __m128i *)in);
+		if (reverseStereo) {
+			s = _mm_shufflelo_epi16(s, _MM_SHUFFLE(2, 3, 0, 1));
+			s = _mm_shufflehi_epi16(s, _MM_SHUFFLE(2, 3, 0, 1));
+		}
+	} else {
+		s = _mm_loadl_epi64((const __m128i *)in);
+		s = _mm_unpacklo_epi16(s, s);
+	}
+
+	__m128i pl = _mm_mullo_epi16(s, vol);
+	__m128i ph = _mm_mulhi_epi16(s, vol);
+	lo = _mm_unpacklo_epi16(pl, ph);
+	hi = _mm_unpackhi_epi16(pl, ph);
+
+	// Divide by kMaxMixerVolume, rounding toward zero
+	lo = _mm_srai_epi32(_mm_add_epi32(lo, _mm_srli_epi32(_mm_srai_epi32(lo, 31), 24)), 8);
+	hi = _mm_srai_epi32(_mm_add_epi32(hi, _mm_srli_epi32(_mm_srai_epi32(hi, 31), 24)), 8);
+}
+
+template<bool reverseStereo>
+static inline __m128i laneVolumes(st_volume_t vol_l, st_volume_t vol_r) {
+	const int16 v0 = reverseStereo ? vol_r : vol_l;
+	const int16 v1 = reverseStereo ? vol_l : vol_r;
+	return _mm_set_epi16(v1, v0, v1, v0, v1, v0, v1, v0);
+}
+
+template<bool stereo, bool reverseStereo>
+static uint mixFramesSIMD(const st_sample_t *in, st_sample_t *obuf, uint n, st_volume_t vol_l, st_volume_t vol_r) {
+	const __m128i vol = laneVolumes<reverseStereo>(vol_l, vol_r);
+	uint i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i lo, hi;
+		scaleFrames<stereo, reverseStereo>(in + i * (stereo ? 2 : 1), vol, lo, hi);
+		__m128i *o = (__m128i *)(obuf + 2 * i);
+		_mm_storeu_si128(o, _mm_adds_epi16(_mm_loadu_si128(o), _mm_packs_epi32(lo, hi)));
+	}
+	return i;
+}
+
+template<bool stereo, bool reverseStereo>
+static uint mixFramesSIMD(const st_sample_t *in, int32 *obuf, uint n, st_volume_t vol_l, st_volume_t vol_r) {
+	const __m128i vol = laneVolumes<reverseStereo>(vol_l, vol_r);
+	uint i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i lo, hi;
+		scaleFrames<stereo, reverseStereo>(in + i * (stereo ? 2 : 1), vol, lo, hi);
+		__m128i *o = (__m128i *)(obuf + 2 * i);
+		_mm_storeu_si128(o, _mm_add_epi32(_mm_loadu_si128(o), lo));
+		_mm_storeu_si128(o + 1, _mm_add_epi32(_mm_loadu_si128(o + 1), hi));
+	}
+	return i;
+}
+
+#elif defined(RATE_MIX_NEON)
+
+static inline int32x4_t scaleLanes(int16x4_t s, int16x4_t vol) {
+	int32x4_t p = vmull_s16(s, vol);
+	// Divide by kMaxMixerVolume, rounding toward zero
+	uint32x4_t bias = vshrq_n_u32(vreinterpretq_u32_s32(vshrq_n_s32(p, 31)), 24);
+	return vshrq_n_s32(vaddq_s32(p, vreinterpretq_s32_u32(bias)), 8);
+}
+
+/**
+ * Scales four frames, mono or stereo, into eight 32 bit samples in output
+ * order. vol holds the volume of each output lane.
+ */
+template<bool stereo, bool reverseStereo>
+static inline void scaleFrames(const st_sample_t *in, int16x8_t vol, int32x4_t &lo, int32x4_t &hi) {
+	int16x8_t s;
+	if (stereo) {
+		s = vld1q_s16(in);
+		if (reverseStereo)
+			s = vrev32q_s16(s);
+	} else {
+		int16x4_t m = vld1_s16(in);
+		int16x4x2_t d = vzip_s16(m, m);
+		s = vcombine_s16(d.val[0], d.val[1]);
+	}
+
+	lo = scaleLanes(vget_low_s16(s), vget_low_s16(vol));
+	hi = scaleLanes(vget_high_s16(s), vget_high_s16(vol));
+}
+
+template<bool reverseStereo>
+static inline int16x8_t laneVolumes(st_volume_t vol_l, st_volume_t vol_r) {
+	const int16 v0 = reverseStereo ? vol_r : vol_l;
+	const int16 v1 = reverseStereo ? vol_l : vol_r;
+	int16x4x2_t d = vzip_s16(vdup_n_s16(v0), vdup_n_s16(v1));
+	return vcombine_s16(d.val[0], d.val[1]);
+}
+
+template<bool stereo, bool reverseStereo>
+static uint mixFramesSIMD(const st_sample_t *in, st_sample_t *obuf, uint n, st_volume_t vol_l, st_volume_t vol_r) {
+	const int16x8_t vol = laneVolumes<reverseStereo>(vol_l, vol_r);
+	uint i = 0;
+	for (; i + 4 <= n; i += 4) {
+		int32x4_t lo, hi;
+		scaleFrames<stereo, reverseStereo>(in + i * (stereo ? 2 : 1), vol, lo, hi);
+		int16_t *o = obuf + 2 * i;
+		vst1q_s16(o, vqaddq_s16(vld1q_s16(o), vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi))));
+	}
+	return i;
+}
+
+template<bool stereo, bool reverseStereo>
+static uint mixFramesSIMD(const st_sample_t *in, int32 *obuf, uint n, st_volume_t vol_l, st_volume_t vol_r) {
+	const int16x8_t vol = laneVolumes<reverseStereo>(vol_l, vol_r);
+	uint i = 0;
+	for (; i + 4 <= n; i += 4) {
+		int32x4_t lo, hi;
+		scaleFrames<stereo, reverseStereo>(in + i * (stereo ? 2 : 1), vol, lo, hi);
+		int32_t *o = obuf + 2 * i;
+		vst1q_s32(o, vaddq_s32(vld1q_s32(o), lo));
+		vst1q_s32(o + 4, vaddq_s32(vld1q_s32(o + 4), hi));
+	}
+	return i;
+}
+
+#endif
+
+/**
+ * Scales n frames of in by the volumes and adds them to the stereo frames
+ * of obuf, clamping them if obuf holds 16 bit samples.
+ */
+template<bool stereo, bool reverseStereo, typename T>
+static void mixFrames(const st_sample_t *in, T *obuf, uint n, st_volume_t vol_l, st_volume_t vol_r) {
+	uint i = 0;
+#if defined(RATE_MIX_SSE2) || defined(RATE_MIX_NEON)
+	i = mixFramesSIMD<stereo, reverseStereo>(in, obuf, n, vol_l, vol_r);
+#endif
+	for (; i < n; i++) {
+		st_sample_t out0, out1;
+		out0 = in[stereo ? 2 * i : i];
+		out1 = (stereo ? in[2 * i + 1] : out0);
+
+		// output left channel
+		mixSample(obuf[2 * i + reverseStereo    ], out0, vol_l);
+
+		// output right channel
+		mixSample(obuf[2 * i + (reverseStereo ^ 1)], out1, vol_r);
+	}
+}
+
+
+#pragma mark -
+
+
 /**
  * Audio rate converter based on simple resampling. Used when no
  * interpolation is required.
@@ -67,9 +252,17 @@ protected:
 	/** fractional position increment in the output stream */
 	long opos_inc;
 
+	template<typename T>
+	int flowInto(AudioStream &input, T *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+
 public:
 	SimpleRateConverter(st_rate_t inrate, st_rate_t outrate);
-	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return flowInto(input, obuf, osamp, vol_l, vol_r);
+	}
+	int flowAccumulate(AudioStream &input, int32 *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return flowInto(input, obuf, osamp, vol_l, vol_r);
+	}
 	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
 		return ST_SUCCESS;
 	}
@@ -102,46 +295,53 @@ SimpleRateConverter<stereo, reverseStereo>::SimpleRateConverter(st_rate_t inrate
  * Return number of sample pairs processed.
  */
 template<bool stereo, bool reverseStereo>
-int SimpleRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
-	st_sample_t *ostart, *oend;
-
-	ostart = obuf;
-	oend = obuf + osamp * 2;
-
-	while (obuf < oend) {
-
-		// read enough input samples so that opos >= 0
-		do {
-			// Check if we have to refill the buffer
-			if (inLen == 0) {
-				inPtr = inBuf;
-				inLen = input.readBuffer(inBuf, ARRAYSIZE(inBuf));
-				if (inLen <= 0)
-					return (obuf - ostart) / 2;
-			}
-			inLen -= (stereo ? 2 : 1);
-			opos--;
-			if (opos >= 0) {
-				inPtr += (stereo ? 2 : 1);
-			}
-		} while (opos >= 0);
-
-		st_sample_t out0, out1;
-		out0 = *inPtr++;
-		out1 = (stereo ? *inPtr++ : out0);
+template<typename T>
+int SimpleRateConverter<stereo, reverseStereo>::flowInto(AudioStream &input, T *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+	const st_size_t blockSize = INTERMEDIATE_BUFFER_SIZE / (stereo ? 2 : 1);
+	st_sample_t block[INTERMEDIATE_BUFFER_SIZE];
+	st_size_t done = 0;
+	bool eof = false;
+
+	while (done < osamp && !eof) {
+		const st_size_t count = MIN(osamp - done, blockSize);
+		st_sample_t *out = block;
+		st_size_t frames = 0;
+
+		while (frames < count) {
+			// read enough input samples so that opos >= 0
+			do {
+				// Check if we have to refill the buffer
+				if (inLen == 0) {
+					inPtr = inBuf;
+					inLen = input.readBuffer(inBuf, ARRAYSIZE(inBuf));
+					if (inLen <= 0) {
+						eof = true;
+						break;
+					}
+				}
+				inLen -= (stereo ? 2 : 1);
+				opos--;
+				if (opos >= 0) {
+					inPtr += (stereo ? 2 : 1);
+				}
+			} while (opos >= 0);
+
+			if (eof)
+				break;
+
+			*out++ = *inPtr++;
+			if (stereo)
+				*out++ = *inPtr++;
 
-		// Increment output position
-		opos += opos_inc;
-
-		// output left channel
-		clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
-
-		// output right channel
-		clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+			// Increment output position
+			opos += opos_inc;
+			frames++;
+		}
 
-		obuf += 2;
+		mixFrames<stereo, reverseStereo>(block, obuf + 2 * done, frames, vol_l, vol_r);
+		done += frames;
 	}
-	return (obuf - ostart) / 2;
+	return done;
 }
 
 /**
@@ -173,9 +373,17 @@ protected:
 	/** current sample(s) in the input stream (left/right channel) */
 	st_sample_t icur0, icur1;
 
+	template<typename T>
+	int flowInto(AudioStream &input, T *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+
 public:
 	LinearRateConverter(st_rate_t inrate, st_rate_t outrate);
-	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return flowInto(input, obuf, osamp, vol_l, vol_r);
+	}
+	int flowAccumulate(AudioStream &input, int32 *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return flowInto(input, obuf, osamp, vol_l, vol_r);
+	}
 	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
 		return ST_SUCCESS;
 	}
@@ -211,56 +419,61 @@ LinearRateConverter<stereo, reverseStereo>::LinearRateConverter(st_rate_t inrate
  * Return number of sample pairs processed.
  */
 template<bool stereo, bool reverseStereo>
-int LinearRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
-	st_sample_t *ostart, *oend;
-
-	ostart = obuf;
-	oend = obuf + osamp * 2;
-
-	while (obuf < oend) {
-
-		// read enough input samples so that opos < 0
-		while ((frac_t)FRAC_ONE <= opos) {
-			// Check if we have to refill the buffer
-			if (inLen == 0) {
-				inPtr = inBuf;
-				inLen = input.readBuffer(inBuf, ARRAYSIZE(inBuf));
-				if (inLen <= 0)
-					return (obuf - ostart) / 2;
-			}
-			inLen -= (stereo ? 2 : 1);
-			ilast0 = icur0;
-			icur0 = *inPtr++;
-			if (stereo) {
-				ilast1 = icur1;
-				icur1 = *inPtr++;
+template<typename T>
+int LinearRateConverter<stereo, reverseStereo>::flowInto(AudioStream &input, T *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+	const st_size_t blockSize = INTERMEDIATE_BUFFER_SIZE / (stereo ? 2 : 1);
+	st_sample_t block[INTERMEDIATE_BUFFER_SIZE];
+	st_size_t done = 0;
+	bool eof = false;
+
+	while (done < osamp && !eof) {
+		const st_size_t count = MIN(osamp - done, blockSize);
+		st_sample_t *out = block;
+		st_size_t frames = 0;
+
+		while (frames < count) {
+			// read enough input samples so that opos < 0
+			while ((frac_t)FRAC_ONE <= opos) {
+				// Check if we have to refill the buffer
+				if (inLen == 0) {
+					inPtr = inBuf;
+					inLen = input.readBuffer(inBuf, ARRAYSIZE(inBuf));
+					if (inLen <= 0) {
+						eof = true;
+						break;
+					}
+				}
+				inLen -= (stereo ? 2 : 1);
+				ilast0 = icur0;
+				icur0 = *inPtr++;
+				if (stereo) {
+					ilast1 = icur1;
+					icur1 = *inPtr++;
+				}
+				opos -= FRAC_ONE;
 			}
-			opos -= FRAC_ONE;
-		}
-
-		// Loop as long as the outpos trails behind, and as long as there is
-		// still space in the output buffer.
-		while (opos < (frac_t)FRAC_ONE && obuf < oend) {
-			// interpolate
-			st_sample_t out0, out1;
-			out0 = (st_sample_t)(ilast0 + (((icur0 - ilast0) * opos + FRAC_HALF) >> FRAC_BITS));
-			out1 = (stereo ?
-						  (st_sample_t)(ilast1 + (((icur1 - ilast1) * opos + FRAC_HALF) >> FRAC_BITS)) :
-						  out0);
-
-			// output left channel
-			clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
 
-			// output right channel
-			clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+			if (eof)
+				break;
 
-			obuf += 2;
+			// Loop as long as the outpos trails behind, and as long as there is
+			// still space in the block.
+			while (opos < (frac_t)FRAC_ONE && frames < count) {
+				// interpolate
+				*out++ = (st_sample_t)(ilast0 + (((icur0 - ilast0) * opos + FRAC_HALF) >> FRAC_BITS));
+				if (stereo)
+					*out++ = (st_sample_t)(ilast1 + (((icur1 - ilast1) * opos + FRAC_HALF) >> FRAC_BITS));
 
-			// Increment output position
-			opos += opos_inc;
+				// Increment output position
+				opos += opos_inc;
+				frames++;
+			}
 		}
+
+		mixFrames<stereo, reverseStereo>(block, obuf + 2 * done, frames, vol_l, vol_r);
+		done += frames;
 	}
-	return (obuf - ostart) / 2;
+	return done;
 }
 
 
@@ -274,20 +487,11 @@ template<bool stereo, bool reverseStereo>
 class CopyRateConverter : public RateConverter {
 	st_sample_t *_buffer;
 	st_size_t _bufferSize;
-public:
-	CopyRateConverter() : _buffer(0), _bufferSize(0) {}
-	~CopyRateConverter() {
-		free(_buffer);
-	}
 
-	virtual int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+	template<typename T>
+	int flowInto(AudioStream &input, T *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
 		assert(input.isStereo() == stereo);
 
-		st_sample_t *ptr;
-		st_size_t len;
-
-		st_sample_t *ostart = obuf;
-
 		if (stereo)
 			osamp *= 2;
 
@@ -302,24 +506,28 @@ public:
 			error("[CopyRateConverter::flow] Cannot allocate memory for temp buffer");
 
 		// Read up to 'osamp' samples into our temporary buffer
-		len = input.readBuffer(_buffer, osamp);
+		int len = input.readBuffer(_buffer, osamp);
+		if (len <= 0)
+			return 0;
 
 		// Mix the data into the output buffer
-		ptr = _buffer;
-		for (; len > 0; len -= (stereo ? 2 : 1)) {
-			st_sample_t out0, out1;
-			out0 = *ptr++;
-			out1 = (stereo ? *ptr++ : out0);
+		const uint frames = len / (stereo ? 2 : 1);
+		mixFrames<stereo, reverseStereo>(_buffer, obuf, frames, vol_l, vol_r);
+		return frames;
+	}
 
-			// output left channel
-			clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+public:
+	CopyRateConverter() : _buffer(0), _bufferSize(0) {}
+	~CopyRateConverter() {
+		free(_buffer);
+	}
 
-			// output right channel
-			clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+	virtual int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return flowInto(input, obuf, osamp, vol_l, vol_r);
+	}
 
-			obuf += 2;
-		}
-		return (obuf - ostart) / 2;
+	virtual int flowAccumulate(AudioStream &input, int32 *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return flowInto(input, obuf, osamp, vol_l, vol_r);
 	}
 
 	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
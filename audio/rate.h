@@ -75,6 +75,37 @@ public:
 	 */
 	virtual int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) = 0;
 
+	/**
+	 * Same as flow(), but adds to 32 bit samples without clamping them, so
+	 * that the mixer can clamp the sum of all its channels only once. The
+	 * default implementation goes through flow().
+	 *
+	 * @return Number of sample pairs written into the buffer.
+	 */
+	virtual int flowAccumulate(AudioStream &input, int32 *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+#ifdef OUTPUT_UNSIGNED_AUDIO
+		const st_sample_t silence = (st_sample_t)0x8000;
+#else
+		const st_sample_t silence = 0;
+#endif
+		st_sample_t buf[512];
+		int total = 0;
+		while (osamp > 0) {
+			const st_size_t count = osamp < 256 ? osamp : 256;
+			for (st_size_t i = 0; i < 2 * count; i++)
+				buf[i] = silence;
+			const int res = flow(input, buf, count, vol_l, vol_r);
+			for (int i = 0; i < 2 * res; i++)
+				obuf[i] += (st_sample_t)(buf[i] ^ silence);
+			total += res;
+			obuf += 2 * res;
+			if (res < (int)count)
+				break;
+			osamp -= count;
+		}
+		return total;
+	}
+
 	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) = 0;
 };
 
@@ -93,6 +93,7 @@ void SdlMixerManager::init() {
 
 		_mixer = new Audio::MixerImpl(g_system, _obtained.freq);
 		assert(_mixer);
+		_mixer->setAccumulate(ConfMan.getBool("mixer_accumulate"));
 		_mixer->setReady(true);
 
 		startAudio();
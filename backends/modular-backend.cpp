@@ -152,6 +152,36 @@ void ModularBackend::deleteMutex(MutexRef mutex) {
 	_mutexManager->deleteMutex(mutex);
 }
 
+OSystem::ThreadRef ModularBackend::createThread(ThreadProc proc, void *param) {
+	assert(_mutexManager);
+	return _mutexManager->createThread(proc, param);
+}
+
+void ModularBackend::joinThread(ThreadRef thread) {
+	assert(_mutexManager);
+	_mutexManager->joinThread(thread);
+}
+
+OSystem::SemaphoreRef ModularBackend::createSemaphore(uint value) {
+	assert(_mutexManager);
+	return _mutexManager->createSemaphore(value);
+}
+
+void ModularBackend::waitSemaphore(SemaphoreRef sem) {
+	assert(_mutexManager);
+	_mutexManager->waitSemaphore(sem);
+}
+
+void ModularBackend::postSemaphore(SemaphoreRef sem) {
+	assert(_mutexManager);
+	_mutexManager->postSemaphore(sem);
+}
+
+void ModularBackend::deleteSemaphore(SemaphoreRef sem) {
+	assert(_mutexManager);
+	_mutexManager->deleteSemaphore(sem);
+}
+
 Audio::Mixer *ModularBackend::getMixer() {
 	assert(_mixer);
 	return (Audio::Mixer *)_mixer;
@@ -102,6 +102,18 @@ public:
 
 	//@}
 
+	/** @name Thread handling */
+	//@{
+
+	virtual ThreadRef createThread(ThreadProc proc, void *param);
+	virtual void joinThread(ThreadRef thread);
+	virtual SemaphoreRef createSemaphore(uint value);
+	virtual void waitSemaphore(SemaphoreRef sem);
+	virtual void postSemaphore(SemaphoreRef sem);
+	virtual void deleteSemaphore(SemaphoreRef sem);
+
+	//@}
+
 	/** @name Sound */
 	//@{
 
@@ -28,7 +28,8 @@
 
 /**
  * Abstract class for mutex manager. Subclasses
- * implement the real functionality.
+ * implement the real functionality. Thread and
+ * semaphore support is optional.
  */
 class MutexManager : Common::NonCopyable {
 public:
@@ -38,6 +39,13 @@ public:
 	virtual void lockMutex(OSystem::MutexRef mutex) = 0;
 	virtual void unlockMutex(OSystem::MutexRef mutex) = 0;
 	virtual void deleteMutex(OSystem::MutexRef mutex) = 0;
+
+	virtual OSystem::ThreadRef createThread(OSystem::ThreadProc proc, void *param) { return 0; }
+	virtual void joinThread(OSystem::ThreadRef thread) {}
+	virtual OSystem::SemaphoreRef createSemaphore(uint value) { return 0; }
+	virtual void waitSemaphore(OSystem::SemaphoreRef sem) {}
+	virtual void postSemaphore(OSystem::SemaphoreRef sem) {}
+	virtual void deleteSemaphore(OSystem::SemaphoreRef sem) {}
 };
 
 #endif
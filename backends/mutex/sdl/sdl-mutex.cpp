@@ -44,4 +44,32 @@ void SdlMutexManager::deleteMutex(OSystem::MutexRef mutex) {
 	SDL_DestroyMutex((SDL_mutex *) mutex);
 }
 
+OSystem::ThreadRef SdlMutexManager::createThread(OSystem::ThreadProc proc, void *param) {
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+	return (OSystem::ThreadRef) SDL_CreateThread(proc, "residual", param);
+#else
+	return (OSystem::ThreadRef) SDL_CreateThread(proc, param);
+#endif
+}
+
+void SdlMutexManager::joinThread(OSystem::ThreadRef thread) {
+	SDL_WaitThread((SDL_Thread *) thread, NULL);
+}
+
+OSystem::SemaphoreRef SdlMutexManager::createSemaphore(uint value) {
+	return (OSystem::SemaphoreRef) SDL_CreateSemaphore(value);
+}
+
+void SdlMutexManager::waitSemaphore(OSystem::SemaphoreRef sem) {
+	SDL_SemWait((SDL_sem *) sem);
+}
+
+void SdlMutexManager::postSemaphore(OSystem::SemaphoreRef sem) {
+	SDL_SemPost((SDL_sem *) sem);
+}
+
+void SdlMutexManager::deleteSemaphore(OSystem::SemaphoreRef sem) {
+	SDL_DestroySemaphore((SDL_sem *) sem);
+}
+
 #endif
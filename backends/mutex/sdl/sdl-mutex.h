@@ -34,6 +34,13 @@ public:
 	virtual void lockMutex(OSystem::MutexRef mutex);
 	virtual void unlockMutex(OSystem::MutexRef mutex);
 	virtual void deleteMutex(OSystem::MutexRef mutex);
+
+	virtual OSystem::ThreadRef createThread(OSystem::ThreadProc proc, void *param);
+	virtual void joinThread(OSystem::ThreadRef thread);
+	virtual OSystem::SemaphoreRef createSemaphore(uint value);
+	virtual void waitSemaphore(OSystem::SemaphoreRef sem);
+	virtual void postSemaphore(OSystem::SemaphoreRef sem);
+	virtual void deleteSemaphore(OSystem::SemaphoreRef sem);
 };
 
 
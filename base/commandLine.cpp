@@ -132,7 +132,11 @@ void registerDefaults() {
 	// Graphics
 	ConfMan.registerDefault("fullscreen", false);
 	ConfMan.registerDefault("soft_renderer", "false");
+	ConfMan.registerDefault("soft_renderer_threads", 0);
+	ConfMan.registerDefault("soft_renderer_simd", true);
 	ConfMan.registerDefault("show_fps", "false");
+	ConfMan.registerDefault("movie_frames_ahead", 4);
+	ConfMan.registerDefault("movie_threads", 0);
 
 	// Sound & Music
 	ConfMan.registerDefault("music_volume", 127);
@@ -143,6 +147,7 @@ void registerDefaults() {
 	ConfMan.registerDefault("native_mt32", false);
 	ConfMan.registerDefault("enable_gs", false);
 	ConfMan.registerDefault("midi_gain", 100);
+	ConfMan.registerDefault("mixer_accumulate", true);
 
 	ConfMan.registerDefault("music_driver", "auto");
 	ConfMan.registerDefault("mt32_device", "null");
@@ -160,6 +165,10 @@ void registerDefaults() {
 	ConfMan.registerDefault("autosave_period", 5 * 60);	// By default, trigger autosave every 5 minutes
 
 	ConfMan.registerDefault("dimuse_tempo", 10);
+	ConfMan.registerDefault("resource_cache_size", 32 * 1024);	// in KB
+	ConfMan.registerDefault("imuse_cache_size", 2 * 1024);	// in KB
+	ConfMan.registerDefault("lua_incremental_gc", true);
+	ConfMan.registerDefault("imuse_blocks_ahead", 4);
 
 	// Miscellaneous
 	ConfMan.registerDefault("joystick_num", -1);
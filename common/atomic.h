@@ -0,0 +1,92 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_ATOMIC_H
+#define COMMON_ATOMIC_H
+
+#include "common/scummsys.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Common {
+
+/**
+ * @defgroup atomic Atomic operations
+ *
+ * Minimal atomic operations on aligned 32 bit words and pointers, for data
+ * shared between threads without a mutex. Loads and stores are full memory
+ * barriers, which keeps their ordering simple to reason about: a store is
+ * visible to the other threads before any later load of this thread.
+ */
+
+/** Full memory barrier, for both the compiler and the CPU. */
+inline void memoryBarrier() {
+#if defined(_MSC_VER)
+	long dummy = 0;
+	_InterlockedExchange(&dummy, 0);
+#elif defined(__GNUC__)
+	__sync_synchronize();
+#else
+#error "No memory barrier for this compiler"
+#endif
+}
+
+inline uint32 atomicLoad(const volatile uint32 *p) {
+	const uint32 val = *p;
+	memoryBarrier();
+	return val;
+}
+
+inline void atomicStore(volatile uint32 *p, uint32 val) {
+	memoryBarrier();
+	*p = val;
+	memoryBarrier();
+}
+
+/** Adds one to *p and returns the new value. */
+inline uint32 atomicIncrement(volatile uint32 *p) {
+#if defined(_MSC_VER)
+	return (uint32)_InterlockedIncrement((volatile long *)p);
+#else
+	return __sync_add_and_fetch(p, 1);
+#endif
+}
+
+template<class T>
+inline T *atomicLoad(T *const volatile *p) {
+	T *const val = *p;
+	memoryBarrier();
+	return val;
+}
+
+template<class T>
+inline void atomicStore(T *volatile *p, T *val) {
+	memoryBarrier();
+	*p = val;
+	memoryBarrier();
+}
+
+} // End of namespace Common
+
+#endif
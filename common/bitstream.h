@@ -26,6 +26,8 @@
 #define COMMON_BITSTREAM_H
 
 #include "common/scummsys.h"
+#include "common/endian.h"
+#include "common/textconsole.h"
 
 namespace Common {
 
@@ -168,6 +170,148 @@ private:
 	uint8  _inValue; ///< Position within the current 32bit value.
 };
 
+/**
+ * A bit stream over data in memory, for decoders reading a lot of bits.
+ *
+ * Unlike the BitStream classes, it has no virtual methods and keeps up to
+ * 64 bits of the data in a cache, so that a number of bits is read, peeked
+ * at or skipped in one go. The data is neither copied nor owned, and must
+ * stay valid while it is read.
+ *
+ * If isLE is true, the bits are handed out from the LSB to the MSB of each
+ * byte, which gives the same bits as BitStream32LE for data made of whole
+ * 32bit values. Otherwise they are handed out from the MSB to the LSB, like
+ * BitStreamBE.
+ */
+template<bool isLE>
+class BitReader {
+public:
+	BitReader(const byte *data, uint32 bitCount) :
+			_data(data), _ptr(data), _end(data + bitCount / 8), _cache(0), _cacheBits(0), _size(bitCount) {
+	}
+
+	uint32 getBit() {
+		if (_cacheBits < 1)
+			refill(1, true);
+
+		uint32 b;
+		if (isLE) {
+			b = (uint32)_cache & 1;
+			_cache >>= 1;
+		} else {
+			b = (uint32)(_cache >> 63);
+			_cache <<= 1;
+		}
+		_cacheBits--;
+		return b;
+	}
+
+	/** Read n bits, n being at most 32, the first one read being the LSB if isLE. */
+	uint32 getBits(uint32 n) {
+		if (n == 0)
+			return 0;
+		if (_cacheBits < n)
+			refill(n, true);
+
+		uint32 v = peekCache(n);
+		drop(n);
+		return v;
+	}
+
+	/**
+	 * Return the next n bits, at most 32, without reading them. The bits
+	 * beyond the end of the stream are 0.
+	 */
+	uint32 peekBits(uint32 n) {
+		if (n == 0)
+			return 0;
+		if (_cacheBits < n)
+			refill(n, false);
+
+		return peekCache(n);
+	}
+
+	void skip(uint32 n) {
+		while (n > 32) {
+			getBits(32);
+			n -= 32;
+		}
+		if (_cacheBits < n)
+			refill(n, true);
+		drop(n);
+	}
+
+	/** Add one more bit to x, which was built of n bits so far. */
+	void addBit(uint32 &x, uint32 n) {
+		if (isLE)
+			x = (x & ~(1 << n)) | (getBit() << n);
+		else
+			x = (x << 1) | getBit();
+	}
+
+	/** Get the current position, in bits. */
+	uint32 pos() const { return (_ptr - _data) * 8 - _cacheBits; }
+	/** Return the number of bits in the stream. */
+	uint32 size() const { return _size; }
+
+private:
+	uint32 peekCache(uint32 n) const {
+		if (isLE)
+			return (uint32)(_cache & (((uint64)1 << n) - 1));
+		else
+			return (uint32)(_cache >> (64 - n));
+	}
+
+	// Drops n bits, at most 32, from the cache.
+	void drop(uint32 n) {
+		if (isLE)
+			_cache >>= n;
+		else
+			_cache <<= n;
+		_cacheBits -= n;
+	}
+
+	// Fills the cache with at least n bits, if the stream has them.
+	void refill(uint32 n, bool needed) {
+		if (_end - _ptr >= 8) {
+			// load 8 bytes at once and keep the whole bytes which fit; the
+			// bits loaded beyond them are those of the next bytes anyway
+			uint64 v;
+			if (isLE) {
+				v = (uint64)READ_LE_UINT32(_ptr) | ((uint64)READ_LE_UINT32(_ptr + 4) << 32);
+				_cache |= v << _cacheBits;
+			} else {
+				v = ((uint64)READ_BE_UINT32(_ptr) << 32) | READ_BE_UINT32(_ptr + 4);
+				_cache |= v >> _cacheBits;
+			}
+			uint32 bytes = (64 - _cacheBits) >> 3;
+			_ptr += bytes;
+			_cacheBits += bytes * 8;
+			return;
+		}
+
+		while (_cacheBits <= 56 && _ptr < _end) {
+			if (isLE)
+				_cache |= (uint64)*_ptr++ << _cacheBits;
+			else
+				_cache |= (uint64)*_ptr++ << (56 - _cacheBits);
+			_cacheBits += 8;
+		}
+		if (needed && _cacheBits < n)
+			error("End of bit stream reached");
+	}
+
+	const byte *_data;
+	const byte *_ptr;
+	const byte *_end;
+	uint64 _cache;		///< The next bits, from bit 0 if isLE, else from bit 63.
+	uint32 _cacheBits;	///< Number of valid bits in _cache.
+	uint32 _size;
+};
+
+typedef BitReader<true> BitReaderLE;
+typedef BitReader<false> BitReaderBE;
+
 } // End of namespace Common
 
 #endif // COMMON_BITSTREAM_H
@@ -33,7 +33,8 @@ Huffman::Symbol::Symbol(uint32 c, uint32 s) : code(c), symbol(s) {
 }
 
 
-Huffman::Huffman(uint8 maxLength, uint32 codeCount, const uint32 *codes, const uint8 *lengths, const uint32 *symbols) {
+Huffman::Huffman(uint8 maxLength, uint32 codeCount, const uint32 *codes, const uint8 *lengths, const uint32 *symbols, bool lsbFirst) :
+		_lsbFirst(lsbFirst), _tableBits(0) {
 	assert(codeCount > 0);
 
 	assert(codes);
@@ -58,6 +59,8 @@ Huffman::Huffman(uint8 maxLength, uint32 codeCount, const uint32 *codes, const u
 		// And put the pointer to the symbol/code struct into the symbol list.
 		_symbols[i] = &_codes[lengths[i] - 1].back();
 	}
+
+	buildTables();
 }
 
 Huffman::~Huffman() {
@@ -66,6 +69,8 @@ Huffman::~Huffman() {
 void Huffman::setSymbols(const uint32 *symbols) {
 	for (uint32 i = 0; i < _symbols.size(); i++)
 		_symbols[i]->symbol = symbols ? *symbols++ : i;
+
+	buildTables();
 }
 
 uint32 Huffman::getSymbol(BitStream &bits) const {
@@ -83,4 +88,86 @@ uint32 Huffman::getSymbol(BitStream &bits) const {
 	return 0;
 }
 
+static inline uint32 lowBits(uint32 x, uint32 n) {
+	return n < 32 ? x & ((1 << n) - 1) : x;
+}
+
+static inline uint32 reverseBits(uint32 x, uint32 n) {
+	uint32 r = 0;
+	for (uint32 i = 0; i < n; i++, x >>= 1)
+		r = (r << 1) | (x & 1);
+	return r;
+}
+
+void Huffman::buildTables() {
+	// The tables are indexed by the next bits as peeked from the stream,
+	// that is from the LSB on with a BitReaderLE, and from the MSB on with
+	// a BitReaderBE. The codes are stored the way they are read as well.
+	Array<Code> codes;
+	for (uint32 i = 0; i < _codes.size(); i++) {
+		for (CodeList::const_iterator cCode = _codes[i].begin(); cCode != _codes[i].end(); ++cCode) {
+			Code code;
+			code.bits = _lsbFirst ? cCode->code : reverseBits(cCode->code, i + 1);
+			code.length = i + 1;
+			code.symbol = cCode->symbol;
+			codes.push_back(code);
+		}
+	}
+
+	_tableBits = MIN<uint32>(_codes.size(), kMaxTableBits);
+	_table.clear();
+	_table.resize(1 << _tableBits);
+	buildTable(0, _tableBits, 0, codes);
+}
+
+void Huffman::buildTable(uint32 offset, uint32 n, uint32 skipped, const Array<Code> &codes) {
+	Array<Code> longer;
+
+	for (uint32 i = 0; i < codes.size(); i++) {
+		const Code &code = codes[i];
+		uint32 length = code.length - skipped;
+		if (length > n) {
+			longer.push_back(code);
+			continue;
+		}
+
+		// All the entries whose bits start with the code
+		uint32 bits = lowBits(code.bits >> skipped, length);
+		for (uint32 rest = 0; rest < (1u << (n - length)); rest++) {
+			uint32 index = bits | (rest << length);
+			TableEntry &entry = _table[offset + (_lsbFirst ? index : reverseBits(index, n))];
+			entry.value = code.symbol;
+			entry.length = length;
+			entry.subBits = 0;
+		}
+	}
+
+	// The longer codes go to a table of their own for each n bits they start with
+	while (!longer.empty()) {
+		uint32 prefix = lowBits(longer[0].bits >> skipped, n);
+		uint32 maxLength = 0;
+		Array<Code> group, others;
+		for (uint32 i = 0; i < longer.size(); i++) {
+			if (lowBits(longer[i].bits >> skipped, n) == prefix) {
+				group.push_back(longer[i]);
+				maxLength = MAX<uint32>(maxLength, longer[i].length);
+			} else {
+				others.push_back(longer[i]);
+			}
+		}
+
+		uint32 subBits = MIN<uint32>(maxLength - skipped - n, kMaxTableBits);
+		uint32 subOffset = _table.size();
+		_table.resize(subOffset + (1 << subBits));
+
+		TableEntry &entry = _table[offset + (_lsbFirst ? prefix : reverseBits(prefix, n))];
+		entry.value = subOffset;
+		entry.length = 0;
+		entry.subBits = subBits;
+
+		buildTable(subOffset, subBits, skipped + n, group);
+		longer = others;
+	}
+}
+
 } // End of namespace Common
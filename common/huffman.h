@@ -26,13 +26,13 @@
 #define COMMON_HUFFMAN_H
 
 #include "common/array.h"
+#include "common/bitstream.h"
 #include "common/list.h"
+#include "common/textconsole.h"
 #include "common/types.h"
 
 namespace Common {
 
-class BitStream;
-
 /**
  * Huffman bitstream decoding
  *
@@ -48,8 +48,9 @@ public:
 	 *  @param codes The actual codes.
 	 *  @param lengths Lengths of the individual codes.
 	 *  @param symbols The symbols. If 0, assume they are identical to the code indices.
+	 *  @param lsbFirst Whether the codes are read with a BitReaderLE, rather than a BitReaderBE.
 	 */
-	Huffman(uint8 maxLength, uint32 codeCount, const uint32 *codes, const uint8 *lengths, const uint32 *symbols = 0);
+	Huffman(uint8 maxLength, uint32 codeCount, const uint32 *codes, const uint8 *lengths, const uint32 *symbols = 0, bool lsbFirst = false);
 	~Huffman();
 
 	/** Modify the codes' symbols. */
@@ -58,7 +59,35 @@ public:
 	/** Return the next symbol in the bitstream. */
 	uint32 getSymbol(BitStream &bits) const;
 
+	/**
+	 * Return the next symbol in the bitstream, looking it up in the tables
+	 * built for the bit order given at construction.
+	 */
+	template<bool isLE>
+	uint32 getSymbol(BitReader<isLE> &bits) const {
+		assert(isLE == _lsbFirst);
+
+		uint32 offset = 0;
+		uint32 n = _tableBits;
+		for (;;) {
+			const TableEntry &entry = _table[offset + bits.peekBits(n)];
+			if (entry.length) {
+				bits.skip(entry.length);
+				return entry.value;
+			}
+			if (!entry.subBits)
+				error("Unknown Huffman code");
+
+			bits.skip(n);
+			offset = entry.value;
+			n = entry.subBits;
+		}
+	}
+
 private:
+	/** The number of bits looked up at once in a table. */
+	static const uint32 kMaxTableBits = 9;
+
 	struct Symbol {
 		uint32 code;
 		uint32 symbol;
@@ -70,11 +99,39 @@ private:
 	typedef Common::Array<CodeList> CodeLists;
 	typedef Common::Array<Symbol *> SymbolList;
 
+	/**
+	 * An entry of a lookup table, for the next bits of the stream. Either
+	 * they start with a code, of length bits, and value is its symbol, or
+	 * they are the prefix of longer codes, and the following subBits bits
+	 * are looked up in the table which starts at value.
+	 */
+	struct TableEntry {
+		uint32 value;
+		uint8 length;
+		uint8 subBits;
+	};
+
+	/** A code, with its bits in the order they are read, from bit 0. */
+	struct Code {
+		uint32 bits;
+		uint8 length;
+		uint32 symbol;
+	};
+
+	void buildTables();
+	void buildTable(uint32 offset, uint32 n, uint32 skipped, const Array<Code> &codes);
+
 	/** Lists of codes and their symbols, sorted by code length. */
 	CodeLists _codes;
 
 	/** Sorted list of pointers to the symbols. */
 	SymbolList _symbols;
+
+	bool _lsbFirst;
+
+	/** The lookup tables, the first one indexed by the first _tableBits bits. */
+	Array<TableEntry> _table;
+	uint32 _tableBits;
 };
 
 } // End of namespace Common
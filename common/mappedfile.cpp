@@ -0,0 +1,80 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#if defined(POSIX)
+#define FORBIDDEN_SYMBOL_EXCEPTION_unistd_h
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "common/mappedfile.h"
+#include "common/fs.h"
+#include "common/memstream.h"
+
+namespace Common {
+
+bool MappedFile::open(const FSNode &node) {
+	close();
+
+#if defined(POSIX)
+	if (!node.exists() || node.isDirectory())
+		return false;
+
+	int fd = ::open(node.getPath().c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	void *map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0 && (uint64)st.st_size <= 0xffffffff)
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	_data = (const byte *)map;
+	_size = st.st_size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void MappedFile::close() {
+#if defined(POSIX)
+	if (_data)
+		munmap(const_cast<byte *>(_data), _size);
+#endif
+	_data = NULL;
+	_size = 0;
+}
+
+SeekableReadStream *MappedFile::createReadStream() const {
+	if (!_data)
+		return NULL;
+	return new MemoryReadStream(_data, _size);
+}
+
+} // End of namespace Common
@@ -0,0 +1,67 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#ifndef COMMON_MAPPEDFILE_H
+#define COMMON_MAPPEDFILE_H
+
+#include "common/scummsys.h"
+#include "common/noncopyable.h"
+
+namespace Common {
+
+class FSNode;
+class SeekableReadStream;
+
+/**
+ * A whole file mapped read-only in memory, so that its data is shared with
+ * the page cache rather than copied. Mapping is only supported on POSIX
+ * systems; elsewhere open() always fails, and the file has to be read
+ * through a stream instead.
+ */
+class MappedFile : NonCopyable {
+public:
+	MappedFile() : _data(NULL), _size(0) {}
+	~MappedFile() { close(); }
+
+	/**
+	 * Maps the file node refers to. Fails if mapping is not supported, or
+	 * if the file is empty or larger than 4 GB.
+	 */
+	bool open(const FSNode &node);
+	void close();
+
+	bool isOpen() const { return _data != NULL; }
+	/** The data of the file, valid until it is closed. */
+	const byte *getData() const { return _data; }
+	uint32 size() const { return _size; }
+
+	/** Creates a stream reading the mapped data, which must outlive it. */
+	SeekableReadStream *createReadStream() const;
+
+private:
+	const byte *_data;
+	uint32 _size;
+};
+
+} // End of namespace Common
+
+#endif
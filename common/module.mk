@@ -13,6 +13,7 @@ MODULE_OBJS := \
 	fs.o \
 	hashmap.o \
 	macresman.o \
+	mappedfile.o \
 	memorypool.o \
 	md5.o \
 	mutex.o \
@@ -22,6 +23,7 @@ MODULE_OBJS := \
 	stream.o \
 	system.o \
 	textconsole.o \
+	thread.o \
 	tokenizer.o \
 	translation.o \
 	unzip.o \
@@ -106,9 +106,12 @@ public:
 	/**
 	 * Open the savefile with the specified name in the given directory for saving.
 	 * @param name	the name of the savefile
+	 * @param compress	toggles whether to compress the resulting save file
+	 * 			(default) or not; files which compress their own data
+	 * 			should pass false, so that they remain seekable on loading
 	 * @return pointer to an OutSaveFile, or NULL if an error occurred.
 	 */
-	virtual OutSaveFile *openForSaving(const String &name) = 0;
+	virtual OutSaveFile *openForSaving(const String &name, bool compress = true) = 0;
 
 	/**
 	 * Open the file with the specified name in the given directory for loading.
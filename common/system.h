@@ -558,6 +558,61 @@ public:
 
 
 
+	/**
+	 * @name Thread handling
+	 * Optional support for worker threads, used by engines to move heavy
+	 * but independent work (software rasterization, decoding) off the main
+	 * thread. Backends which cannot create threads simply keep the default
+	 * implementations, which report failure; all callers must then fall
+	 * back to doing the work synchronously.
+	 */
+	//@{
+
+	typedef struct OpaqueThread *ThreadRef;
+	typedef struct OpaqueSemaphore *SemaphoreRef;
+	typedef int (*ThreadProc)(void *param);
+
+	/**
+	 * Start a new thread running proc(param).
+	 * @return the new thread, or 0 if threads are not supported.
+	 */
+	virtual ThreadRef createThread(ThreadProc proc, void *param) { return 0; }
+
+	/**
+	 * Wait until the given thread has returned and release it.
+	 * @param thread	the thread to wait for.
+	 */
+	virtual void joinThread(ThreadRef thread) {}
+
+	/**
+	 * Create a new counting semaphore.
+	 * @param value	the initial count.
+	 * @return the newly created semaphore, or 0 if not supported.
+	 */
+	virtual SemaphoreRef createSemaphore(uint value) { return 0; }
+
+	/**
+	 * Wait until the count of the given semaphore is non-zero and decrement it.
+	 * @param sem	the semaphore to wait on.
+	 */
+	virtual void waitSemaphore(SemaphoreRef sem) {}
+
+	/**
+	 * Increment the count of the given semaphore, waking up one waiter.
+	 * @param sem	the semaphore to post.
+	 */
+	virtual void postSemaphore(SemaphoreRef sem) {}
+
+	/**
+	 * Delete the given semaphore. No thread may be waiting on it.
+	 * @param sem	the semaphore to delete.
+	 */
+	virtual void deleteSemaphore(SemaphoreRef sem) {}
+
+	//@}
+
+
+
 	/** @name Sound */
 	//@{
 
@@ -0,0 +1,130 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/thread.h"
+
+namespace Common {
+
+Semaphore::Semaphore(uint value) {
+	assert(g_system);
+	_sem = g_system->createSemaphore(value);
+}
+
+Semaphore::~Semaphore() {
+	if (_sem)
+		g_system->deleteSemaphore(_sem);
+}
+
+void Semaphore::wait() {
+	if (_sem)
+		g_system->waitSemaphore(_sem);
+}
+
+void Semaphore::post() {
+	if (_sem)
+		g_system->postSemaphore(_sem);
+}
+
+
+#pragma mark -
+
+
+WorkerPool::WorkerPool(int numThreads)
+	: _proc(0), _param(0), _numJobs(0), _nextJob(0), _quit(false) {
+	if (!_start.isValid() || !_done.isValid())
+		return;
+
+	for (int i = 0; i < numThreads; i++) {
+		OSystem::ThreadRef thread = g_system->createThread(threadEntry, this);
+		if (!thread)
+			break;
+		_threads.push_back(thread);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	_quit = true;
+	for (uint i = 0; i < _threads.size(); i++)
+		_start.post();
+	for (uint i = 0; i < _threads.size(); i++)
+		g_system->joinThread(_threads[i]);
+}
+
+void WorkerPool::run(JobProc proc, void *param, int numJobs) {
+	if (numJobs <= 0)
+		return;
+
+	if (_threads.empty() || numJobs == 1) {
+		for (int i = 0; i < numJobs; i++)
+			proc(param, i);
+		return;
+	}
+
+	_mutex.lock();
+	_proc = proc;
+	_param = param;
+	_numJobs = numJobs;
+	_nextJob = 0;
+	_mutex.unlock();
+
+	for (uint i = 0; i < _threads.size(); i++)
+		_start.post();
+
+	while (runNextJob())
+		;
+
+	for (uint i = 0; i < _threads.size(); i++)
+		_done.wait();
+}
+
+bool WorkerPool::runNextJob() {
+	_mutex.lock();
+	int job = _nextJob;
+	if (job >= _numJobs) {
+		_mutex.unlock();
+		return false;
+	}
+	_nextJob++;
+	_mutex.unlock();
+
+	_proc(_param, job);
+	return true;
+}
+
+int WorkerPool::threadEntry(void *param) {
+	WorkerPool *pool = (WorkerPool *)param;
+	pool->workerLoop();
+	return 0;
+}
+
+void WorkerPool::workerLoop() {
+	while (true) {
+		_start.wait();
+		if (_quit)
+			break;
+		while (runNextJob())
+			;
+		_done.post();
+	}
+}
+
+} // End of namespace Common
@@ -0,0 +1,99 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_THREAD_H
+#define COMMON_THREAD_H
+
+#include "common/array.h"
+#include "common/mutex.h"
+#include "common/noncopyable.h"
+#include "common/system.h"
+
+namespace Common {
+
+/**
+ * Wrapper class around the OSystem semaphore functions.
+ * If the backend has no thread support the semaphore is invalid and
+ * all operations on it are no-ops.
+ */
+class Semaphore : NonCopyable {
+	OSystem::SemaphoreRef _sem;
+
+public:
+	explicit Semaphore(uint value = 0);
+	~Semaphore();
+
+	bool isValid() const { return _sem != 0; }
+
+	void wait();
+	void post();
+};
+
+/**
+ * A fixed set of worker threads executing numbered jobs.
+ *
+ * run() hands out the jobs 0..numJobs-1 to the workers and to the calling
+ * thread, and returns once all of them are done. If the backend cannot
+ * create threads the pool has no workers, and run() simply executes every
+ * job on the calling thread.
+ */
+class WorkerPool : NonCopyable {
+public:
+	typedef void (*JobProc)(void *param, int job);
+
+	/**
+	 * Create a pool.
+	 * @param numThreads	number of worker threads to start in addition to
+	 *						the thread calling run().
+	 */
+	explicit WorkerPool(int numThreads);
+	~WorkerPool();
+
+	/** Return the number of worker threads actually running. */
+	int getNumThreads() const { return _threads.size(); }
+
+	/**
+	 * Execute proc(param, job) for every job in 0..numJobs-1 and wait for
+	 * all of them to finish. Jobs may run in any order and concurrently.
+	 */
+	void run(JobProc proc, void *param, int numJobs);
+
+private:
+	static int threadEntry(void *param);
+	void workerLoop();
+	bool runNextJob();
+
+	Array<OSystem::ThreadRef> _threads;
+	Semaphore _start;
+	Semaphore _done;
+	Mutex _mutex;
+
+	JobProc _proc;
+	void *_param;
+	int _numJobs;
+	int _nextJob;
+	bool _quit;
+};
+
+} // End of namespace Common
+
+#endif
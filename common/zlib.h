@@ -41,6 +41,16 @@ class WriteStream;
  */
 bool uncompress(byte *dst, unsigned long *dstLen, const byte *src, unsigned long srcLen);
 
+/**
+ * Thin wrapper around zlib's compress() function, the counterpart of
+ * uncompress(). *dstLen holds the size of dst on entry, and the size of the
+ * compressed data on return.
+ *
+ * @return true on success (i.e. Z_OK), false otherwise, in particular when
+ *         the compressed data does not fit in dst
+ */
+bool compress(byte *dst, unsigned long *dstLen, const byte *src, unsigned long srcLen);
+
 #endif
 
 /**
@@ -0,0 +1,214 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ * Measures how fast Common::Huffman decodes, through its lookup tables from
+ * a BitReader and through the per-bit scan of the code lists from a
+ * BitStream. Every symbol is checked, so a wrong table fails the run.
+ *
+ * Build with "make devtools/huffman_bench" and run it without arguments.
+ */
+
+// Allow use of stuff in <stdio.h>, <stdlib.h> and <time.h>
+#define FORBIDDEN_SYMBOL_ALLOW_ALL
+
+#include "common/algorithm.h"
+#include "common/array.h"
+#include "common/bitstream.h"
+#include "common/huffman.h"
+#include "common/util.h"
+
+#include "video/binkdata.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+void NORETURN_PRE error(const char *s, ...) {
+	va_list va;
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "\n");
+	va_end(va);
+	exit(1);
+}
+
+namespace {
+
+double seconds() {
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+uint32 reverseBits(uint32 value, int count) {
+	uint32 result = 0;
+	for (int i = 0; i < count; i++, value >>= 1)
+		result = (result << 1) | (value & 1);
+	return result;
+}
+
+/** Writes bits in the order a BitReaderLE or a BitReaderBE reads them. */
+class BitWriter {
+public:
+	BitWriter(bool lsbFirst) : _lsbFirst(lsbFirst), _pos(0) {}
+
+	void putBit(int bit) {
+		if (_pos / 8 >= _data.size())
+			_data.push_back(0);
+		if (bit)
+			_data[_pos / 8] |= _lsbFirst ? 1 << (_pos % 8) : 0x80 >> (_pos % 8);
+		_pos++;
+	}
+
+	/** Pads the data to whole 32 bit words, as BitStream32LE reads them. */
+	void finish() {
+		while (_data.size() % 4)
+			_data.push_back(0);
+	}
+
+	const byte *getData() const { return &_data[0]; }
+	uint32 getBits() const { return _data.size() * 8; }
+
+private:
+	bool _lsbFirst;
+	uint32 _pos;
+	Common::Array<byte> _data;
+};
+
+/**
+ * Encodes random symbols with the given codes, decodes them both ways and
+ * prints the time per symbol. The codes are passed as Huffman expects them:
+ * bit reversed if lsbFirst is set.
+ */
+template<class Stream, class Reader>
+bool measure(const char *name, bool lsbFirst, uint32 count, const uint32 *codes, const uint8 *lengths, uint32 symbolCount) {
+	BitWriter writer(lsbFirst);
+	Common::Array<uint32> sent;
+	for (uint32 i = 0; i < symbolCount; i++) {
+		uint32 s = rand() % count;
+		uint32 code = lsbFirst ? codes[s] : reverseBits(codes[s], lengths[s]);
+		for (int b = 0; b < lengths[s]; b++, code >>= 1)
+			writer.putBit(code & 1);
+		sent.push_back(s);
+	}
+	writer.finish();
+
+	Common::Array<uint32> symbols;
+	for (uint32 i = 0; i < count; i++)
+		symbols.push_back(i * 3 + 1);
+	Common::Huffman huffman(0, count, codes, lengths, &symbols[0], lsbFirst);
+
+	double start = seconds();
+	Stream stream(writer.getData(), writer.getBits());
+	for (uint32 i = 0; i < symbolCount; i++) {
+		if (huffman.getSymbol((Common::BitStream &)stream) != symbols[sent[i]]) {
+			printf("%s: the code list scan decoded symbol %d wrong\n", name, i);
+			return false;
+		}
+	}
+	double scanned = seconds();
+	Reader reader(writer.getData(), writer.getBits());
+	for (uint32 i = 0; i < symbolCount; i++) {
+		if (huffman.getSymbol(reader) != symbols[sent[i]]) {
+			printf("%s: the tables decoded symbol %d wrong\n", name, i);
+			return false;
+		}
+	}
+	double looked = seconds();
+
+	printf("%-32s scan %7.1f ns/symbol, tables %6.1f ns/symbol\n", name,
+	       (scanned - start) / symbolCount * 1e9, (looked - scanned) / symbolCount * 1e9);
+	return true;
+}
+
+/**
+ * Makes a complete canonical code of count codes up to maxLength bits long,
+ * with random lengths, and shuffles it.
+ */
+void makeCode(uint32 count, int maxLength, bool lsbFirst, Common::Array<uint32> &codes, Common::Array<uint8> &lengths) {
+	// Split random leaves of a code tree until there are enough of them
+	Common::Array<int> leaves;
+	leaves.push_back(0);
+	while (leaves.size() < count) {
+		uint32 i = rand() % leaves.size();
+		for (uint32 j = 0; leaves[i] >= maxLength && j < leaves.size(); j++)
+			i = j;
+		if (leaves[i] >= maxLength)
+			break;
+		leaves[i]++;
+		leaves.push_back(leaves[i]);
+	}
+	Common::sort(leaves.begin(), leaves.end());
+
+	codes.clear();
+	lengths.clear();
+	uint32 code = 0;
+	for (uint32 i = 0; i < leaves.size(); i++) {
+		if (i)
+			code = (code + 1) << (leaves[i] - leaves[i - 1]);
+		codes.push_back(lsbFirst ? reverseBits(code, leaves[i]) : code);
+		lengths.push_back(leaves[i]);
+	}
+
+	for (uint32 i = codes.size() - 1; i > 0; i--) {
+		uint32 j = rand() % (i + 1);
+		SWAP(codes[i], codes[j]);
+		SWAP(lengths[i], lengths[j]);
+	}
+}
+
+} // End of anonymous namespace
+
+int main(int argc, char *argv[]) {
+	const uint32 symbolCount = 1000000;
+	char name[64];
+
+	srand(3);
+
+	for (int t = 0; t < 16; t++) {
+		snprintf(name, sizeof(name), "Bink codebook %d", t);
+		if (!measure<Common::BitStream32LE, Common::BitReaderLE>(name, true, 16,
+		        Video::binkHuffmanCodes[t], Video::binkHuffmanLengths[t], symbolCount))
+			return 1;
+	}
+
+	static const int sizes[][2] = { { 64, 12 }, { 256, 16 }, { 300, 24 }, { 1000, 32 } };
+	for (uint k = 0; k < ARRAYSIZE(sizes); k++) {
+		for (int lsbFirst = 0; lsbFirst < 2; lsbFirst++) {
+			Common::Array<uint32> codes;
+			Common::Array<uint8> lengths;
+			makeCode(sizes[k][0], sizes[k][1], lsbFirst, codes, lengths);
+			snprintf(name, sizeof(name), "%u codes of up to %d bits, %s", codes.size(), sizes[k][1], lsbFirst ? "LE" : "BE");
+
+			bool ok;
+			if (lsbFirst)
+				ok = measure<Common::BitStream32LE, Common::BitReaderLE>(name, true, codes.size(), &codes[0], &lengths[0], symbolCount / 10);
+			else
+				ok = measure<Common::BitStreamBE, Common::BitReaderBE>(name, false, codes.size(), &codes[0], &lengths[0], symbolCount / 10);
+			if (!ok)
+				return 1;
+		}
+	}
+
+	return 0;
+}
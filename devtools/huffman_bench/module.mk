@@ -0,0 +1,19 @@
+MODULE := devtools/huffman_bench
+
+MODULE_OBJS := \
+	huffman_bench.o
+
+# Set the name of the executable
+TOOL_EXECUTABLE := huffman_bench
+
+# Common::Huffman is the code being measured, the rest is what it reads from
+TOOL_DEPS := \
+	common/bitstream.o \
+	common/hashmap.o \
+	common/huffman.o \
+	common/memorypool.o \
+	common/str.o \
+	common/stream.o
+
+# Include common rules
+include $(srcdir)/rules.mk
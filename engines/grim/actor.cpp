@@ -400,6 +400,57 @@ void Actor::turnTo(const Math::Angle &pitchParam, const Math::Angle &yawParam, c
 		_turning = false;
 }
 
+void Actor::pushPathNode(int sector) {
+	_pathHeap.push_back(sector);
+	siftPathNode(_pathHeap.size() - 1);
+}
+
+int Actor::popPathNode() {
+	int sector = _pathHeap[0];
+	int last = _pathHeap.back();
+	_pathHeap.pop_back();
+	if (!_pathHeap.empty()) {
+		_pathHeap[0] = last;
+		siftPathNode(0);
+	}
+	_pathNodes[sector].heapPos = PathNodeClosed;
+	return sector;
+}
+
+// Moves the node at heapPos up or down the heap to where its estimate belongs.
+void Actor::siftPathNode(int heapPos) {
+	int sector = _pathHeap[heapPos];
+	float estimate = _pathNodes[sector].estimate();
+
+	while (heapPos > 0) {
+		int parent = (heapPos - 1) / 2;
+		int s = _pathHeap[parent];
+		if (_pathNodes[s].estimate() <= estimate)
+			break;
+		_pathHeap[heapPos] = s;
+		_pathNodes[s].heapPos = heapPos;
+		heapPos = parent;
+	}
+
+	int size = _pathHeap.size();
+	for (;;) {
+		int child = heapPos * 2 + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && _pathNodes[_pathHeap[child + 1]].estimate() < _pathNodes[_pathHeap[child]].estimate())
+			++child;
+		int s = _pathHeap[child];
+		if (_pathNodes[s].estimate() >= estimate)
+			break;
+		_pathHeap[heapPos] = s;
+		_pathNodes[s].heapPos = heapPos;
+		heapPos = child;
+	}
+
+	_pathHeap[heapPos] = sector;
+	_pathNodes[sector].heapPos = heapPos;
+}
+
 void Actor::walkTo(const Math::Vector3d &p) {
 	if (p == _pos)
 		_walking = false;
@@ -409,127 +460,87 @@ void Actor::walkTo(const Math::Vector3d &p) {
 		_path.clear();
 
 		if (_constrain) {
-			g_grim->getCurrSet()->findClosestSector(p, NULL, &_destPos);
-
-			Common::List<PathNode *> openList;
-			Common::List<PathNode *> closedList;
-
-			PathNode *start = new PathNode;
-			start->parent = NULL;
-			start->pos = _pos;
-			start->dist = 0.f;
-			start->cost = 0.f;
-			openList.push_back(start);
-			g_grim->getCurrSet()->findClosestSector(_pos, &start->sect, NULL);
-
-			Common::List<Sector *> sectors;
-			for (int i = 0; i < g_grim->getCurrSet()->getSectorCount(); ++i) {
-				Sector *s = g_grim->getCurrSet()->getSectorBase(i);
-				int type = s->getType();
-				if ((type == Sector::WalkType || type == Sector::HotType || type == Sector::FunnelType) && s->isVisible()) {
-					sectors.push_back(s);
-				}
+			Set *set = g_grim->getCurrSet();
+			set->findClosestSector(p, NULL, &_destPos);
+
+			Sector *startSec = NULL, *endSec = NULL;
+			set->findClosestSector(_pos, &startSec, NULL);
+			set->findClosestSector(_destPos, &endSec, NULL);
+			int start = set->getSectorIndex(startSec);
+			int end = set->getSectorIndex(endSec);
+
+			// A previous search may have stopped with nodes left in the heap
+			_pathHeap.resize(0);
+			if (start >= 0) {
+				_pathNodes.resize(set->getSectorCount());
+				for (uint i = 0; i < _pathNodes.size(); ++i)
+					_pathNodes[i].heapPos = PathNodeUnseen;
+
+				PathNode &startNode = _pathNodes[start];
+				startNode.parent = -1;
+				startNode.pos = _pos;
+				startNode.dist = 0.f;
+				startNode.cost = 0.f;
+				pushPathNode(start);
 			}
 
-			Sector *endSec = NULL;
-			g_grim->getCurrSet()->findClosestSector(_destPos, &endSec, NULL);
-
-			do {
-				PathNode *node = NULL;
-				float cost = -1.f;
-				for (Common::List<PathNode *>::iterator j = openList.begin(); j != openList.end(); ++j) {
-					PathNode *n = *j;
-					float c = n->dist + n->cost;
-					if (cost < 0.f || c < cost) {
-						cost = c;
-						node = n;
-					}
-				}
-				closedList.push_back(node);
-				openList.remove(node);
-				Sector *sector = node->sect;
+			while (!_pathHeap.empty()) {
+				int sector = popPathNode();
+				const PathNode &node = _pathNodes[sector];
 
-				if (sector == endSec) {
-					PathNode *n = closedList.back();
+				if (sector == end) {
 					// Don't put the start position in the list, or else
 					// the first angle calculated in updateWalk() will be
 					// meaningless. The only node without parent is the start
 					// one.
-					while (n->parent) {
-						_path.push_back(n->pos);
-						n = n->parent;
-					}
-
+					for (int i = sector; _pathNodes[i].parent >= 0; i = _pathNodes[i].parent)
+						_path.push_back(_pathNodes[i].pos);
 					break;
 				}
 
-				for (Common::List<Sector *>::iterator i = sectors.begin(); i != sectors.end(); ++i) {
-					Sector *s = *i;
-					bool inClosed = false;
-					for (Common::List<PathNode *>::iterator j = closedList.begin(); j != closedList.end(); ++j) {
-						if ((*j)->sect == s) {
-							inClosed = true;
-							break;
-						}
-					}
-					if (inClosed)
+				const Common::Array<Set::SectorLink> &links = set->getSectorLinks(sector);
+				for (uint i = 0; i < links.size(); ++i) {
+					const Set::SectorLink &link = links[i];
+					PathNode &n = _pathNodes[link._sector];
+					if (n.heapPos == PathNodeClosed)
 						continue;
+					if (n.heapPos == PathNodeUnseen)
+						n.closestPoint = set->getSectorBase(link._sector)->getClosestPoint(_destPos);
 
-					Common::List<Math::Line3d> bridges = sector->getBridgesTo(s);
-					if (bridges.empty())
-						continue; // The sectors are not adjacent.
-
-					Math::Vector3d closestPoint = s->getClosestPoint(_destPos);
 					Math::Vector3d best;
 					float bestDist = 1e6f;
-					Math::Line3d l(node->pos, closestPoint);
-					while (!bridges.empty()) {
-						Math::Line3d bridge = bridges.back();
+					Math::Line3d l(node.pos, n.closestPoint);
+					for (int j = link._bridges.size() - 1; j >= 0; --j) {
+						Math::Line3d bridge = link._bridges[j];
 						Math::Vector3d pos;
 						if (!bridge.intersectLine2d(l, &pos)) {
 							pos = bridge.middle();
 						}
-						float dist = (pos - closestPoint).getMagnitude();
+						float dist = (pos - n.closestPoint).getMagnitude();
 						if (dist < bestDist) {
 							bestDist = dist;
 							best = pos;
 						}
-						bridges.pop_back();
 					}
-					best = handleCollisionTo(node->pos, best);
-
-					PathNode *n = NULL;
-					for (Common::List<PathNode *>::iterator j = openList.begin(); j != openList.end(); ++j) {
-						if ((*j)->sect == s) {
-							n = *j;
-							break;
-						}
-					}
-					if (n) {
-						float newCost = node->cost + (best - node->pos).getMagnitude();
-						if (newCost < n->cost) {
-							n->cost = newCost;
-							n->parent = node;
-							n->pos = best;
-							n->dist = (n->pos - _destPos).getMagnitude();
+					best = handleCollisionTo(node.pos, best);
+
+					if (n.heapPos >= 0) {
+						float newCost = node.cost + (best - node.pos).getMagnitude();
+						if (newCost < n.cost) {
+							n.cost = newCost;
+							n.parent = sector;
+							n.pos = best;
+							n.dist = (n.pos - _destPos).getMagnitude();
+							siftPathNode(n.heapPos);
 						}
 					} else {
-						n = new PathNode;
-						n->parent = node;
-						n->sect = s;
-						n->pos = best;
-						n->dist = (n->pos - _destPos).getMagnitude();
-						n->cost = node->cost + (n->pos - node->pos).getMagnitude();
-						openList.push_back(n);
+						n.parent = sector;
+						n.pos = best;
+						n.dist = (n.pos - _destPos).getMagnitude();
+						n.cost = node.cost + (n.pos - node.pos).getMagnitude();
+						pushPathNode(link._sector);
 					}
 				}
-			} while (!openList.empty());
-
-			for (Common::List<PathNode *>::iterator j = closedList.begin(); j != closedList.end(); ++j) {
-				delete *j;
-			}
-			for (Common::List<PathNode *>::iterator j = openList.begin(); j != openList.end(); ++j) {
-				delete *j;
 			}
 		}
 
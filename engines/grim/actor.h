@@ -23,6 +23,8 @@
 #ifndef GRIM_ACTOR_H
 #define GRIM_ACTOR_H
 
+#include "common/array.h"
+
 #include "engines/grim/pool.h"
 #include "engines/grim/object.h"
 #include "math/vector3d.h"
@@ -458,6 +460,9 @@ private:
 	bool shouldDrawShadow(int shadowId);
 	void stopTalking();
 	bool stopMumbleChore();
+	void pushPathNode(int sector);
+	int popPathNode();
+	void siftPathNode(int heapPos);
 	/**
 	 * Given a start point and a destination this function returns a position
 	 * that doesn't collide with any actor.
@@ -555,14 +560,24 @@ private:
 	// lookAt
 	Math::Vector3d _lookAtVector;
 
-	// struct used for path finding
+	// struct used for path finding, one per sector of the set
 	struct PathNode {
-		Sector *sect;
-		PathNode *parent;
+		int parent;			// sector walked from, or -1 for the start
+		int heapPos;		// position in _pathHeap if open, or PathNodeState
 		Math::Vector3d pos;
+		Math::Vector3d closestPoint;	// of the sector to the destination
 		float dist;
 		float cost;
+
+		float estimate() const { return dist + cost; }
+	};
+	enum PathNodeState {
+		PathNodeUnseen = -1,
+		PathNodeClosed = -2
 	};
+	// kept from a walk to the next to avoid reallocating them
+	Common::Array<PathNode> _pathNodes;
+	Common::Array<int> _pathHeap;		// open sectors, by lowest estimate
 	Common::List<Math::Vector3d> _path;
 
 	CollisionMode _collisionMode;
@@ -0,0 +1,60 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#include "engines/grim/debugger.h"
+#include "engines/grim/resource.h"
+
+namespace Grim {
+
+Debugger::Debugger() : GUI::Debugger() {
+	DCmd_Register("cache", WRAP_METHOD(Debugger, Cmd_Cache));
+	DCmd_Register("resources", WRAP_METHOD(Debugger, Cmd_Resources));
+}
+
+Debugger::~Debugger() {
+}
+
+bool Debugger::Cmd_Cache(int argc, const char **argv) {
+	if (argc > 2) {
+		DebugPrintf("Usage: %s [budget in KB]\n", argv[0]);
+		return true;
+	}
+	if (argc == 2)
+		g_resourceloader->setCacheBudget(atoi(argv[1]) * 1024);
+
+	ResourceLoader::CacheStats stats = g_resourceloader->getCacheStats();
+	DebugPrintf("Resource cache: %d files, %d of %d KB\n", stats.entries, stats.memorySize / 1024, stats.budget / 1024);
+	DebugPrintf("%d hits, %d misses, %d evictions\n", stats.hits, stats.misses, stats.evictions);
+	return true;
+}
+
+bool Debugger::Cmd_Resources(int argc, const char **argv) {
+	Common::Array<ResourceLoader::ResidentStats> stats;
+	g_resourceloader->getResidentStats(stats);
+
+	DebugPrintf("Resident resources:\n");
+	for (uint i = 0; i < stats.size(); ++i)
+		DebugPrintf("  %-10s %5d, %6d KB\n", stats[i].type, stats[i].count, stats[i].bytes / 1024);
+	return true;
+}
+
+} // end of namespace Grim
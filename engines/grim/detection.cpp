@@ -30,6 +30,8 @@
 #include "common/system.h"
 #include "common/savefile.h"
 
+#include "graphics/surface.h"
+
 namespace Grim {
 
 struct GrimGameDescription {
@@ -424,6 +426,8 @@ public:
 	virtual bool hasFeature(MetaEngineFeature f) const;
 
 	virtual SaveStateList listSaves(const char *target) const;
+	virtual void removeSaveState(const char *target, int slot) const;
+	virtual SaveStateDescriptor querySaveMetaInfos(const char *target, int slot) const;
 };
 
 bool GrimMetaEngine::createInstance(OSystem *syst, Engine **engine, const ADGameDescription *desc) const {
@@ -438,7 +442,16 @@ bool GrimMetaEngine::createInstance(OSystem *syst, Engine **engine, const ADGame
 bool GrimMetaEngine::hasFeature(MetaEngineFeature f) const {
 	return
 		(f == kSupportsListSaves) ||
-		(f == kSupportsLoadingDuringStartup);
+		(f == kSupportsLoadingDuringStartup) ||
+		(f == kSupportsDeleteSave) ||
+		(f == kSavesSupportMetaInfo) ||
+		(f == kSavesSupportThumbnail) ||
+		(f == kSavesSupportCreationDate) ||
+		(f == kSavesSupportPlayTime);
+}
+
+static Common::String saveFileName(int slot) {
+	return Common::String::format(slot < 100 ? "grim%02d.gsv" : "grim%d.gsv", slot);
 }
 
 static bool cmpSave(const SaveStateDescriptor &x, const SaveStateDescriptor &y) {
@@ -449,40 +462,64 @@ static bool cmpSave(const SaveStateDescriptor &x, const SaveStateDescriptor &y)
 SaveStateList GrimMetaEngine::listSaves(const char *target) const {
 	Common::SaveFileManager *saveFileMan = g_system->getSavefileManager();
 	Common::StringArray filenames;
-	Common::String saveDesc;
 	Common::String pattern = "grim*.gsv";
 
 	filenames = saveFileMan->listSavefiles(pattern);
 
+	Common::Array<SaveGameHeader> headers;
+	SaveGameIndex::getHeaders(filenames, headers);
+
 	SaveStateList saveList;
-	char str[256];
-	int32 strSize;
-	for (Common::StringArray::const_iterator file = filenames.begin(); file != filenames.end(); ++file) {
+	for (uint i = 0; i < filenames.size(); ++i) {
 		// Obtain the last digits of the filename, since they correspond to the save slot
-		int slotNum = atoi(file->c_str() + 4);
-
-		if (slotNum >= 0) {
-			SaveGame *savedState = SaveGame::openForLoading(*file);
-			if (savedState) {
-				if (savedState->saveVersion() != SaveGame::SAVEGAME_VERSION) {
-					delete savedState;
-					continue;
-				}
-				savedState->beginSection('SUBS');
-				strSize = savedState->readLESint32();
-				savedState->read(str, strSize);
-				saveDesc = str;
-				saveList.push_back(SaveStateDescriptor(slotNum, saveDesc));
-				delete savedState;
-			}
+		int slotNum = atoi(filenames[i].c_str() + 4);
 
-		}
+		if (slotNum >= 0 && headers[i].version == SaveGame::SAVEGAME_VERSION)
+			saveList.push_back(SaveStateDescriptor(slotNum, headers[i].description));
 	}
 
 	Common::sort(saveList.begin(), saveList.end(), cmpSave);
 	return saveList;
 }
 
+void GrimMetaEngine::removeSaveState(const char *target, int slot) const {
+	Common::String filename = saveFileName(slot);
+	g_system->getSavefileManager()->removeSavefile(filename);
+	SaveGameIndex::remove(filename);
+}
+
+SaveStateDescriptor GrimMetaEngine::querySaveMetaInfos(const char *target, int slot) const {
+	SaveGameHeader header;
+	if (!SaveGame::readHeader(saveFileName(slot), header, true) || header.version != SaveGame::SAVEGAME_VERSION)
+		return SaveStateDescriptor();
+
+	SaveStateDescriptor desc(slot, header.description);
+	desc.setDeletableFlag(true);
+	desc.setWriteProtectedFlag(false);
+	desc.setSaveDate(header.year, header.month, header.day);
+	desc.setSaveTime(header.hour, header.minute);
+	desc.setPlayTime(header.playTime);
+
+	if (!header.thumbnail.empty()) {
+		// The launcher draws the thumbnails in the overlay format
+		const Graphics::PixelFormat format = g_system->getOverlayFormat();
+		Graphics::Surface *thumbnail = new Graphics::Surface();
+		thumbnail->create(header.thumbnailWidth, header.thumbnailHeight, format);
+		const uint16 *src = &header.thumbnail[0];
+		uint16 *dst = (uint16 *)thumbnail->pixels;
+		for (int i = 0; i < header.thumbnailWidth * header.thumbnailHeight; i++) {
+			const uint16 pixel = src[i];
+			const byte r = ((pixel >> 11) << 3) | (pixel >> 13);
+			const byte g = (((pixel >> 5) & 0x3f) << 2) | ((pixel >> 9) & 0x3);
+			const byte b = ((pixel & 0x1f) << 3) | ((pixel >> 2) & 0x7);
+			dst[i] = format.RGBToColor(r, g, b);
+		}
+		desc.setThumbnail(thumbnail);
+	}
+
+	return desc;
+}
+
 } // End of namespace Grim
 
 #if PLUGIN_ENABLED_DYNAMIC(GRIM)
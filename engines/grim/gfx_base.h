@@ -46,6 +46,7 @@ class EMIMeshFace;
 class ModelNode;
 class Mesh;
 class MeshFace;
+struct MeshBatch;
 struct Sprite;
 class Light;
 class Texture;
@@ -110,7 +111,7 @@ public:
 	virtual void translateViewpointFinish() = 0;
 
 	virtual void drawEMIModelFace(const EMIModel* model, const EMIMeshFace* face) = 0;
-	virtual void drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts) = 0;
+	virtual void drawMeshBatch(const Mesh *mesh, const MeshBatch &batch) = 0;
 	virtual void drawSprite(const Sprite *sprite) = 0;
 
 	virtual void enableLights() = 0;
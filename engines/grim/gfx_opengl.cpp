@@ -459,22 +459,21 @@ void GfxOpenGL::drawEMIModelFace(const EMIModel* model, const EMIMeshFace* face)
 	glColor3f(1.0f,1.0f,1.0f);
 }
 	
-void GfxOpenGL::drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts) {
+void GfxOpenGL::drawMeshBatch(const Mesh *mesh, const MeshBatch &batch) {
 	// Support transparency in actor objects, such as the message tube
 	// in Manny's Office
 	glAlphaFunc(GL_GREATER, 0.5);
 	glEnable(GL_ALPHA_TEST);
-	glNormal3fv(face->_normal.getData());
-	glBegin(GL_POLYGON);
-	for (int i = 0; i < face->_numVertices; i++) {
-		glNormal3fv(vertNormals + 3 * face->_vertices[i]);
-
-		if (face->_texVertices)
-			glTexCoord2fv(textureVerts + 2 * face->_texVertices[i]);
-
-		glVertex3fv(vertices + 3 * face->_vertices[i]);
-	}
-	glEnd();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, mesh->_drawVertices);
+	glNormalPointer(GL_FLOAT, 0, mesh->_drawNormals);
+	glTexCoordPointer(2, GL_FLOAT, 0, mesh->_drawTextureVerts);
+	glDrawElements(GL_TRIANGLES, batch._numIndices, GL_UNSIGNED_INT, mesh->_drawIndices + batch._firstIndex);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	// Done with transparency-capable objects
 	glDisable(GL_ALPHA_TEST);
 }
@@ -20,6 +20,7 @@
  *
  */
 
+#include "common/config-manager.h"
 #include "common/endian.h"
 #include "common/system.h"
 
@@ -172,6 +173,8 @@ byte *GfxTinyGL::setupScreen(int screenW, int screenH, bool fullscreen) {
 
 	_zb = TinyGL::ZB_open(screenW, screenH, ZB_MODE_5R6G5B, buffer);
 	TinyGL::glInit(_zb);
+	TinyGL::ZB_setRasterThreads(_zb, ConfMan.getInt("soft_renderer_threads"));
+	TinyGL::ZB_selectSpans(ConfMan.getBool("soft_renderer_simd"));
 
 	_storedDisplay = new byte[640 * 480 * 2];
 	memset(_storedDisplay, 0, 640 * 480 * 2);
@@ -211,12 +214,15 @@ void GfxTinyGL::positionCamera(Math::Vector3d pos, Math::Vector3d interest) {
 }
 
 void GfxTinyGL::clearScreen() {
+	tglFlush();
 	memset(_zb->pbuf, 0, 640 * 480 * 2);
 	memset(_zb->zbuf, 0, 640 * 480 * 2);
 	memset(_zb->zbuf2, 0, 640 * 480 * 4);
+	TinyGL::ZB_updateTiles(_zb, 0, 0, 640, 480);
 }
 
 void GfxTinyGL::flipBuffer() {
+	tglFlush();
 	g_system->updateScreen();
 }
 
@@ -494,18 +500,17 @@ void GfxTinyGL::drawEMIModelFace(const EMIModel* model, const EMIMeshFace* face)
 	tglEnable(TGL_ALPHA_TEST);	
 }
 	
-void GfxTinyGL::drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts) {
-	tglNormal3fv(const_cast<float *>(face->_normal.getData()));
-	tglBegin(TGL_POLYGON);
-	for (int i = 0; i < face->_numVertices; i++) {
-		tglNormal3fv(vertNormals + 3 * face->_vertices[i]);
-
-		if (face->_texVertices)
-			tglTexCoord2fv(textureVerts + 2 * face->_texVertices[i]);
-
-		tglVertex3fv(vertices + 3 * face->_vertices[i]);
-	}
-	tglEnd();
+void GfxTinyGL::drawMeshBatch(const Mesh *mesh, const MeshBatch &batch) {
+	tglEnableClientState(TGL_VERTEX_ARRAY);
+	tglEnableClientState(TGL_NORMAL_ARRAY);
+	tglEnableClientState(TGL_TEXTURE_COORD_ARRAY);
+	tglVertexPointer(3, TGL_FLOAT, 0, mesh->_drawVertices);
+	tglNormalPointer(TGL_FLOAT, 0, mesh->_drawNormals);
+	tglTexCoordPointer(2, TGL_FLOAT, 0, mesh->_drawTextureVerts);
+	tglDrawElements(TGL_TRIANGLES, batch._numIndices, TGL_UNSIGNED_INT, mesh->_drawIndices + batch._firstIndex);
+	tglDisableClientState(TGL_VERTEX_ARRAY);
+	tglDisableClientState(TGL_NORMAL_ARRAY);
+	tglDisableClientState(TGL_TEXTURE_COORD_ARRAY);
 }
 
 void GfxTinyGL::drawSprite(const Sprite *sprite) {
@@ -698,12 +703,15 @@ void GfxTinyGL::drawBitmap(const Bitmap *bitmap) {
 	}
 
 	assert(bitmap->getActiveImage() > 0);
+	tglFlush();
 	if (bitmap->getFormat() == 1)
 		TinyGLBlit((byte *)_zb->pbuf, (byte *)bitmap->getData(bitmap->getActiveImage() - 1),
 			bitmap->getX(), bitmap->getY(), bitmap->getWidth(), bitmap->getHeight(), true);
-	else
+	else {
 		TinyGLBlit((byte *)_zb->zbuf, (byte *)bitmap->getData(bitmap->getActiveImage() - 1),
 			bitmap->getX(), bitmap->getY(), bitmap->getWidth(), bitmap->getHeight(), false);
+		TinyGL::ZB_updateTiles(_zb, bitmap->getX(), bitmap->getY(), bitmap->getWidth(), bitmap->getHeight());
+	}
 }
 
 void GfxTinyGL::destroyBitmap(BitmapData *) { }
@@ -791,6 +799,7 @@ void GfxTinyGL::createTextObject(TextObject *text) {
 }
 
 void GfxTinyGL::drawTextObject(TextObject *text) {
+	tglFlush();
 	TextObjectData *userData = (TextObjectData *)text->getUserData();
 	if (userData) {
 		int numLines = text->getNumLines();
@@ -866,6 +875,7 @@ void GfxTinyGL::prepareMovieFrame(Graphics::Surface* frame) {
 }
 
 void GfxTinyGL::drawMovieFrame(int offsetX, int offsetY) {
+	tglFlush();
 	if (_smushWidth == 640 && _smushHeight == 480) {
 		memcpy(_zb->pbuf, _smushBitmap, 640 * 480 * 2);
 	} else {
@@ -880,6 +890,7 @@ void GfxTinyGL::loadEmergFont() {
 }
 
 void GfxTinyGL::drawEmergString(int x, int y, const char *text, const Color &fgColor) {
+	tglFlush();
 	uint16 color = ((fgColor.getRed() & 0xF8) << 8) | ((fgColor.getGreen() & 0xFC) << 3) | (fgColor.getBlue() >> 3);
 
 	for (int l = 0; l < (int)strlen(text); l++) {
@@ -936,10 +947,12 @@ Bitmap *GfxTinyGL::getScreenshot(int w, int h) {
 }
 
 void GfxTinyGL::storeDisplay() {
+	tglFlush();
 	memcpy(_storedDisplay, _zb->pbuf, 640 * 480 * 2);
 }
 
 void GfxTinyGL::copyStoredToDisplay() {
+	tglFlush();
 	memcpy(_zb->pbuf, _storedDisplay, 640 * 480 * 2);
 }
 
@@ -956,6 +969,7 @@ void GfxTinyGL::dimScreen() {
 }
 
 void GfxTinyGL::dimRegion(int x, int y, int w, int h, float level) {
+	tglFlush();
 	uint16 *data = (uint16 *)_zb->pbuf;
 	for (int ly = y; ly < y + h; ly++) {
 		for (int lx = x; lx < x + w; lx++) {
@@ -970,6 +984,7 @@ void GfxTinyGL::dimRegion(int x, int y, int w, int h, float level) {
 }
 
 void GfxTinyGL::irisAroundRegion(int x1, int y1, int x2, int y2) {
+	tglFlush();
 	uint16 *data = (uint16 *)_zb->pbuf;
 	for (int ly = 0; ly < _screenHeight; ly++) {
 		for (int lx = 0; lx < _screenWidth; lx++) {
@@ -983,6 +998,7 @@ void GfxTinyGL::irisAroundRegion(int x1, int y1, int x2, int y2) {
 }
 
 void GfxTinyGL::drawRectangle(PrimitiveObject *primitive) {
+	tglFlush();
 	uint16 *dst = (uint16 *)_zb->pbuf;
 	int x1 = primitive->getP1().x;
 	int y1 = primitive->getP1().y;
@@ -1019,6 +1035,7 @@ void GfxTinyGL::drawRectangle(PrimitiveObject *primitive) {
 }
 
 void GfxTinyGL::drawLine(PrimitiveObject *primitive) {
+	tglFlush();
 	uint16 *dst = (uint16 *)_zb->pbuf;
 	int x1 = primitive->getP1().x;
 	int y1 = primitive->getP1().y;
@@ -1045,6 +1062,7 @@ void GfxTinyGL::drawLine(PrimitiveObject *primitive) {
 }
 
 void GfxTinyGL::drawPolygon(PrimitiveObject *primitive) {
+	tglFlush();
 	uint16 *dst = (uint16 *)_zb->pbuf;
 	int x1 = primitive->getP1().x;
 	int y1 = primitive->getP1().y;
@@ -70,7 +70,7 @@ public:
 	void translateViewpointFinish();
 
 	void drawEMIModelFace(const EMIModel* model, const EMIMeshFace* face);
-	void drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts);
+	void drawMeshBatch(const Mesh *mesh, const MeshBatch &batch);
 	void drawSprite(const Sprite *sprite);
 
 	void enableLights();
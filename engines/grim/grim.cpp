@@ -49,6 +49,7 @@
 #include "engines/engine.h"
 
 #include "engines/grim/debug.h"
+#include "engines/grim/debugger.h"
 #include "engines/grim/grim.h"
 #include "engines/grim/lua.h"
 #include "engines/grim/lua_v1.h"
@@ -56,6 +57,7 @@
 #include "engines/grim/actor.h"
 #include "engines/grim/movie/movie.h"
 #include "engines/grim/savegame.h"
+#include "engines/grim/savewriter.h"
 #include "engines/grim/registry.h"
 #include "engines/grim/resource.h"
 #include "engines/grim/localize.h"
@@ -132,6 +134,7 @@ GrimEngine::GrimEngine(OSystem *syst, uint32 gameFlags, GrimGameType gameType, C
 	_refreshDrawNeeded = true;
 	_listFilesIter = NULL;
 	_savedState = NULL;
+	_saveWriter = new SaveGameWriter();
 	_fps[0] = 0;
 	_iris = new Iris();
 
@@ -170,11 +173,18 @@ GrimEngine::GrimEngine(OSystem *syst, uint32 gameFlags, GrimGameType gameType, C
 	SearchMan.addSubDirectoryMatching(gameDataDir, "credits");
 
 	Debug::registerDebugChannels();
+
+	_debugger = new Debugger();
 }
 
 GrimEngine::~GrimEngine() {
+	_saveWriter->flush();
+	collectWrittenSaves(false);
+	delete _saveWriter;
+
 	delete[] _controlsEnabled;
 	delete[] _controlsState;
+	delete _debugger;
 
 	Set::getPool().deleteObjects();
 	Actor::getPool().deleteObjects();
@@ -617,6 +627,7 @@ void GrimEngine::mainLoop() {
 		if (_savegameSaveRequest) {
 			savegameSave();
 		}
+		collectWrittenSaves(true);
 
 		g_imuse->flushTracks();
 		g_imuse->refreshScripts();
@@ -627,6 +638,11 @@ void GrimEngine::mainLoop() {
 			// Handle any buttons, keys and joystick operations
 			Common::EventType type = event.type;
 			if (type == Common::EVENT_KEYDOWN) {
+				if ((event.kbd.flags & Common::KBD_CTRL) && event.kbd.keycode == Common::KEYCODE_d) {
+					_debugger->attach();
+					_debugger->onFrame();
+					continue;
+				}
 				if (_mode != DrawMode && _mode != SmushMode && (event.kbd.ascii == 'q')) {
 					handleExit();
 					break;
@@ -676,6 +692,10 @@ void GrimEngine::mainLoop() {
 	}
 }
 
+GUI::Debugger *GrimEngine::getDebugger() {
+	return _debugger;
+}
+
 void GrimEngine::saveGame(const Common::String &file) {
 	_savegameFileName = file;
 	_savegameSaveRequest = true;
@@ -686,6 +706,10 @@ void GrimEngine::loadGame(const Common::String &file) {
 	_savegameLoadRequest = true;
 }
 
+void GrimEngine::waitForSaveGames() {
+	_saveWriter->flush();
+}
+
 void GrimEngine::savegameRestore() {
 	debug("GrimEngine::savegameRestore() started.");
 	_savegameLoadRequest = false;
@@ -695,9 +719,11 @@ void GrimEngine::savegameRestore() {
 	} else {
 		filename = _savegameFileName;
 	}
+	_saveWriter->flush();
 	_savedState = SaveGame::openForLoading(filename);
 	if (!_savedState || _savedState->saveVersion() != SaveGame::SAVEGAME_VERSION)
 		return;
+	setTotalPlayTime(_savedState->getHeader().playTime);
 	g_imuse->stopAllSounds();
 	g_imuse->resetState();
 	g_movie->stop();
@@ -792,6 +818,32 @@ void GrimEngine::restoreGRIM() {
 	_savedState->endSection();
 }
 
+/**
+ * Shrinks an RGB565 screenshot to the thumbnail size, averaging the source
+ * pixels which fall in each thumbnail pixel.
+ */
+static void scaleThumbnail(const uint16 *src, int width, int height, uint16 *dst) {
+	for (int y = 0; y < kThumbnailHeight; y++) {
+		const int y0 = y * height / kThumbnailHeight;
+		const int y1 = MAX(y0 + 1, (y + 1) * height / kThumbnailHeight);
+		for (int x = 0; x < kThumbnailWidth; x++) {
+			const int x0 = x * width / kThumbnailWidth;
+			const int x1 = MAX(x0 + 1, (x + 1) * width / kThumbnailWidth);
+			uint32 r = 0, g = 0, b = 0;
+			for (int sy = y0; sy < y1; sy++) {
+				for (int sx = x0; sx < x1; sx++) {
+					const uint16 pixel = src[sy * width + sx];
+					r += pixel >> 11;
+					g += (pixel >> 5) & 0x3f;
+					b += pixel & 0x1f;
+				}
+			}
+			const uint32 count = (y1 - y0) * (x1 - x0);
+			*dst++ = ((r / count) << 11) | ((g / count) << 5) | (b / count);
+		}
+	}
+}
+
 void GrimEngine::storeSaveGameImage(SaveGame *state) {
 	int width = 250, height = 188;
 	Bitmap *screenshot;
@@ -809,9 +861,16 @@ void GrimEngine::storeSaveGameImage(SaveGame *state) {
 		int size = screenshot->getWidth() * screenshot->getHeight();
 		screenshot->setActiveImage(0);
 		uint16 *data = (uint16 *)screenshot->getData();
+#ifdef SCUMM_LITTLE_ENDIAN
+		state->write(data, size * 2);
+#else
 		for (int l = 0; l < size; l++) {
 			state->writeLEUint16(data[l]);
 		}
+#endif
+		uint16 thumbnail[kThumbnailWidth * kThumbnailHeight];
+		scaleThumbnail(data, screenshot->getWidth(), screenshot->getHeight(), thumbnail);
+		state->setThumbnail(thumbnail, kThumbnailWidth, kThumbnailHeight);
 	} else {
 		error("Unable to store screenshot");
 	}
@@ -829,13 +888,10 @@ void GrimEngine::savegameSave() {
 	} else {
 		strcpy(filename, _savegameFileName.c_str());
 	}
+	// The file is created by the writer, after any earlier savegame to it
 	_savedState = SaveGame::openForSaving(filename);
-	if (!_savedState) {
-		//TODO: Translate this!
-		GUI::displayErrorDialog("Error: the game could not be saved.");
-		return;
-	}
 
+	_savedState->setPlayTime(getTotalPlayTime());
 	storeSaveGameImage(_savedState);
 
 	g_imuse->pause(true);
@@ -884,7 +940,10 @@ void GrimEngine::savegameSave() {
 
 	lua_Save(_savedState);
 
-	delete _savedState;
+	// Only the compression and the writing are left, which go on in the
+	// background
+	_saveWriter->write(_savedState, filename);
+	_savedState = NULL;
 
 	g_imuse->pause(false);
 	g_movie->pause(false);
@@ -894,6 +953,30 @@ void GrimEngine::savegameSave() {
 	clearEventQueue();
 }
 
+void GrimEngine::collectWrittenSaves(bool notify) {
+	Common::List<SaveGameWriter::Result> results;
+	_saveWriter->collect(results);
+	for (Common::List<SaveGameWriter::Result>::iterator i = results.begin(); i != results.end(); ++i) {
+		if (!i->ok) {
+			warning("GrimEngine::collectWrittenSaves() Can't write file %s. (Disk full?)", i->filename.c_str());
+			//TODO: Translate this!
+			if (notify)
+				GUI::displayErrorDialog("Error: the game could not be saved.");
+		}
+		SaveGameIndex::update(i->filename);
+
+		if (notify) {
+			LuaObjects objects;
+			objects.add(i->filename.c_str());
+			if (i->ok)
+				objects.add(1);
+			else
+				objects.addNil();
+			LuaBase::instance()->callback("saveGameWritten", objects);
+		}
+	}
+}
+
 void GrimEngine::saveGRIM() {
 	_savedState->beginSection('GRIM');
 
@@ -959,7 +1042,7 @@ Set *GrimEngine::loadSet(const Common::String &name) {
 			filename += "b";
 		}
 		Common::SeekableReadStream *stream;
-		stream = g_resourceloader->openNewStreamFile(filename.c_str());
+		stream = g_resourceloader->openNewStreamFile(filename.c_str(), true);
 		if(!stream)
 			warning("Could not find scene file %s", name.c_str());
 
@@ -969,6 +1052,17 @@ Set *GrimEngine::loadSet(const Common::String &name) {
 	return s;
 }
 
+void GrimEngine::prefetchSet(const Common::String &name) {
+	if (findSet(name))
+		return;
+
+	Common::String filename(name);
+	if (g_grim->getGameType() == GType_MONKEY4) {
+		filename += "b";
+	}
+	g_resourceloader->prefetchSet(filename);
+}
+
 void GrimEngine::setSet(const char *name) {
 	setSet(loadSet(name));
 }
@@ -37,6 +37,7 @@ namespace Grim {
 
 class Actor;
 class SaveGame;
+class SaveGameWriter;
 class Bitmap;
 class Font;
 class Color;
@@ -44,6 +45,7 @@ class ObjectState;
 class Set;
 class TextObject;
 class PrimitiveObject;
+class Debugger;
 
 enum GrimGameType {
 	GType_GRIM,
@@ -81,6 +83,8 @@ public:
 	GrimEngine(OSystem *syst, uint32 gameFlags, GrimGameType gameType, Common::Platform platform, Common::Language language);
 	virtual ~GrimEngine();
 
+	GUI::Debugger *getDebugger();
+
 	int getGameFlags() { return _gameFlags; }
 	GrimGameType getGameType() { return _gameType; }
 	Common::Language getGameLanguage() { return _gameLanguage; }
@@ -129,6 +133,11 @@ public:
 	Set *findSet(const Common::String &name);
 	void setSetLock(const char *name, bool lockStatus);
 	Set *loadSet(const Common::String &name);
+	/**
+	 * Starts reading the files of a set which is not loaded yet in the
+	 * background, so that loading it later is quicker.
+	 */
+	void prefetchSet(const Common::String &name);
 	void setSet(const char *name);
 	void setSet(Set *scene);
 	Set *getCurrSet() { return _currSet; }
@@ -146,6 +155,8 @@ public:
 
 	void saveGame(const Common::String &file);
 	void loadGame(const Common::String &file);
+	/** Wait until the savegames being written in the background are done. */
+	void waitForSaveGames();
 
 	Common::StringArray _listFiles;
 	Common::StringArray::const_iterator _listFilesIter;
@@ -164,6 +175,7 @@ private:
 
 	void savegameSave();
 	void saveGRIM();
+	void collectWrittenSaves(bool notify);
 
 	void savegameRestore();
 	void restoreGRIM();
@@ -174,6 +186,7 @@ private:
 	bool _savegameSaveRequest;
 	Common::String _savegameFileName;
 	SaveGame *_savedState;
+	SaveGameWriter *_saveWriter;
 
 	Set *_currSet;
 	EngineMode _mode, _previousMode;
@@ -197,6 +210,8 @@ private:
 	bool *_controlsEnabled;
 	bool *_controlsState;
 
+	Debugger *_debugger;
+
 	Actor *_selectedActor;
 	Actor *_talkingActor;
 	Iris *_iris;
@@ -33,7 +33,6 @@
 
 #include "audio/audiostream.h"
 #include "audio/mixer.h"
-#include "audio/decoders/raw.h"
 
 namespace Grim {
 
@@ -80,6 +79,12 @@ Imuse::~Imuse() {
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		delete _track[l];
 	}
+	// the mixer does not own the streams, but may still be playing the
+	// end of some
+	for (uint i = 0; i < _streams.size(); i++) {
+		g_system->getMixer()->stopHandle(_streams[i]->getHandle());
+		delete _streams[i];
+	}
 	delete _sound;
 }
 
@@ -144,10 +149,7 @@ void Imuse::restoreState(SaveGame *savedState) {
 		if (channels == 2)
 			track->mixerFlags |= kFlagStereo | kFlagReverseStereo;
 
-		track->stream = Audio::makeQueuingAudioStream(freq, (track->mixerFlags & kFlagStereo) != 0);
-		g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1, track->getVol(),
-											track->getPan(), DisposeAfterUse::YES, false,
-											(track->mixerFlags & kFlagReverseStereo) != 0);
+		playTrackStream(track, freq);
 		g_system->getMixer()->pauseHandle(track->handle, true);
 	}
 	savedState->endSection();
@@ -189,21 +191,10 @@ void Imuse::saveState(SaveGame *savedState) {
 	savedState->endSection();
 }
 
-int32 Imuse::makeMixerFlags(int32 flags) {
-	int32 mixerFlags = 0;
-	if (flags & kFlagUnsigned)
-		mixerFlags |= Audio::FLAG_UNSIGNED;
-	if (flags & kFlag16Bits)
-		mixerFlags |= Audio::FLAG_16BITS;
-	if (flags & kFlagLittleEndian)
-		mixerFlags |= Audio::FLAG_LITTLE_ENDIAN;
-	if (flags & kFlagStereo)
-		mixerFlags |= Audio::FLAG_STEREO;
-	return mixerFlags;
-}
-
 void Imuse::callback() {
 	Common::StackLock lock(_mutex);
+	Audio::Mixer::ChannelVolume volumes[MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS];
+	uint numVolumes = 0;
 
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		Track *track = _track[l];
@@ -217,7 +208,7 @@ void Imuse::callback() {
 			}
 
 			if (_pause)
-				return;
+				break;
 
 			if (track->volFadeUsed) {
 				if (track->volFadeStep < 0) {
@@ -267,8 +258,6 @@ void Imuse::callback() {
 			}
 
 			assert(track->stream);
-			byte *data = NULL;
-			int32 result = 0;
 
 			if (track->curRegion == -1) {
 				switchToNextRegion(track);
@@ -292,7 +281,19 @@ void Imuse::callback() {
 				continue;
 
 			do {
-				result = _sound->getDataFromRegion(track->soundDesc, track->curRegion, &data, track->regionOffset, mixer_size);
+				// decode straight into the stream, as much as fits without
+				// wrapping around
+				uint32 space;
+				byte *data = track->stream->getWriteBuffer(space);
+				int32 size = MIN<int32>(mixer_size, space);
+				if (channels == 1)
+					size &= ~1;
+				if (channels == 2)
+					size &= ~3;
+				if (size == 0)	// the stream is full
+					break;
+
+				int32 result = _sound->getDataFromRegion(track->soundDesc, track->curRegion, data, track->regionOffset, size);
 				if (channels == 1) {
 					result &= ~1;
 				}
@@ -300,14 +301,13 @@ void Imuse::callback() {
 					result &= ~3;
 				}
 
-				if (result > mixer_size)
-					result = mixer_size;
+				if (result > size)
+					result = size;
 
 				if (g_system->getMixer()->isReady()) {
-					track->stream->queueBuffer(data, result, DisposeAfterUse::YES, makeMixerFlags(track->mixerFlags));
+					track->stream->commit(result);
 					track->regionOffset += result;
-				} else
-					delete[] data;
+				}
 
 				if (_sound->isEndOfRegion(track->soundDesc, track->curRegion)) {
 					switchToNextRegion(track);
@@ -317,12 +317,22 @@ void Imuse::callback() {
 				mixer_size -= result;
 				assert(mixer_size >= 0);
 			} while (mixer_size);
-			if (g_system->getMixer()->isReady()) {
-				g_system->getMixer()->setChannelVolume(track->handle, track->getVol());
-				g_system->getMixer()->setChannelBalance(track->handle, track->getPan());
+
+			if (g_system->getMixer()->isReady() &&
+					(track->getVol() != track->mixerVol || track->getPan() != track->mixerPan)) {
+				track->mixerVol = track->getVol();
+				track->mixerPan = track->getPan();
+				Audio::Mixer::ChannelVolume &v = volumes[numVolumes++];
+				v.handle = track->handle;
+				v.volume = track->mixerVol;
+				v.balance = track->mixerPan;
 			}
 		}
 	}
+
+	// set the volumes of all the tracks with one lock of the mixer
+	if (numVolumes)
+		g_system->getMixer()->setChannelVolumes(volumes, numVolumes);
 }
 
 void Imuse::switchToNextRegion(Track *track) {
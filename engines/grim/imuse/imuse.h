@@ -23,6 +23,7 @@
 #ifndef GRIM_IMUSE_H
 #define GRIM_IMUSE_H
 
+#include "common/array.h"
 #include "common/mutex.h"
 
 #include "engines/grim/imuse/imuse_track.h"
@@ -44,6 +45,7 @@ private:
 
 	Common::Mutex _mutex;
 	ImuseSndMgr *_sound;
+	Common::Array<ImuseStream *> _streams;	// all the track streams ever created
 
 	bool _pause;
 	bool _demo;
@@ -55,7 +57,6 @@ private:
 	const ImuseTable *_stateMusicTable;
 	const ImuseTable *_seqMusicTable;
 
-	int32 makeMixerFlags(int32 flags);
 	static void timerHandler(void *refConf);
 	void callback();
 	void switchToNextRegion(Track *track);
@@ -70,6 +71,8 @@ private:
 	void playMusic(const ImuseTable *table, int atribPos, bool sequence);
 
 	void flushTrack(Track *track);
+	void playTrackStream(Track *track, int freq);
+	ImuseStream *acquireStream(int freq, bool stereo);
 
 public:
 	Imuse(int fps, bool demo);
@@ -31,24 +31,221 @@ namespace Grim {
 
 uint16 imuseDestTable[5786];
 
-McmpMgr::McmpMgr() {
+McmpBlockCache::McmpBlockCache(uint32 budget, int blocksAhead) :
+		_budget(budget), _blocksAhead(blocksAhead), _thread(0), _memorySize(0),
+		_decoding(NULL), _cancelWaiting(0), _quit(false) {
+	if (_budget && _blocksAhead > 0 && _wake.isValid() && _decoded.isValid())
+		_thread = g_system->createThread(threadEntry, this);
+}
+
+McmpBlockCache::~McmpBlockCache() {
+	if (_thread) {
+		_mutex.lock();
+		_quit = true;
+		_mutex.unlock();
+		_wake.post();
+		g_system->joinThread(_thread);
+	}
+
+	for (Common::List<Block *>::iterator i = _lru.begin(); i != _lru.end(); ++i) {
+		delete[] (*i)->data;
+		delete *i;
+	}
+}
+
+bool McmpBlockCache::fetch(const Common::String &name, int block, byte *output, int32 &size) {
+	BlockKey key;
+	key._name = name;
+	key._block = block;
+
+	Common::StackLock lock(_mutex);
+	BlockMap::iterator i = _blocks.find(key);
+	if (i == _blocks.end())
+		return false;
+
+	Block *b = i->_value;
+	_lru.erase(b->lruPos);
+	_lru.push_front(b);
+	b->lruPos = _lru.begin();
+
+	memcpy(output, b->data, b->size);
+	size = b->size;
+	return true;
+}
+
+void McmpBlockCache::store(const Common::String &name, int block, const byte *data, int32 size) {
+	if (!_budget)
+		return;
+
+	BlockKey key;
+	key._name = name;
+	key._block = block;
+
+	Common::StackLock lock(_mutex);
+	insert(key, data, size);
+}
+
+void McmpBlockCache::insert(const BlockKey &key, const byte *data, int32 size) {
+	if (_blocks.contains(key))
+		return;
+
+	Block *b = new Block;
+	b->key = key;
+	b->data = new byte[size];
+	memcpy(b->data, data, size);
+	b->size = size;
+	_lru.push_front(b);
+	b->lruPos = _lru.begin();
+	_blocks[key] = b;
+	_memorySize += size;
+	trim();
+}
+
+void McmpBlockCache::trim() {
+	while (_memorySize > _budget && !_lru.empty()) {
+		Block *b = _lru.back();
+		_lru.pop_back();
+		_blocks.erase(b->key);
+		_memorySize -= b->size;
+		delete[] b->data;
+		delete b;
+	}
+}
+
+void McmpBlockCache::decodeAhead(McmpMgr *mgr, int first, int last) {
+	if (!_thread)
+		return;
+
+	BlockKey key;
+	key._name = mgr->getSoundName();
+
+	int queued = 0;
+	_mutex.lock();
+	for (int block = first; block <= last; block++) {
+		key._block = block;
+		if (_blocks.contains(key))
+			continue;
+
+		bool found = false;
+		for (Common::List<Request>::iterator i = _requests.begin(); i != _requests.end(); ++i) {
+			if (i->mgr == mgr && i->block == block) {
+				found = true;
+				break;
+			}
+		}
+		if (found)
+			continue;
+
+		Request r;
+		r.mgr = mgr;
+		r.block = block;
+		_requests.push_back(r);
+		queued++;
+	}
+	_mutex.unlock();
+
+	while (queued--)
+		_wake.post();
+}
+
+void McmpBlockCache::cancel(McmpMgr *mgr) {
+	if (!_thread)
+		return;
+
+	_mutex.lock();
+	for (Common::List<Request>::iterator i = _requests.begin(); i != _requests.end(); ) {
+		if (i->mgr == mgr)
+			i = _requests.erase(i);
+		else
+			++i;
+	}
+	while (_decoding == mgr) {
+		_cancelWaiting++;
+		_mutex.unlock();
+		_decoded.wait();
+		_mutex.lock();
+	}
+	_mutex.unlock();
+}
+
+int McmpBlockCache::threadEntry(void *param) {
+	static_cast<McmpBlockCache *>(param)->threadLoop();
+	return 0;
+}
+
+void McmpBlockCache::threadLoop() {
+	byte *input = NULL;
+	int32 inputSize = 0;
+	byte output[0x2000];
+
+	for (;;) {
+		_wake.wait();
+
+		Request r;
+		r.mgr = NULL;
+		BlockKey key;
+		_mutex.lock();
+		bool quit = _quit;
+		while (!quit && !_requests.empty()) {
+			r = _requests.front();
+			_requests.pop_front();
+			key._name = r.mgr->getSoundName();
+			key._block = r.block;
+			// a track may have decoded it itself in the meantime
+			if (!_blocks.contains(key))
+				break;
+			r.mgr = NULL;
+		}
+		_decoding = r.mgr;
+		_mutex.unlock();
+
+		if (quit)
+			break;
+		if (!r.mgr)
+			continue;
+
+		if (inputSize < r.mgr->getMaxCompSize()) {
+			delete[] input;
+			inputSize = r.mgr->getMaxCompSize();
+			input = new byte[inputSize];
+		}
+		int32 size = r.mgr->decodeBlock(r.block, input, output);
+
+		_mutex.lock();
+		insert(key, output, size);
+		_decoding = NULL;
+		for (; _cancelWaiting; _cancelWaiting--)
+			_decoded.post();
+		_mutex.unlock();
+	}
+
+	delete[] input;
+}
+
+McmpMgr::McmpMgr(McmpBlockCache *cache) {
 	_compTable = NULL;
 	_numCompItems = 0;
 	_curSample = -1;
+	_cache = cache;
 	_compInput = NULL;
+	_maxCompSize = 0;
 	_outputSize = 0;
 	_file = NULL;
 	_numCompItems = 0;
 	_lastBlock = -1;
+	_lastAheadBlock = -1;
 }
 
 McmpMgr::~McmpMgr() {
+	if (_cache)
+		_cache->cancel(this);
 	delete[] _compTable;
 	delete[] _compInput;
 }
 
 bool McmpMgr::openSound(const char *filename, Common::SeekableReadStream *data, int &offsetData) {
 	_file = data;
+	_soundName = filename;
 
 	uint32 tag = _file->readUint32BE();
 	if (tag != 'MCMP') {
@@ -83,13 +280,14 @@ bool McmpMgr::openSound(const char *filename, Common::SeekableReadStream *data,
 	}
 	_file->seek(sizeCodecs, SEEK_CUR);
 	// hack: two more bytes at the end of input buffer
+	_maxCompSize = maxSize;
 	_compInput = new byte[maxSize + 2];
 	offsetData = headerSize;
 
 	return true;
 }
 
-int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
+int32 McmpMgr::decompressSample(int32 offset, int32 size, byte *dest) {
 	int32 i, final_size, output_size;
 	int skip, first_block, last_block;
 
@@ -106,24 +304,11 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 	if ((last_block >= _numCompItems) && (_numCompItems > 0))
 		last_block = _numCompItems - 1;
 
-	int32 blocks_final_size = 0x2000 * (1 + last_block - first_block);
-	*comp_final = (byte *)malloc(blocks_final_size * sizeof(byte));
 	final_size = 0;
 
 	for (i = first_block; i <= last_block; i++) {
-		if (_lastBlock != i) {
-			// hack: two more zero bytes at the end of input buffer
-			_compInput[_compTable[i].compSize] = 0;
-			_compInput[_compTable[i].compSize + 1] = 0;
-			_file->seek(_compTable[i].offset, SEEK_SET);
-			_file->read(_compInput, _compTable[i].compSize);
-			decompressVima(_compInput, (int16 *)_compOutput, _compTable[i].decompSize, imuseDestTable);
-			_outputSize = _compTable[i].decompSize;
-			if (_outputSize > 0x2000) {
-				error("McmpMgr::decompressSample() _outputSize: %d", _outputSize);
-			}
-			_lastBlock = i;
-		}
+		if (_lastBlock != i)
+			loadBlock(i);
 
 		output_size = _outputSize - skip;
 
@@ -133,9 +318,7 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 		if (output_size > size)
 			output_size = size;
 
-		assert(final_size + output_size <= blocks_final_size);
-
-		memcpy(*comp_final + final_size, _compOutput + skip, output_size);
+		memcpy(dest + final_size, _compOutput + skip, output_size);
 		final_size += output_size;
 
 		size -= output_size;
@@ -149,4 +332,47 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 	return final_size;
 }
 
+void McmpMgr::loadBlock(int block) {
+	if (!_cache || !_cache->fetch(_soundName, block, _compOutput, _outputSize)) {
+		_outputSize = decodeBlock(block, _compInput, _compOutput);
+		if (_cache)
+			_cache->store(_soundName, block, _compOutput, _outputSize);
+	}
+	_lastBlock = block;
+}
+
+int32 McmpMgr::decodeBlock(int block, byte *input, byte *output) {
+	int32 outputSize = _compTable[block].decompSize;
+	if (outputSize > 0x2000) {
+		error("McmpMgr::decodeBlock() outputSize: %d", outputSize);
+	}
+
+	// hack: two more zero bytes at the end of input buffer
+	input[_compTable[block].compSize] = 0;
+	input[_compTable[block].compSize + 1] = 0;
+	_fileMutex.lock();
+	_file->seek(_compTable[block].offset, SEEK_SET);
+	_file->read(input, _compTable[block].compSize);
+	_fileMutex.unlock();
+	decompressVima(input, (int16 *)output, outputSize, imuseDestTable);
+
+	return outputSize;
+}
+
+void McmpMgr::decodeAhead(int32 offset, int32 end) {
+	if (!_cache || !_cache->getBlocksAhead() || offset >= end)
+		return;
+
+	int first = offset / 0x2000;
+	int last = MIN<int>((end - 1) / 0x2000, first + _cache->getBlocksAhead() - 1);
+	if (last >= _numCompItems)
+		last = _numCompItems - 1;
+	// the window only moves on once a block has been played through
+	if (last == _lastAheadBlock || first > last)
+		return;
+
+	_cache->decodeAhead(this, first, last);
+	_lastAheadBlock = last;
+}
+
 } // end of namespace Grim
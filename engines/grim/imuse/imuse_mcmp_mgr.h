@@ -23,8 +23,87 @@
 #ifndef GRIM_MCMP_MGR_H
 #define GRIM_MCMP_MGR_H
 
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/list.h"
+#include "common/mutex.h"
+#include "common/str.h"
+#include "common/system.h"
+#include "common/thread.h"
+
 namespace Grim {
 
+class McmpMgr;
+
+/**
+ * The decoded blocks of the compressed sounds, shared by all the tracks
+ * playing them and indexed by sound name and block number. The least
+ * recently used blocks are dropped once the budget is exceeded. If
+ * blocksAhead is not 0, a thread decodes the blocks the tracks are about to
+ * play before they need them.
+ */
+class McmpBlockCache {
+public:
+	McmpBlockCache(uint32 budget, int blocksAhead);
+	~McmpBlockCache();
+
+	int getBlocksAhead() const { return _thread ? _blocksAhead : 0; }
+
+	/** Copies a block to output if it is cached, and returns whether it was. */
+	bool fetch(const Common::String &name, int block, byte *output, int32 &size);
+	void store(const Common::String &name, int block, const byte *data, int32 size);
+	/** Queues the blocks first..last of a sound to be decoded in the background. */
+	void decodeAhead(McmpMgr *mgr, int first, int last);
+	/** Drops the queued blocks of a sound, waiting for the one being decoded. */
+	void cancel(McmpMgr *mgr);
+
+private:
+	struct BlockKey {
+		Common::String _name;
+		int _block;
+	};
+	struct BlockKey_Hash {
+		uint operator()(const BlockKey &k) const {
+			return Common::hashit(k._name) * 31 + k._block;
+		}
+	};
+	struct BlockKey_EqualTo {
+		bool operator()(const BlockKey &k1, const BlockKey &k2) const {
+			return k1._block == k2._block && k1._name == k2._name;
+		}
+	};
+	struct Block {
+		BlockKey key;
+		byte *data;
+		int32 size;
+		Common::List<Block *>::iterator lruPos;
+	};
+	struct Request {
+		McmpMgr *mgr;
+		int block;
+	};
+
+	static int threadEntry(void *param);
+	void threadLoop();
+	void insert(const BlockKey &key, const byte *data, int32 size);
+	void trim();
+
+	uint32 _budget;
+	int _blocksAhead;
+	OSystem::ThreadRef _thread;
+	Common::Semaphore _wake;
+	Common::Semaphore _decoded;	// posted for cancel() when a block is done
+	Common::Mutex _mutex;	// guards all of the following
+	typedef Common::HashMap<BlockKey, Block *, BlockKey_Hash, BlockKey_EqualTo> BlockMap;
+	BlockMap _blocks;
+	Common::List<Block *> _lru;	// most recently used first
+	uint32 _memorySize;
+	Common::List<Request> _requests;
+	McmpMgr *_decoding;		// whose block the thread is decoding
+	int _cancelWaiting;		// cancel() calls waiting for that block
+	bool _quit;
+};
+
 class McmpMgr {
 private:
 
@@ -39,18 +118,37 @@ private:
 	int16 _numCompItems;
 	int _curSample;
 	Common::SeekableReadStream *_file;
+	Common::Mutex _fileMutex;	// the cache thread reads _file too
+	Common::String _soundName;
+	McmpBlockCache *_cache;
 	byte _compOutput[0x2000];
 	byte *_compInput;
+	int32 _maxCompSize;
 	int _outputSize;
 	int _lastBlock;
+	int _lastAheadBlock;
+
+	void loadBlock(int block);
 
 public:
 
-	McmpMgr();
+	McmpMgr(McmpBlockCache *cache = NULL);
 	~McmpMgr();
 
 	bool openSound(const char *filename, Common::SeekableReadStream *data, int &offsetData);
-	int32 decompressSample(int32 offset, int32 size, byte **comp_final);
+	/** Decodes size bytes of the sound from offset to dest, and returns how many it got. */
+	int32 decompressSample(int32 offset, int32 size, byte *dest);
+	/**
+	 * Has the cache decode in the background the blocks following offset,
+	 * up to end.
+	 */
+	void decodeAhead(int32 offset, int32 end);
+
+	const Common::String &getSoundName() const { return _soundName; }
+	/** The size of the input buffer decodeBlock() needs. */
+	int32 getMaxCompSize() const { return _maxCompSize + 2; }
+	/** Decodes a block to output, which must hold 0x2000 bytes, and returns its size. */
+	int32 decodeBlock(int block, byte *input, byte *output);
 };
 
 } // end of namespace Grim
@@ -21,6 +21,7 @@
  */
 
 #include "common/endian.h"
+#include "common/config-manager.h"
 
 #include "engines/grim/resource.h"
 #include "engines/grim/colormap.h"
@@ -35,12 +36,15 @@ ImuseSndMgr::ImuseSndMgr(bool demo) {
 	for (int l = 0; l < MAX_IMUSE_SOUNDS; l++) {
 		memset(&_sounds[l], 0, sizeof(SoundDesc));
 	}
+	_blockCache = new McmpBlockCache(MAX(ConfMan.getInt("imuse_cache_size"), 0) * 1024,
+	                                 ConfMan.getInt("imuse_blocks_ahead"));
 }
 
 ImuseSndMgr::~ImuseSndMgr() {
 	for (int l = 0; l < MAX_IMUSE_SOUNDS; l++) {
 		closeSound(&_sounds[l]);
 	}
+	delete _blockCache;
 }
 
 void ImuseSndMgr::countElements(SoundDesc *sound) {
@@ -198,7 +202,7 @@ ImuseSndMgr::SoundDesc *ImuseSndMgr::openSound(const char *soundName, int volGro
 		sound->headerSize = headerSize;
 	} else if (scumm_stricmp(extension, "wav") == 0 || scumm_stricmp(extension, "imc") == 0 ||
 			(_demo && scumm_stricmp(extension, "imu") == 0)) {
-		sound->mcmpMgr = new McmpMgr();
+		sound->mcmpMgr = new McmpMgr(_blockCache);
 		if (!sound->mcmpMgr->openSound(soundName, sound->inStream, headerSize)) {
 			closeSound(sound);
 			return NULL;
@@ -338,7 +342,7 @@ int ImuseSndMgr::getJumpFade(SoundDesc *sound, int number) {
 	return sound->jump[number].fadeDelay;
 }
 
-int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte **buf, int32 offset, int32 size) {
+int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte *buf, int32 offset, int32 size) {
 	assert(checkForProperHandle(sound));
 	assert(buf && offset >= 0 && size >= 0);
 	assert(region >= 0 && region < sound->numRegions);
@@ -355,10 +359,10 @@ int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte **buf, i
 
 	if (sound->mcmpData) {
 		size = sound->mcmpMgr->decompressSample(region_offset + offset, size, buf);
+		sound->mcmpMgr->decodeAhead(region_offset + offset + size, region_offset + region_length);
 	} else {
-		*buf = (byte *)malloc(sizeof(byte) * size);
 		sound->inStream->seek(region_offset + offset + sound->headerSize, SEEK_SET);
-		sound->inStream->read(*buf, size);
+		sound->inStream->read(buf, size);
 	}
 
 	return size;
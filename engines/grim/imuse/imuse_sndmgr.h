@@ -29,6 +29,7 @@
 namespace Grim {
 
 class McmpMgr;
+class McmpBlockCache;
 
 class ImuseSndMgr {
 public:
@@ -82,6 +83,7 @@ public:
 private:
 
 	SoundDesc _sounds[MAX_IMUSE_SOUNDS];
+	McmpBlockCache *_blockCache;
 	bool _demo;
 
 	bool checkForProperHandle(SoundDesc *soundDesc);
@@ -111,7 +113,7 @@ public:
 	int getJumpHookId(SoundDesc *sound, int number);
 	int getJumpFade(SoundDesc *sound, int number);
 
-	int32 getDataFromRegion(SoundDesc *sound, int region, byte **buf, int32 offset, int32 size);
+	int32 getDataFromRegion(SoundDesc *sound, int region, byte *buf, int32 offset, int32 size);
 };
 
 } // end of namespace Grim
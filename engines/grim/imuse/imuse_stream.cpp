@@ -0,0 +1,99 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+
+#include "common/endian.h"
+#include "common/util.h"
+
+#include "engines/grim/imuse/imuse_stream.h"
+
+namespace Grim {
+
+ImuseStream::ImuseStream() :
+		_rate(0), _stereo(false), _readPos(0), _writePos(0), _finished(false) {
+	_buffer = new byte[kBufferSize];
+}
+
+ImuseStream::~ImuseStream() {
+	delete[] _buffer;
+}
+
+void ImuseStream::reset(int rate, bool stereo) {
+	Common::StackLock lock(_mutex);
+	_rate = rate;
+	_stereo = stereo;
+	_readPos = _writePos = 0;
+	_finished = false;
+}
+
+byte *ImuseStream::getWriteBuffer(uint32 &size) {
+	_mutex.lock();
+	uint32 pos = _writePos;
+	uint32 free = kBufferSize - (_writePos - _readPos);
+	_mutex.unlock();
+
+	pos &= kBufferSize - 1;
+	size = MIN<uint32>(free, kBufferSize - pos);
+	return _buffer + pos;
+}
+
+void ImuseStream::commit(uint32 size) {
+	Common::StackLock lock(_mutex);
+	assert(_writePos - _readPos + size <= (uint32)kBufferSize);
+	_writePos += size;
+}
+
+void ImuseStream::finish() {
+	Common::StackLock lock(_mutex);
+	_finished = true;
+}
+
+int ImuseStream::readBuffer(int16 *buffer, const int numSamples) {
+	_mutex.lock();
+	uint32 pos = _readPos;
+	uint32 available = (_writePos - _readPos) / 2;
+	_mutex.unlock();
+
+	// The track does not write over the queued data, so it can be read
+	// without holding the lock
+	int samples = MIN<uint32>(numSamples, available);
+	for (int i = 0; i < samples; i++, pos += 2)
+		buffer[i] = (int16)READ_BE_UINT16(_buffer + (pos & (kBufferSize - 1)));
+
+	_mutex.lock();
+	_readPos += samples * 2;
+	_mutex.unlock();
+
+	return samples;
+}
+
+bool ImuseStream::endOfData() const {
+	Common::StackLock lock(_mutex);
+	return _readPos == _writePos;
+}
+
+bool ImuseStream::endOfStream() const {
+	Common::StackLock lock(_mutex);
+	return _finished && _readPos == _writePos;
+}
+
+} // end of namespace Grim
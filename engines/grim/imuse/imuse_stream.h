@@ -0,0 +1,87 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+
+#ifndef GRIM_IMUSE_STREAM_H
+#define GRIM_IMUSE_STREAM_H
+
+#include "common/mutex.h"
+
+#include "audio/audiostream.h"
+#include "audio/mixer.h"
+
+namespace Grim {
+
+/**
+ * The output of a track: a ring buffer of 16-bit big endian samples which
+ * the track decodes into and the mixer plays from. The buffer is allocated
+ * once, and the streams are reused from one sound to the next, so feeding
+ * them allocates nothing.
+ */
+class ImuseStream : public Audio::AudioStream {
+public:
+	ImuseStream();
+	~ImuseStream();
+
+	/** Prepares the stream for a new sound, dropping any data left. */
+	void reset(int rate, bool stereo);
+
+	/**
+	 * Returns where the next bytes are to be written, size being set to how
+	 * many fit there without wrapping around. They are queued by commit().
+	 */
+	byte *getWriteBuffer(uint32 &size);
+	void commit(uint32 size);
+	/** Signals that no more data will be queued, so that the stream can end. */
+	void finish();
+
+	/** The handle the stream was last played with. */
+	Audio::SoundHandle &getHandle() { return _handle; }
+
+	// AudioStream API
+	int readBuffer(int16 *buffer, const int numSamples);
+	bool isStereo() const { return _stereo; }
+	int getRate() const { return _rate; }
+	bool endOfData() const;
+	bool endOfStream() const;
+
+private:
+	enum {
+		kBufferSize = 64 * 1024	// must be a power of two
+	};
+
+	byte *_buffer;
+	int _rate;
+	bool _stereo;
+	Audio::SoundHandle _handle;
+
+	// _readPos and _writePos only grow, the data is at their values modulo
+	// kBufferSize. The mixer moves _readPos and the track _writePos.
+	mutable Common::Mutex _mutex;	// guards the following
+	uint32 _readPos;
+	uint32 _writePos;
+	bool _finished;
+};
+
+} // end of namespace Grim
+
+#endif
@@ -137,15 +137,52 @@ bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int vo
 		track->regionOffset = otherTrack->regionOffset;
 	}
 
-	track->stream = Audio::makeQueuingAudioStream(freq, track->mixerFlags & kFlagStereo);
-	g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1,
-											track->getVol(), track->getPan(), DisposeAfterUse::YES,
-											false, (track->mixerFlags & kFlagReverseStereo) != 0);
+	playTrackStream(track, freq);
 	track->used = true;
 
 	return true;
 }
 
+/**
+ * Starts playing the output stream of a track, which must have its settings
+ * and sound.
+ */
+void Imuse::playTrackStream(Track *track, int freq) {
+	track->stream = acquireStream(freq, (track->mixerFlags & kFlagStereo) != 0);
+	track->mixerVol = track->getVol();
+	track->mixerPan = track->getPan();
+	g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1,
+											track->mixerVol, track->mixerPan, DisposeAfterUse::NO,
+											false, (track->mixerFlags & kFlagReverseStereo) != 0);
+	track->stream->getHandle() = track->handle;
+}
+
+/**
+ * Returns a stream no track uses and the mixer is done with, creating one
+ * only if there is none.
+ */
+ImuseStream *Imuse::acquireStream(int freq, bool stereo) {
+	ImuseStream *stream = NULL;
+	for (uint i = 0; i < _streams.size() && !stream; i++) {
+		stream = _streams[i];
+		for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
+			if (_track[l]->stream == stream) {
+				stream = NULL;
+				break;
+			}
+		}
+		if (stream && g_system->getMixer()->isSoundHandleActive(stream->getHandle()))
+			stream = NULL;
+	}
+
+	if (!stream) {
+		stream = new ImuseStream();
+		_streams.push_back(stream);
+	}
+	stream->reset(freq, stereo);
+	return stream;
+}
+
 Track *Imuse::findTrack(const char *soundName) {
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
 		Track *track = _track[l];
@@ -373,11 +410,8 @@ Track *Imuse::cloneToFadeOutTrack(Track *track, int fadeDelay) {
 	fadeTrack->volFadeStep = (fadeTrack->volFadeDest - fadeTrack->vol) * 60 * (1000 / _callbackFps) / (1000 * fadeDelay);
 	fadeTrack->volFadeUsed = true;
 
-	// Create an appendable output buffer
-	fadeTrack->stream = Audio::makeQueuingAudioStream(_sound->getFreq(fadeTrack->soundDesc), track->mixerFlags & kFlagStereo);
-	g_system->getMixer()->playStream(track->getType(), &fadeTrack->handle, fadeTrack->stream, -1, fadeTrack->getVol(),
-											fadeTrack->getPan(), DisposeAfterUse::YES, false,
-											(track->mixerFlags & kFlagReverseStereo) != 0);
+	// Give it an output stream of its own
+	playTrackStream(fadeTrack, _sound->getFreq(fadeTrack->soundDesc));
 	fadeTrack->used = true;
 
 	return fadeTrack;
@@ -24,6 +24,7 @@
 #define GRIM_IMUSE_TRACK_H
 
 #include "engines/grim/imuse/imuse_sndmgr.h"
+#include "engines/grim/imuse/imuse_stream.h"
 
 namespace Grim {
 
@@ -60,10 +61,12 @@ struct Track {
 	int32 volGroupId;
 	int32 feedSize;
 	int32 mixerFlags;
+	int mixerVol;		// as last given to the mixer
+	int mixerPan;
 
 	ImuseSndMgr::SoundDesc *soundDesc;
 	Audio::SoundHandle handle;
-	Audio::QueuingAudioStream *stream;
+	ImuseStream *stream;
 
 	Track() : used(false), stream(NULL) {
 		soundName[0] = 0;
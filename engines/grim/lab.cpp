@@ -22,6 +22,9 @@
 
 #include "common/endian.h"
 #include "common/file.h"
+#include "common/fs.h"
+#include "common/config-manager.h"
+#include "common/mappedfile.h"
 #include "common/substream.h"
 #include "common/memstream.h"
 
@@ -57,6 +60,9 @@ bool Lab::open(const Common::String &filename) {
 
 	close();
 
+	if (mapLab(filename))
+		return loadLab();
+
 	Common::File *file = new Common::File();
 	if (!file->open(filename)) {
 		delete file;
@@ -67,6 +73,24 @@ bool Lab::open(const Common::String &filename) {
 	return loadLab();
 }
 
+/**
+ * Maps the whole archive in memory if possible, so that its members are read
+ * in place: they are then shared with the page cache rather than copied, and
+ * opening one needs no system call. Only done where the address space is
+ * large enough to map all the archives of a game.
+ */
+bool Lab::mapLab(const Common::String &filename) {
+	if (sizeof(void *) < 8)
+		return false;
+
+	if (!_map.open(Common::FSNode(ConfMan.get("path")).getChild(filename)))
+		return false;
+
+	_memLab = _map.getData();
+	_f = _map.createReadStream();
+	return true;
+}
+
 bool Lab::loadLab() {
 	if (_f->readUint32BE() != MKTAG('L','A','B','N')) {
 		close();
@@ -186,7 +210,7 @@ Common::SeekableReadStream *Lab::createReadStreamForMember(const Common::String
 	fname.toLowercase();
 	LabEntryPtr i = _entries[fname];
 
-	/*If the whole Lab has been loaded into ram, we return a MemoryReadStream
+	/*If the whole Lab has been loaded into ram or mapped, we return a MemoryReadStream
 	that map requested data directly, without copying them. Otherwise open a new
 	stream from disk.*/
 	if(_memLab)
@@ -197,12 +221,46 @@ Common::SeekableReadStream *Lab::createReadStreamForMember(const Common::String
 	return new Common::SeekableSubReadStream(file, i->_offset, i->_offset + i->_len, DisposeAfterUse::YES );
 }
 
+const byte *Lab::getMappedMember(const Common::String &filename, uint32 &len) const {
+	if (!_map.isOpen())
+		return NULL;
+
+	// Called from other threads: the entries must not be copied, as their
+	// reference counts are not atomic
+	Common::String fname(filename);
+	fname.toLowercase();
+	LabMap::const_iterator i = _entries.find(fname);
+	if (i == _entries.end())
+		return NULL;
+
+	len = i->_value->_len;
+	return _memLab + i->_value->_offset;
+}
+
+byte *Lab::readMember(const Common::String &filename, uint32 &len) {
+	Common::String fname(filename);
+	fname.toLowercase();
+	const LabMap &entries = _entries;
+	LabMap::const_iterator i = entries.find(fname);
+	if (!_f || i == entries.end())
+		return NULL;
+
+	byte *data = new byte[i->_value->_len];
+	Common::StackLock lock(_mutex);
+	_f->seek(i->_value->_offset);
+	len = _f->read(data, i->_value->_len);
+	return data;
+}
+
 void Lab::close() {
 	delete _f;
 	_f = NULL;
 
-	if(_memLab)
+	if (_map.isOpen())
+		_map.close();
+	else if(_memLab)
 		delete _memLab;
+	_memLab = NULL;
 
 	_entries.clear();
 }
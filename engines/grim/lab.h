@@ -28,6 +28,8 @@
 #include "common/str.h"
 #include "common/archive.h"
 #include "common/file.h"
+#include "common/mappedfile.h"
+#include "common/mutex.h"
 #include "common/types.h"
 
 namespace Grim {
@@ -55,6 +57,18 @@ public:
 	bool open(const byte *memLab, const uint32 size);
 	void close();
 
+	/**
+	 * Returns the data of a member if the archive is mapped in memory,
+	 * which stays valid as long as the archive is open, or NULL.
+	 */
+	const byte *getMappedMember(const Common::String &name, uint32 &len) const;
+
+	/**
+	 * Reads a member into a new buffer, or returns NULL. Unlike the streams
+	 * of the archive, this may be called from any thread.
+	 */
+	byte *readMember(const Common::String &name, uint32 &len);
+
 	// Common::Archive implementation
 	virtual bool hasFile(const Common::String &name); //TODO: Remove at next scummvm sync
 	virtual bool hasFile(const Common::String &name) const;
@@ -64,12 +78,15 @@ public:
 
 private:
 	bool loadLab();
+	bool mapLab(const Common::String &filename);
 	void parseGrimFileTable();
 	void parseMonkey4FileTable();
 
 	Common::SeekableReadStream *_f;
 	const byte *_memLab;
+	Common::MappedFile _map;	// holds _memLab when the archive is mapped
 	Common::String _labFileName;
+	Common::Mutex _mutex;	// guards the reads from _f once the archive is open
 	typedef Common::SharedPtr<LabEntry> LabEntryPtr;
 	typedef Common::HashMap<Common::String, LabEntryPtr, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> LabMap;
 	LabMap _entries;
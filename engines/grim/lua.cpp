@@ -21,6 +21,7 @@
  */
 
 #include "common/endian.h"
+#include "common/config-manager.h"
 #include "common/system.h"
 #include "common/events.h"
 
@@ -112,6 +113,7 @@ LuaBase::LuaBase() :
 	_frameTimeCollection(0) {
 	s_instance = this;
 
+	lua_setgcincremental(ConfMan.getBool("lua_incremental_gc"));
 	lua_iolibopen();
 	lua_strlibopen();
 	lua_mathlibopen();
@@ -257,7 +259,7 @@ void LuaBase::update(int frameTime, int movieTime) {
 	_frameTimeCollection += frameTime;
 	if (_frameTimeCollection > 10000) {
 		_frameTimeCollection = 0;
-		lua_collectgarbage(0);
+		lua_startgc();
 	}
 
 	lua_beginblock();
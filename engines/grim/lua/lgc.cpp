@@ -129,66 +129,102 @@ void luaC_strcallIM(TaggedString *l) {
 	}
 }
 
-static GCnode *listcollect(GCnode *l) {
-	GCnode *frees = NULL;
-	while (l) {
-		GCnode *next = l->next;
-		l->marked = 0;
-		while (next && !next->marked) {
-			l->next = next->next;
-			next->next = frees;
-			frees = next;
-			next = l->next;
-		}
-		l = next;
+/*
+** =======================================================
+** Incremental collector
+** =======================================================
+** A cycle first marks the roots, then traverses the gray objects (marked
+** but with unmarked children) a few at a time, between the steps of the
+** program. Tables are the only objects which change once reachable, so
+** luaH_set turns a black table back to gray, and luaS_rawsetglobal marks
+** the new values of the globals. The stacks, locked references and tag
+** methods change without any barrier, so they are marked again in the
+** atomic step which ends the marking. The sweep then frees the unmarked
+** objects, also a few at a time, and the gc tag methods are called once
+** it is complete, as the stop-the-world collector did.
+*/
+
+int32 GCstate = GCSpause;
+
+#define GCSTEPSIZE	1024  // work done by each step, in visited slots
+
+static bool GCincremental = true;
+
+static TObject *graystack = NULL;
+static int32 graysize = 0;
+static int32 graytop = 0;
+
+// The lists are detached while they are swept, so that the new objects
+// go to the empty lists and are kept
+static GCnode *sweepnodes[3];
+static GCnode *sweepkept[3];
+static GCnode *sweeplast[3];
+static int32 sweepstage;
+static TaggedString *freestr;
+static GCnode *freenodes[3];
+
+static GCnode *const rootlists[3] = { &roottable, &rootproto, &rootcl };
+
+static void pushgray(lua_Type type, GCnode *node) {
+	if (graytop == graysize) {
+		graysize = graysize ? 2 * graysize : 256;
+		graystack = luaM_reallocvector(graystack, graysize, TObject);
+		if (!graystack)
+			lua_error(memEM);
 	}
-	return frees;
+	ttype(&graystack[graytop]) = type;
+	graystack[graytop].value.ts = (TaggedString *)node;
+	graytop++;
 }
 
 static void strmark(TaggedString *s) {
 	if (!s->head.marked)
-		s->head.marked = 1;
+		s->head.marked = GC_BLACK;
 }
 
-static void protomark(TProtoFunc *f) {
-	if (!f->head.marked) {
-		LocVar *v = f->locvars;
-		int32 i;
-		f->head.marked = 1;
-		if (f->fileName)
-			strmark(f->fileName);
-		for (i = 0; i < f->nconsts; i++)
-			markobject(&f->consts[i]);
-		if (v) {
-			for (; v->line != -1; v++) {
-				if (v->varname)
-					strmark(v->varname);
-			}
-		}
+static void shade(lua_Type type, GCnode *node) {
+	if (node->marked == GC_WHITE) {
+		node->marked = GC_GRAY;
+		pushgray(type, node);
 	}
 }
 
-static void closuremark(Closure *f) {
-	if (!f->head.marked) {
-		int32 i;
-		f->head.marked = 1;
-		for (i = f->nelems; i >= 0; i--)
-			markobject(&f->consts[i]);
+static int32 protomark(TProtoFunc *f) {
+	LocVar *v = f->locvars;
+	int32 i;
+	int32 work = 1;
+	if (f->fileName)
+		strmark(f->fileName);
+	for (i = 0; i < f->nconsts; i++)
+		markobject(&f->consts[i]);
+	work += f->nconsts;
+	if (v) {
+		for (; v->line != -1; v++) {
+			if (v->varname)
+				strmark(v->varname);
+			work++;
+		}
 	}
+	return work;
 }
 
-static void hashmark(Hash *h) {
-	if (!h->head.marked) {
-		int32 i;
-		h->head.marked = 1;
-		for (i = 0; i < nhash(h); i++) {
-			Node *n = node(h, i);
-			if (ttype(ref(n)) != LUA_T_NIL) {
-				markobject(&n->ref);
-				markobject(&n->val);
-			}
+static int32 closuremark(Closure *f) {
+	int32 i;
+	for (i = f->nelems; i >= 0; i--)
+		markobject(&f->consts[i]);
+	return f->nelems + 1;
+}
+
+static int32 hashmark(Hash *h) {
+	int32 i;
+	for (i = 0; i < nhash(h); i++) {
+		Node *n = node(h, i);
+		if (ttype(ref(n)) != LUA_T_NIL) {
+			markobject(&n->ref);
+			markobject(&n->val);
 		}
 	}
+	return nhash(h);
 }
 
 static void globalmark() {
@@ -207,15 +243,15 @@ static int32 markobject(TObject *o) {
 		strmark(tsvalue(o));
 		break;
 	case LUA_T_ARRAY:
-		hashmark(avalue(o));
+		shade(LUA_T_ARRAY, (GCnode *)avalue(o));
 		break;
 	case LUA_T_CLOSURE:
 	case LUA_T_CLMARK:
-		closuremark(o->value.cl);
+		shade(LUA_T_CLOSURE, (GCnode *)o->value.cl);
 		break;
 	case LUA_T_PROTO:
 	case LUA_T_PMARK:
-		protomark(o->value.tf);
+		shade(LUA_T_PROTO, (GCnode *)o->value.tf);
 		break;
 	default:
 		break;  // numbers, cprotos, etc
@@ -223,41 +259,204 @@ static int32 markobject(TObject *o) {
 	return 0;
 }
 
-static void markall() {
+/*
+** Blackens gray objects until 'limit' work is done, and returns the work.
+*/
+static int32 propagate(int32 limit) {
+	int32 work = 0;
+	while (graytop > 0 && work < limit) {
+		TObject *o = &graystack[--graytop];
+		GCnode *node = (GCnode *)o->value.ts;
+		node->marked = GC_BLACK;
+		switch (ttype(o)) {
+		case LUA_T_ARRAY:
+			work += hashmark((Hash *)node);
+			break;
+		case LUA_T_CLOSURE:
+			work += closuremark((Closure *)node);
+			break;
+		default:
+			work += protomark((TProtoFunc *)node);
+			break;
+		}
+	}
+	return work;
+}
+
+static void markroots() {
 	luaD_travstack(markobject); // mark stack objects
-	globalmark();  // mark global variable values and names
 	travlock(); // mark locked objects
 	luaT_travtagmethods(markobject);  // mark fallbacks
 }
 
-int32 lua_collectgarbage(int32 limit) {
-	int32 recovered = nblocks;  // to subtract nblocks after gc
-	Hash *freetable;
-	TaggedString *freestr;
-	TProtoFunc *freefunc;
-	Closure *freeclos;
-	markall();
+static void startcycle() {
+	graytop = 0;
+	markroots();
+	globalmark();  // mark global variable values and names
+	GCstate = GCSpropagate;
+}
+
+static void atomic() {
+	int32 i;
+	markroots();
+	propagate(MAX_INT);
 	invalidaterefs();
-	freestr = luaS_collector();
-	freetable = (Hash *)listcollect(&roottable);
-	freefunc = (TProtoFunc *)listcollect(&rootproto);
-	freeclos = (Closure *)listcollect(&rootcl);
-	GCthreshold *= 4;  // to avoid GC during GC
+	luaS_unlinkglobals();
+
+	freestr = NULL;
+	for (i = 0; i < 3; i++) {
+		sweepnodes[i] = rootlists[i]->next;
+		rootlists[i]->next = NULL;
+		sweepkept[i] = sweeplast[i] = NULL;
+		freenodes[i] = NULL;
+	}
+	sweepstage = 0;
+	GCstate = GCSsweepstring;
+}
+
+/*
+** Sweeps up to 'limit' nodes of the detached list 'i', and puts it back
+** behind the new objects once it is done.
+*/
+static int32 sweeplist(int32 i, int32 limit) {
+	int32 work = 0;
+	while (sweepnodes[i] && work < limit) {
+		GCnode *node = sweepnodes[i];
+		sweepnodes[i] = node->next;
+		if (node->marked) {
+			node->marked = GC_WHITE;
+			node->next = NULL;
+			if (sweeplast[i])
+				sweeplast[i]->next = node;
+			else
+				sweepkept[i] = node;
+			sweeplast[i] = node;
+		} else {
+			node->next = freenodes[i];
+			freenodes[i] = node;
+		}
+		work++;
+	}
+	if (!sweepnodes[i]) {
+		GCnode *l = rootlists[i];
+		while (l->next)
+			l = l->next;
+		l->next = sweepkept[i];
+	}
+	return work;
+}
+
+static void finishcycle() {
+	Hash *freetable = (Hash *)freenodes[0];
+	GCstate = GCSfinalize;  // the tag methods run no collection
 	luaC_hashcallIM(freetable);  // GC tag methods for tables
 	luaC_strcallIM(freestr);  // GC tag methods for userdata
 	luaD_gcIM(&luaO_nilobject);  // GC tag method for nil (signal end of GC)
 	luaH_free(freetable);
 	luaS_free(freestr);
-	luaF_freeproto(freefunc);
-	luaF_freeclosure(freeclos);
+	luaF_freeproto((TProtoFunc *)freenodes[1]);
+	luaF_freeclosure((Closure *)freenodes[2]);
+	GCstate = GCSpause;
+	GCthreshold = 2 * nblocks;
+}
+
+/*
+** Advances the current cycle by about 'limit' work.
+*/
+static void gcstep(int32 limit) {
+	int32 work = 0;
+	while (work < limit) {
+		switch (GCstate) {
+		case GCSpropagate:
+			if (graytop > 0)
+				work += propagate(limit - work);
+			else
+				atomic();
+			break;
+		case GCSsweepstring:
+			if (sweepstage < NUM_HASHS)
+				work += luaS_sweep(sweepstage++, &freestr);
+			else {
+				sweepstage = 0;
+				GCstate = GCSsweep;
+			}
+			break;
+		case GCSsweep:
+			if (sweepstage < 3) {
+				work += sweeplist(sweepstage, limit - work);
+				if (!sweepnodes[sweepstage])
+					sweepstage++;
+			} else {
+				finishcycle();
+				return;
+			}
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+void luaC_barriertable(Hash *t) {
+	t->head.marked = GC_GRAY;
+	pushgray(LUA_T_ARRAY, (GCnode *)t);
+}
+
+void luaC_barrierglobal(TaggedString *ts, TObject *o) {
+	strmark(ts);
+	markobject(o);
+}
+
+void luaC_finish() {
+	if (GCstate != GCSpause && GCstate != GCSfinalize)
+		gcstep(MAX_INT);
+	luaM_free(graystack);
+	graystack = NULL;
+	graysize = graytop = 0;
+}
+
+int32 lua_collectgarbage(int32 limit) {
+	if (GCstate == GCSfinalize)
+		return 0;  // called by a gc tag method
+	int32 recovered = nblocks;  // to subtract nblocks after gc
+	// The marks of a cycle in progress are stale, so complete it first
+	if (GCstate != GCSpause)
+		gcstep(MAX_INT);
+	startcycle();
+	gcstep(MAX_INT);
 	recovered = recovered - nblocks;
 	GCthreshold = (limit == 0) ? 2 * nblocks : nblocks + limit;
 	return recovered;
 }
 
-void luaC_checkGC() {
-	if (nblocks >= GCthreshold)
+void lua_setgcincremental(int32 on) {
+	GCincremental = on != 0;
+}
+
+int32 lua_getgcincremental() {
+	return GCincremental;
+}
+
+void lua_startgc() {
+	if (!GCincremental)
 		lua_collectgarbage(0);
+	else if (GCstate == GCSpause)
+		startcycle();
+}
+
+void luaC_checkGC() {
+	if (GCstate == GCSpause) {
+		if (nblocks < GCthreshold)
+			return;
+		if (!GCincremental) {
+			lua_collectgarbage(0);
+			return;
+		}
+		startcycle();
+	}
+	// Complete the cycle at once if the program allocates faster than it
+	// collects
+	gcstep(nblocks >= 2 * GCthreshold ? MAX_INT : GCSTEPSIZE);
 }
 
 } // end of namespace Grim
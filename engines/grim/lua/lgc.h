@@ -11,7 +11,31 @@
 
 namespace Grim {
 
+// States of a collection cycle
+enum {
+	GCSpause,		// no cycle in progress
+	GCSpropagate,	// marking the reachable objects
+	GCSsweepstring,	// freeing the unmarked strings, one table per step
+	GCSsweep,		// freeing the unmarked tables, protos and closures
+	GCSfinalize		// calling the gc tag methods
+};
+
+// Colors of the 'marked' field; strings are never gray
+#define GC_WHITE	0
+#define GC_BLACK	1
+#define GC_GRAY		3
+
+extern int32 GCstate;
+
+// Called before writing into a table, which must be traversed again if the
+// collector is done with it
+#define luaC_barrier(t) \
+	{ if (GCstate == GCSpropagate && (t)->head.marked == GC_BLACK) luaC_barriertable(t); }
+
 void luaC_checkGC();
+void luaC_barriertable(Hash *t);
+void luaC_barrierglobal(TaggedString *ts, TObject *o);
+void luaC_finish();
 TObject* luaC_getref(int32 r);
 int32 luaC_ref(TObject *o, int32 lock);
 void luaC_hashcallIM(Hash *l);
@@ -3,6 +3,7 @@
 
 #include "common/endian.h"
 #include "common/debug.h"
+#include "common/hashmap.h"
 
 #include "engines/grim/savegame.h"
 
@@ -19,35 +20,39 @@
 
 namespace Grim {
 
-PointerId makeIdFromPointer(void *ptr) {
-	PointerId pointer;
-
+// Objects are saved with dense ids instead of their addresses: every string,
+// closure, table and prototype gets its position in the order it is written,
+// so lua_Restore() can turn an id back into an object by array indexing.
+struct PointerHash {
+	uint operator()(const void *ptr) const {
 #ifdef TARGET_64BITS
-	uint64 v = (uint64)ptr;
-	pointer.low = v & 0xffffffff;
-	pointer.hi = v >> 32;
+		uint64 v = (uint64)ptr;
+		return (uint)((v >> 4) ^ (v >> 32));
 #else
-	pointer.low = (uint32)ptr;
-	pointer.hi = 0;
+		return (uint)ptr >> 4;
 #endif
+	}
+};
 
-	return pointer;
-}
+typedef Common::HashMap<const void *, int32, PointerHash> ObjectIdMap;
 
-void *makePointerFromId(PointerId ptr) {
-	void *pointer;
+static int32 objectId(const ObjectIdMap &ids, const void *ptr) {
+	if (!ptr)
+		return -1;
 
-#ifdef TARGET_64BITS
-	uint64 v = ptr.low | ((uint64)ptr.hi << 32);
-	pointer = (void *)v;
-#else
-	pointer = (void *)ptr.low;
-#endif
+	ObjectIdMap::const_iterator i = ids.find(ptr);
+	assert(i != ids.end());
+	return i->_value;
+}
 
-	return pointer;
+static int32 numberObjects(GCnode *root, ObjectIdMap &ids) {
+	int32 count = 0;
+	for (GCnode *node = root->next; node; node = node->next)
+		ids[node] = count++;
+	return count;
 }
 
-static void saveObjectValue(TObject *object, SaveGame *savedState) {
+static void saveObjectValue(TObject *object, SaveGame *savedState, const ObjectIdMap &ids) {
 	savedState->writeLESint32(object->ttype);
 
 	switch (object->ttype) {
@@ -61,7 +66,6 @@ static void saveObjectValue(TObject *object, SaveGame *savedState) {
 						if (list->list[l].func == object->value.f) {
 							idObj = (idObj << 16) | l;
 							savedState->writeLESint32(idObj);
-							savedState->writeLESint32(0);
 							return;
 						}
 					}
@@ -81,8 +85,7 @@ static void saveObjectValue(TObject *object, SaveGame *savedState) {
 			break;
 		case LUA_T_ARRAY:
 			{
-				savedState->writeLEUint32(makeIdFromPointer(object->value.a).low);
-				savedState->writeLEUint32(makeIdFromPointer(object->value.a).hi);
+				savedState->writeLESint32(objectId(ids, object->value.a));
 			}
 			break;
 		case LUA_T_USERDATA:
@@ -90,24 +93,22 @@ static void saveObjectValue(TObject *object, SaveGame *savedState) {
 				savedState->writeLESint32(object->value.ud.id);
 				savedState->writeLESint32(object->value.ud.tag);
 			}
+			break;
 		case LUA_T_STRING:
 			{
-				savedState->writeLEUint32(makeIdFromPointer(object->value.ts).low);
-				savedState->writeLEUint32(makeIdFromPointer(object->value.ts).hi);
+				savedState->writeLESint32(objectId(ids, object->value.ts));
 			}
 			break;
 		case LUA_T_PROTO:
 		case LUA_T_PMARK:
 			{
-				savedState->writeLEUint32(makeIdFromPointer(object->value.tf).low);
-				savedState->writeLEUint32(makeIdFromPointer(object->value.tf).hi);
+				savedState->writeLESint32(objectId(ids, object->value.tf));
 			}
 			break;
 		case LUA_T_CLOSURE:
 		case LUA_T_CLMARK:
 			{
-				savedState->writeLEUint32(makeIdFromPointer(object->value.cl).low);
-				savedState->writeLEUint32(makeIdFromPointer(object->value.cl).hi);
+				savedState->writeLESint32(objectId(ids, object->value.cl));
 			}
 			break;
 		case LUA_T_LINE:
@@ -116,8 +117,7 @@ static void saveObjectValue(TObject *object, SaveGame *savedState) {
 			}
 			break;
 		default:
-			savedState->writeLEUint32(makeIdFromPointer(object->value.ts).low);
-			savedState->writeLEUint32(makeIdFromPointer(object->value.ts).hi);
+			break;
 	}
 }
 
@@ -142,108 +142,72 @@ void lua_Save(SaveGame *savedState) {
 
 	lua_collectgarbage(0);
 	int32 i, l;
-	int32 countElements = 0;
+	int32 countStrings = 0;
 	int32 maxStringLength = 0;
+	ObjectIdMap ids;
 
-
-	// Check for max length for strings and count them
+	// Number the strings and check for their max length
 	for (i = 0; i < NUM_HASHS; i++) {
 		stringtable *tempStringTable = &string_root[i];
 		for (l = 0; l < tempStringTable->size; l++) {
-			if (tempStringTable->hash[l] && tempStringTable->hash[l] != &EMPTY) {
-				countElements++;
-				if (tempStringTable->hash[l]->constindex != -1) {
-					int len = strlen(tempStringTable->hash[l]->str);
-					if (maxStringLength < len) {
-						maxStringLength = len;
-					}
+			TaggedString *tempString = tempStringTable->hash[l];
+			if (tempString && tempString != &EMPTY) {
+				assert(tempString->constindex != -1);
+				ids[tempString] = countStrings++;
+				int len = strlen(tempString->str);
+				if (maxStringLength < len) {
+					maxStringLength = len;
 				}
 			}
 		}
 	}
-	// save number of strings
-	savedState->writeLESint32(countElements);
 
+	// Number the closures, tables and prototypes in list order
+	int32 countClosures = numberObjects(&rootcl, ids);
+	int32 countTables = numberObjects(&roottable, ids);
+	int32 countProtos = numberObjects(&rootproto, ids);
 
-	// save number of closures
-	countElements = 0;
+	int32 countGlobals = 0;
 	GCnode *tempNode;
-	tempNode = rootcl.next;
-	while (tempNode) {
-		countElements++;
-		tempNode = tempNode->next;
-	}
-	savedState->writeLESint32(countElements);
-
-	// save number of tables
-	countElements = 0;
-	tempNode = roottable.next;
-	while (tempNode) {
-		countElements++;
-		tempNode = tempNode->next;
-	}
-	savedState->writeLESint32(countElements);
-
-	// save number of prototypes
-	countElements = 0;
-	tempNode = rootproto.next;
-	while (tempNode) {
-		countElements++;
-		tempNode = tempNode->next;
-	}
-	savedState->writeLESint32(countElements);
-
-	// save number of global strings
-	countElements = 0;
-	tempNode = rootglobal.next;
-	while (tempNode) {
-		countElements++;
-		tempNode = tempNode->next;
-	}
-	savedState->writeLESint32(countElements);
-
-	// save maximum length for string
+	for (tempNode = rootglobal.next; tempNode; tempNode = tempNode->next)
+		countGlobals++;
+
+	savedState->writeLESint32(countStrings);
+	savedState->writeLESint32(countClosures);
+	savedState->writeLESint32(countTables);
+	savedState->writeLESint32(countProtos);
+	savedState->writeLESint32(countGlobals);
 	savedState->writeLESint32(maxStringLength);
 
-	//printf("1: %d\n", g_grim->_savedState->getBufferPos());
+	// save the closure sizes, so that restore can allocate every object up front
+	Closure *tempClosure;
+	for (tempClosure = (Closure *)rootcl.next; tempClosure; tempClosure = (Closure *)tempClosure->head.next)
+		savedState->writeLESint32(tempClosure->nelems);
 
-	// save hash tables for strings and user data
+	// save hash tables for strings, in id order. Their global values follow
+	// the objects, with the list of globals.
 	TaggedString *tempString;
 	for (i = 0; i < NUM_HASHS; i++) {
 		stringtable *tempStringTable = &string_root[i];
 		for (l = 0; l < tempStringTable->size; l++) {
 			if (tempStringTable->hash[l] && tempStringTable->hash[l] != &EMPTY) {
 				tempString = tempStringTable->hash[l];
-				savedState->writeLEUint32(makeIdFromPointer(tempString).low);
-				savedState->writeLEUint32(makeIdFromPointer(tempString).hi);
 				savedState->writeLESint32(tempString->constindex);
-				if (tempString->constindex != -1) {
-					saveObjectValue(&tempString->globalval, savedState);
-					int len = strlen(tempString->str);
-					savedState->writeLESint32(len);
-					savedState->write(tempString->str, len);
-				}
+				int len = strlen(tempString->str);
+				savedState->writeLESint32(len);
+				savedState->write(tempString->str, len);
 			}
 		}
 	}
 
-	//printf("2: %d\n", g_grim->_savedState->getBufferPos());
-
-	Closure *tempClosure = (Closure *)rootcl.next;
-	while (tempClosure) {
-		savedState->writeLEUint32(makeIdFromPointer(tempClosure).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempClosure).hi);
-		savedState->writeLESint32(tempClosure->nelems);
+	for (tempClosure = (Closure *)rootcl.next; tempClosure; tempClosure = (Closure *)tempClosure->head.next) {
 		for (i = 0; i <= tempClosure->nelems; i++) {
-			saveObjectValue(&tempClosure->consts[i], savedState);
+			saveObjectValue(&tempClosure->consts[i], savedState, ids);
 		}
-		tempClosure = (Closure *)tempClosure->head.next;
 	}
 
 	Hash *tempHash = (Hash *)roottable.next;
 	while (tempHash) {
-		savedState->writeLEUint32(makeIdFromPointer(tempHash).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempHash).hi);
 		savedState->writeLESint32(tempHash->nhash);
 		int32 countUsedHash = 0;
 		for (i = 0; i < tempHash->nhash; i++) {
@@ -257,8 +221,8 @@ void lua_Save(SaveGame *savedState) {
 		for (i = 0; i < tempHash->nhash; i++) {
 			Node *newNode = &tempHash->node[i];
 			if (newNode->ref.ttype != LUA_T_NIL && newNode->val.ttype != LUA_T_NIL) {
-				saveObjectValue(&tempHash->node[i].ref, savedState);
-				saveObjectValue(&tempHash->node[i].val, savedState);
+				saveObjectValue(&tempHash->node[i].ref, savedState, ids);
+				saveObjectValue(&tempHash->node[i].val, savedState, ids);
 			}
 		}
 		tempHash = (Hash *)tempHash->head.next;
@@ -266,14 +230,11 @@ void lua_Save(SaveGame *savedState) {
 
 	TProtoFunc *tempProtoFunc = (TProtoFunc *)rootproto.next;
 	while (tempProtoFunc) {
-		savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc).hi);
-		savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc->fileName).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc->fileName).hi);
+		savedState->writeLESint32(objectId(ids, tempProtoFunc->fileName));
 		savedState->writeLESint32(tempProtoFunc->lineDefined);
 		savedState->writeLESint32(tempProtoFunc->nconsts);
 		for (i = 0; i < tempProtoFunc->nconsts; i++) {
-			saveObjectValue(&tempProtoFunc->consts[i], savedState);
+			saveObjectValue(&tempProtoFunc->consts[i], savedState, ids);
 		}
 		int32 countVariables = 0;
 		if (tempProtoFunc->locvars) {
@@ -282,8 +243,7 @@ void lua_Save(SaveGame *savedState) {
 
 		savedState->writeLESint32(countVariables);
 		for (i = 0; i < countVariables; i++) {
-			savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc->locvars[i].varname).low);
-			savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc->locvars[i].varname).hi);
+			savedState->writeLESint32(objectId(ids, tempProtoFunc->locvars[i].varname));
 			savedState->writeLESint32(tempProtoFunc->locvars[i].line);
 		}
 
@@ -302,18 +262,18 @@ void lua_Save(SaveGame *savedState) {
 
 	tempString = (TaggedString *)rootglobal.next;
 	while (tempString) {
-		savedState->writeLEUint32(makeIdFromPointer(tempString).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempString).hi);
+		savedState->writeLESint32(objectId(ids, tempString));
+		saveObjectValue(&tempString->globalval, savedState, ids);
 		tempString = (TaggedString *)tempString->head.next;
 	}
 
-	saveObjectValue(&errorim, savedState);
+	saveObjectValue(&errorim, savedState, ids);
 
 	IM *tempIm = IMtable;
 	savedState->writeLESint32(IMtable_size);
 	for (i = 0; i < IMtable_size; i++) {
 		for (l = 0; l < IM_N; l++) {
-			saveObjectValue(&tempIm->int_method[l], savedState);
+			saveObjectValue(&tempIm->int_method[l], savedState, ids);
 		}
 		tempIm++;
 	}
@@ -321,7 +281,7 @@ void lua_Save(SaveGame *savedState) {
 	savedState->writeLESint32(last_tag);
 	savedState->writeLESint32(refSize);
 	for (i = 0 ; i < refSize; i++) {
-		saveObjectValue(&refArray[i].o, savedState);
+		saveObjectValue(&refArray[i].o, savedState, ids);
 		savedState->writeLESint32(refArray[i].status);
 	}
 
@@ -360,10 +320,8 @@ void lua_Save(SaveGame *savedState) {
 		savedState->writeLESint32(countTasks);
 		task = state->task;
 		while (task) {
-			savedState->writeLEUint32(makeIdFromPointer(task->cl).low);
-			savedState->writeLEUint32(makeIdFromPointer(task->cl).hi);
-			savedState->writeLEUint32(makeIdFromPointer(task->tf).low);
-			savedState->writeLEUint32(makeIdFromPointer(task->tf).hi);
+			savedState->writeLESint32(objectId(ids, task->cl));
+			savedState->writeLESint32(objectId(ids, task->tf));
 			savedState->writeLESint32(task->base);
 			savedState->writeLESint32(task->some_base);
 			savedState->writeLESint32(task->some_results);
@@ -386,7 +344,7 @@ void lua_Save(SaveGame *savedState) {
 		int32 stackTopSize = state->stack.top - state->stack.stack;
 		savedState->writeLESint32(stackTopSize);
 		for (i = 0; i < stackTopSize; i++) {
-			saveObjectValue(&state->stack.stack[i], savedState);
+			saveObjectValue(&state->stack.stack[i], savedState, ids);
 		}
 
 		savedState->writeLESint32(state->Cstack.base);
@@ -401,7 +359,7 @@ void lua_Save(SaveGame *savedState) {
 		}
 
 		savedState->writeLESint32(state->id);
-		saveObjectValue(&state->taskFunc, savedState);
+		saveObjectValue(&state->taskFunc, savedState, ids);
 
 		state = state->next;
 	}
@@ -8,6 +8,7 @@
 
 #include "common/util.h"
 
+#include "engines/grim/lua/lgc.h"
 #include "engines/grim/lua/lmem.h"
 #include "engines/grim/lua/lobject.h"
 #include "engines/grim/lua/lstate.h"
@@ -20,6 +21,8 @@ namespace Grim {
 
 TaggedString EMPTY = {{NULL, 2}, 0, 0L, {LUA_T_NIL, {NULL}}, {0}};
 
+static int32 sweptstrings = 0;  // tables already swept by the current cycle
+
 void luaS_init() {
 	int32 i;
 	string_root = luaM_newvector(NUM_HASHS, stringtable);
@@ -107,16 +110,20 @@ static TaggedString *insert(const char *buff, int32 tag, stringtable *tb) {
 		else if ((ts->constindex >= 0) ? // is a string?
 				(tag == LUA_T_STRING && (strcmp(buff, ts->str) == 0)) :
 				((tag == ts->globalval.ttype || tag == LUA_ANYTAG) && buff == (const char *)ts->globalval.value.ts))
-			return ts;
+			break;
 		if (++i == size)
 			i = 0;
 	}
-	// not found
-	if (j != -1)  // is there an EMPTY space?
-		i = j;
-	else
-		tb->nuse++;
-	ts = tb->hash[i] = newone(buff, tag, h);
+	if (!ts) {  // not found
+		if (j != -1)  // is there an EMPTY space?
+			i = j;
+		else
+			tb->nuse++;
+		ts = tb->hash[i] = newone(buff, tag, h);
+	}
+	// The marks of the table are still those of the sweeping cycle
+	if (GCstate == GCSsweepstring && tb - string_root >= sweptstrings && !ts->head.marked)
+		ts->head.marked = GC_BLACK;
 	return ts;
 }
 
@@ -138,7 +145,7 @@ TaggedString *luaS_new(const char *str) {
 
 TaggedString *luaS_newfixedstring(const char *str) {
 	TaggedString *ts = luaS_new(str);
-	if (ts->head.marked == 0)
+	if (ts->head.marked < 2)
 		ts->head.marked = 2;  // avoid GC
 	return ts;
 }
@@ -159,33 +166,40 @@ void luaS_free(TaggedString *l) {
 static void remove_from_list(GCnode *l) {
 	while (l) {
 		GCnode *next = l->next;
-		while (next && !next->marked)
-			next = l->next = next->next;
+		while (next && !next->marked) {
+			l->next = next->next;
+			next->next = next;  // signal it is in no list
+			next = l->next;
+		}
 		l = next;
 	}
 }
 
-TaggedString *luaS_collector() {
-	TaggedString *frees = NULL;
-	int32 i;
+void luaS_unlinkglobals() {
 	remove_from_list(&rootglobal);
-	for (i = 0; i < NUM_HASHS; i++) {
-		stringtable *tb = &string_root[i];
-		int32 j;
-		for (j = 0; j < tb->size; j++) {
-			TaggedString *t = tb->hash[j];
-			if (!t)
-				continue;
-			if (t->head.marked == 1)
-				t->head.marked = 0;
-			else if (!t->head.marked) {
-				t->head.next = (GCnode *)frees;
-				frees = t;
-				tb->hash[j] = &EMPTY;
-			}
+	sweptstrings = 0;
+}
+
+/*
+** Sweeps the string table 'i', and returns its size as the work done.
+*/
+int32 luaS_sweep(int32 i, TaggedString **frees) {
+	stringtable *tb = &string_root[i];
+	int32 j;
+	for (j = 0; j < tb->size; j++) {
+		TaggedString *t = tb->hash[j];
+		if (!t)
+			continue;
+		if (t->head.marked == 1)
+			t->head.marked = 0;
+		else if (!t->head.marked) {
+			t->head.next = (GCnode *)*frees;
+			*frees = t;
+			tb->hash[j] = &EMPTY;
 		}
 	}
-	return frees;
+	sweptstrings = i + 1;
+	return tb->size;
 }
 
 TaggedString *luaS_collectudata() {
@@ -224,6 +238,8 @@ void luaS_freeall() {
 }
 
 void luaS_rawsetglobal(TaggedString *ts, TObject *newval) {
+	if (GCstate == GCSpropagate)
+		luaC_barrierglobal(ts, newval);
 	ts->globalval = *newval;
 	if (ts->head.next == (GCnode *)ts) {  // is not in list?
 		ts->head.next = rootglobal.next;
@@ -7,6 +7,7 @@
 #define FORBIDDEN_SYMBOL_EXCEPTION_longjmp
 
 #include "engines/grim/lua/lauxlib.h"
+#include "engines/grim/lua/lgc.h"
 #include "engines/grim/lua/lmem.h"
 #include "engines/grim/lua/lobject.h"
 #include "engines/grim/lua/lstate.h"
@@ -219,6 +220,7 @@ TObject *luaH_get(Hash *t, TObject *r) {
 ** node for the given reference and also return its pointer.
 */
 TObject *luaH_set(Hash *t, TObject *r) {
+	luaC_barrier(t);
 	Node *n = node(t, present(t, r));
 	if (ttype(ref(n)) == LUA_T_NIL) {
 		nuse(t)++;
@@ -32,14 +32,6 @@ namespace Grim {
 typedef void (*lua_CFunction)();
 typedef uint32 lua_Object;
 
-struct PointerId {
-	uint32	low;
-	uint32	hi;
-};
-
-PointerId makeIdFromPointer(void *ptr);
-void *makePointerFromId(PointerId ptr);
-
 class LuaFile {
 public:
 	Common::String _name;
@@ -130,6 +122,9 @@ void lua_unref(int32 ref);
 
 lua_Object lua_createtable();
 int32 lua_collectgarbage(int32 limit);
+void lua_setgcincremental(int32 on);
+int32 lua_getgcincremental();
+void lua_startgc();
 
 void lua_runtasks();
 void current_script();
@@ -594,6 +594,8 @@ void Lua_V1::LockSet() {
 		return;
 
 	const char *name = lua_getstring(nameObj);
+	// a set is locked to be kept around, so it is likely to be entered soon
+	g_grim->prefetchSet(name);
 	// TODO implement proper locking
 	g_grim->setSetLock(name, true);
 }
@@ -881,6 +883,7 @@ void Lua_V1::GetSaveGameImage() {
 		return;
 	}
 	const char *filename = lua_getstring(param);
+	g_grim->waitForSaveGames();
 	SaveGame *savedState = SaveGame::openForLoading(filename);
 	if (!savedState || savedState->saveVersion() != SaveGame::SAVEGAME_VERSION) {
 		lua_pushnil();
@@ -888,9 +891,13 @@ void Lua_V1::GetSaveGameImage() {
 	}
 	dataSize = savedState->beginSection('SIMG');
 	uint16 *data = new uint16[dataSize / 2];
+#ifdef SCUMM_LITTLE_ENDIAN
+	savedState->read(data, dataSize);
+#else
 	for (int l = 0; l < dataSize / 2; l++) {
 		data[l] = savedState->readLEUint16();
 	}
+#endif
 	screenshot = new Bitmap((char *)data, width, height, 16, "screenshot");
 	delete[] data;
 	if (screenshot) {
@@ -927,6 +934,9 @@ void Lua_V1::SubmitSaveGameData() {
 		int32 len = strlen(str) + 1;
 		savedState->writeLESint32(len);
 		savedState->write(str, len);
+		// The first string is the one shown in the lists of savegames
+		if (count == 1)
+			savedState->setDescription(str);
 	}
 	savedState->endSection();
 }
@@ -936,6 +946,7 @@ void Lua_V1::GetSaveGameData() {
 	if (!lua_isstring(param))
 		return;
 	const char *filename = lua_getstring(param);
+	g_grim->waitForSaveGames();
 	SaveGame *savedState = SaveGame::openForLoading(filename);
 	lua_Object result = lua_createtable();
 
@@ -383,11 +383,6 @@ void MeshFace::changeMaterial(Material *material) {
 	_material = material;
 }
 
-void MeshFace::draw(float *vertices, float *vertNormals, float *textureVerts) const {
-	_material->select();
-	g_driver->drawModelFace(this, vertices, vertNormals, textureVerts);
-}
-
 /**
  * @class Mesh
  */
@@ -398,6 +393,11 @@ Mesh::~Mesh() {
 	delete[] _textureVerts;
 	delete[] _faces;
 	delete[] _materialid;
+	delete[] _drawVertices;
+	delete[] _drawNormals;
+	delete[] _drawTextureVerts;
+	delete[] _drawIndices;
+	delete[] _batches;
 }
 
 void Mesh::loadBinary(Common::SeekableReadStream *data, Material *materials[]) {
@@ -440,6 +440,8 @@ void Mesh::loadBinary(Common::SeekableReadStream *data, Material *materials[]) {
 	data->read(f, 4);
 	_radius = get_float(f);
 	data->seek(24, SEEK_CUR);
+
+	prepareDraw();
 }
 
 void Mesh::loadText(TextSplitter *ts, Material* materials[]) {
@@ -535,6 +537,97 @@ void Mesh::loadText(TextSplitter *ts, Material* materials[]) {
 		ts->scanString(" %d: %f %f %f", 4, &num, &x, &y, &z);
 		_faces[num]._normal = Math::Vector3d(x, y, z);
 	}
+
+	prepareDraw();
+}
+
+void Mesh::prepareDraw() {
+	int numCorners = 0, numIndices = 0;
+	for (int i = 0; i < _numFaces; i++) {
+		numCorners += _faces[i]._numVertices;
+		if (_faces[i]._numVertices > 2)
+			numIndices += 3 * (_faces[i]._numVertices - 2);
+	}
+
+	// One draw vertex per distinct (vertex, texture vertex) pair: the pairs
+	// already seen for a vertex are chained from first[vertex].
+	int *first = new int[_numVertices];
+	int *next = new int[numCorners];
+	int *texOf = new int[numCorners];
+	int *vertOf = new int[numCorners];
+	int *corners = new int[numCorners];
+	for (int i = 0; i < _numVertices; i++)
+		first[i] = -1;
+
+	_numDrawVertices = 0;
+	int c = 0;
+	for (int i = 0; i < _numFaces; i++) {
+		const MeshFace &face = _faces[i];
+		for (int j = 0; j < face._numVertices; j++, c++) {
+			int vert = face._vertices[j];
+			int tex = face._texVertices ? face._texVertices[j] : -1;
+			int d = first[vert];
+			while (d != -1 && texOf[d] != tex)
+				d = next[d];
+			if (d == -1) {
+				d = _numDrawVertices++;
+				vertOf[d] = vert;
+				texOf[d] = tex;
+				next[d] = first[vert];
+				first[vert] = d;
+			}
+			corners[c] = d;
+		}
+	}
+
+	_drawVertices = new float[3 * _numDrawVertices];
+	_drawNormals = new float[3 * _numDrawVertices];
+	_drawTextureVerts = new float[2 * _numDrawVertices];
+	for (int d = 0; d < _numDrawVertices; d++) {
+		memcpy(_drawVertices + 3 * d, _vertices + 3 * vertOf[d], 3 * sizeof(float));
+		memcpy(_drawNormals + 3 * d, _vertNormals + 3 * vertOf[d], 3 * sizeof(float));
+		if (texOf[d] != -1) {
+			_drawTextureVerts[2 * d] = _textureVerts[2 * texOf[d]];
+			_drawTextureVerts[2 * d + 1] = _textureVerts[2 * texOf[d] + 1];
+		} else {
+			_drawTextureVerts[2 * d] = 0.f;
+			_drawTextureVerts[2 * d + 1] = 0.f;
+		}
+	}
+
+	// The faces are fanned the same way a polygon is, and consecutive faces
+	// using the same material go in the same batch, so the faces are still
+	// drawn in their original order.
+	_drawIndices = new uint32[numIndices];
+	_batches = new MeshBatch[_numFaces];
+	_numBatches = 0;
+	c = 0;
+	int n = 0;
+	for (int i = 0; i < _numFaces; i++) {
+		const MeshFace &face = _faces[i];
+		if (i == 0 || _materialid[i] != _materialid[i - 1]) {
+			MeshBatch &batch = _batches[_numBatches++];
+			batch._firstFace = i;
+			batch._numFaces = 0;
+			batch._firstIndex = n;
+			batch._numIndices = 0;
+		}
+		for (int j = face._numVertices - 1; j >= 2; j--) {
+			_drawIndices[n++] = corners[c + j];
+			_drawIndices[n++] = corners[c];
+			_drawIndices[n++] = corners[c + j - 1];
+		}
+		MeshBatch &batch = _batches[_numBatches - 1];
+		batch._numFaces++;
+		batch._numIndices = n - batch._firstIndex;
+		c += face._numVertices;
+	}
+
+	delete[] first;
+	delete[] next;
+	delete[] texOf;
+	delete[] vertOf;
+	delete[] corners;
 }
 
 void Mesh::update() {
@@ -549,8 +642,11 @@ void Mesh::draw() const {
 	if (_lightingMode == 0)
 		g_driver->disableLights();
 
-	for (int i = 0; i < _numFaces; i++)
-		_faces[i].draw(_vertices, _vertNormals, _textureVerts);
+	for (int i = 0; i < _numBatches; i++) {
+		const MeshBatch &batch = _batches[i];
+		_faces[batch._firstFace]._material->select();
+		g_driver->drawMeshBatch(this, batch);
+	}
 
 	if (_lightingMode == 0)
 		g_driver->enableLights();
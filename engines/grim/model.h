@@ -100,7 +100,6 @@ public:
 class MeshFace {
 public:
 	int loadBinary(Common::SeekableReadStream *data, Material *materials[]);
-	void draw(float *vertices, float *vertNormals, float *textureVerts) const;
 	void changeMaterial(Material *material);
 	~MeshFace();
 
@@ -112,6 +111,15 @@ public:
 	Math::Vector3d _normal;
 };
 
+/**
+ * A run of consecutive faces of a mesh sharing the same material, drawn
+ * with a single call as a list of triangles.
+ */
+struct MeshBatch {
+	int _firstFace, _numFaces;
+	int _firstIndex, _numIndices;
+};
+
 class Mesh {
 public:
 	void loadBinary(Common::SeekableReadStream *data, Material *materials[]);
@@ -120,7 +128,8 @@ public:
 	void draw() const;
 	void getBoundingBox(int *x1, int *y1, int *x2, int *y2) const;
 	void update();
-	Mesh() : _numFaces(0) { }
+	Mesh() : _numFaces(0), _numDrawVertices(0), _drawVertices(NULL), _drawNormals(NULL),
+		_drawTextureVerts(NULL), _drawIndices(NULL), _numBatches(0), _batches(NULL) { }
 	~Mesh();
 
 	char _name[32];
@@ -139,6 +148,19 @@ public:
 	int _numFaces;
 	MeshFace *_faces;
 	Math::Matrix4 _matrix;
+
+	// The faces as indexed triangles, over one vertex per distinct pair of
+	// vertex and texture vertex, so that each one is only transformed once.
+	int _numDrawVertices;
+	float *_drawVertices;		// sets of 3
+	float *_drawNormals;		// sets of 3
+	float *_drawTextureVerts;	// sets of 2
+	uint32 *_drawIndices;		// sets of 3
+	int _numBatches;
+	MeshBatch *_batches;
+
+private:
+	void prepareDraw();
 };
 
 class ModelNode {
@@ -21,6 +21,7 @@ MODULE_OBJS := \
 	imuse/imuse_music.o \
 	imuse/imuse_script.o \
 	imuse/imuse_sndmgr.o \
+	imuse/imuse_stream.o \
 	imuse/imuse_tables.o \
 	imuse/imuse_track.o \
 	lua/lapi.o \
@@ -62,6 +63,7 @@ MODULE_OBJS := \
 	color.o \
 	colormap.o \
 	debug.o \
+	debugger.o \
 	detection.o \
 	font.o \
 	gfx_base.o \
@@ -86,10 +88,12 @@ MODULE_OBJS := \
 	model.o \
 	modelemi.o \
 	objectstate.o \
+	prefetch.o \
 	primitives.o \
 	registry.o \
 	resource.o \
 	savegame.o \
+	savewriter.o \
 	set.o \
 	scx.o \
 	sector.o \
@@ -20,6 +20,8 @@
  *
  */
 
+#include "common/config-manager.h"
+
 #include "graphics/surface.h"
 #include "video/bink_decoder.h"
 
@@ -34,7 +36,9 @@ MoviePlayer *CreateBinkPlayer(bool demo) {
 }
 
 BinkPlayer::BinkPlayer(bool demo) : MoviePlayer(), _demo(demo) {
-	_videoDecoder = new Video::BinkDecoder();
+	Video::BinkDecoder *bink = new Video::BinkDecoder();
+	bink->setThreadCount(ConfMan.getInt("movie_threads"));
+	_videoDecoder = bink;
 }
 
 bool BinkPlayer::loadFile(Common::String filename) {
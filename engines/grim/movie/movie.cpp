@@ -22,6 +22,7 @@
 
 #include "graphics/surface.h"
 
+#include "common/config-manager.h"
 #include "common/system.h"
 #include "common/timer.h"
 
@@ -48,11 +49,24 @@ MoviePlayer::MoviePlayer() {
 	_videoDecoder = NULL;
 	_internalSurface = NULL;
 	_externalSurface = new Graphics::Surface();
+	_framesAhead = 0;
+	_ring = NULL;
+	_ringSize = 0;
+	_ringHead = 0;
+	_ringCount = 0;
+	_shownFrame = -1;
+	_heldFrame = -1;
+	_decoderDone = false;
+	_decoderQuit = false;
+	_decoderThread = 0;
+	_clockStart = 0;
+	_pauseStart = 0;
 
 	g_system->getTimerManager()->installTimerProc(&timerCallback, 10000, NULL);
 }
 
 MoviePlayer::~MoviePlayer() {
+	stopDecoder();
 	deinit();
 	delete _videoDecoder;
 	g_system->getTimerManager()->removeTimerProc(&timerCallback);
@@ -60,22 +74,210 @@ MoviePlayer::~MoviePlayer() {
 
 void MoviePlayer::pause(bool p) {
 	Common::StackLock lock(_frameMutex);
+	Common::StackLock ringLock(_ringMutex);
+	if (p && !_videoPause)
+		_pauseStart = g_system->getMillis();
+	else if (!p && _videoPause)
+		_clockStart += g_system->getMillis() - _pauseStart;
 	_videoPause = p;
 	_videoDecoder->pauseVideo(p);
 }
 
 void MoviePlayer::stop() {
+	stopDecoder();
 	Common::StackLock lock(_frameMutex);
 	deinit();
 	g_grim->setMode(GrimEngine::NormalMode);
 }
 
 void MoviePlayer::timerCallback(void *) {
+	{
+		Common::StackLock lock(g_movie->_ringMutex);
+		if (g_movie->_decoderThread) {
+			g_movie->presentFrame();
+			return;
+		}
+	}
+
 	Common::StackLock lock(g_movie->_frameMutex);
-	if (g_movie->prepareFrame())
+	if (!g_movie->_decoderThread && g_movie->prepareFrame())
 		g_movie->postHandleFrame();
 }
 
+void MoviePlayer::startDecoder() {
+	_framesAhead = MAX(ConfMan.getInt("movie_frames_ahead"), 0);
+	if (!_framesAhead || !_decoderWake.isValid() || !canDecodeAhead())
+		return;
+
+	Common::StackLock lock(_ringMutex);
+	_ringSize = _framesAhead + 2;
+	_ring = new Frame[_ringSize];
+	_ringHead = 0;
+	_ringCount = 0;
+	_shownFrame = -1;
+	_heldFrame = -1;
+	_decoderDone = false;
+	_decoderQuit = false;
+	_clockStart = _pauseStart = g_system->getMillis();
+	_decoderThread = g_system->createThread(decoderEntry, this);
+	if (_decoderThread) {
+		_decoderWake.post();
+	} else {
+		delete[] _ring;
+		_ring = NULL;
+		_ringSize = 0;
+	}
+}
+
+void MoviePlayer::stopDecoder() {
+	if (!_decoderThread)
+		return;
+
+	_ringMutex.lock();
+	_decoderQuit = true;
+	_ringMutex.unlock();
+	_decoderWake.post();
+	g_system->joinThread(_decoderThread);
+
+	// the timer may be presenting a frame until the thread is cleared
+	Common::StackLock lock(_frameMutex);
+	Common::StackLock ringLock(_ringMutex);
+	_decoderThread = 0;
+	for (int i = 0; i < _ringSize; i++)
+		_ring[i].surface.free();
+	delete[] _ring;
+	_ring = NULL;
+	_ringSize = 0;
+	_ringCount = 0;
+	_shownFrame = -1;
+	_heldFrame = -1;
+	_internalSurface = NULL;
+}
+
+uint32 MoviePlayer::playerClock() const {
+	return (_videoPause ? _pauseStart : g_system->getMillis()) - _clockStart;
+}
+
+int MoviePlayer::decoderEntry(void *param) {
+	MoviePlayer *player = static_cast<MoviePlayer *>(param);
+	for (;;) {
+		player->_decoderWake.wait();
+
+		player->_ringMutex.lock();
+		bool quit = player->_decoderQuit;
+		player->_ringMutex.unlock();
+		if (quit)
+			break;
+
+		while (player->decodeAhead())
+			;
+	}
+	return 0;
+}
+
+// Copies a frame into a surface, which keeps its pixels if the size matches.
+static void copyFrame(Graphics::Surface &dst, const Graphics::Surface &src) {
+	if (dst.w != src.w || dst.h != src.h || dst.format != src.format)
+		dst.create(src.w, src.h, src.format);
+	for (int y = 0; y < src.h; y++)
+		memcpy((byte *)dst.pixels + y * dst.pitch, (const byte *)src.pixels + y * src.pitch, src.w * src.format.bytesPerPixel);
+}
+
+/**
+ * Decodes one more frame into the ring if there is room for it, and returns
+ * whether it did.
+ */
+bool MoviePlayer::decodeAhead() {
+	Common::StackLock lock(_frameMutex);
+
+	int slot;
+	{
+		Common::StackLock ringLock(_ringMutex);
+		if (_decoderQuit || _decoderDone || _ringCount >= _framesAhead)
+			return false;
+		slot = (_ringHead + _ringCount) % _ringSize;
+		// the engine may still read its frame, wait for it to take the next
+		if (slot == _shownFrame || slot == _heldFrame)
+			return false;
+	}
+
+	const Graphics::Surface *surface = NULL;
+	uint32 due = 0;
+	if (_videoLooping || !_videoDecoder->endOfVideo()) {
+		// the due time is kept in the clock of the player, which the timer
+		// reads without touching the decoder
+		uint32 wait = _videoDecoder->getTimeToNextFrame();
+		if (wait) {
+			Common::StackLock ringLock(_ringMutex);
+			due = playerClock() + wait;
+		}
+		surface = _videoDecoder->decodeNextFrame();
+	}
+
+	Common::StackLock ringLock(_ringMutex);
+	if (!surface) {
+		_decoderDone = true;
+		return false;
+	}
+	// the position in the video is the one the frame will be shown at
+	uint32 now = playerClock();
+	copyFrame(_ring[slot].surface, *surface);
+	_ring[slot].due = due;
+	_ring[slot].time = _videoDecoder->getElapsedTime() + (due > now ? due - now : 0);
+	_ring[slot].frame = _videoDecoder->getCurFrame();
+	_ringCount++;
+	return true;
+}
+
+/**
+ * Presents the latest of the frames decoded ahead which are due, dropping
+ * the earlier ones. Needs _ringMutex.
+ */
+void MoviePlayer::presentFrame() {
+	if (!_ring || _videoPause || _videoFinished)
+		return;
+
+	if (!_ringCount) {
+		if (_decoderDone) {
+			_videoFinished = true;
+			g_grim->setMode(GrimEngine::NormalMode);
+			_videoPause = true;
+		}
+		return;
+	}
+
+	uint32 now = playerClock();
+	if (_ring[_ringHead].due > now)
+		return;
+
+	do {
+		_shownFrame = _ringHead;
+		_ringHead = (_ringHead + 1) % _ringSize;
+		_ringCount--;
+	} while (_ringCount && _ring[_ringHead].due <= now);
+
+	_internalSurface = &_ring[_shownFrame].surface;
+	_frame = _ring[_shownFrame].frame;
+	_movieTime = _ring[_shownFrame].time;
+	_updateNeeded = true;
+	_decoderWake.post();
+}
+
+void MoviePlayer::flushFrames() {
+	Common::StackLock lock(_ringMutex);
+	if (!_decoderThread)
+		return;
+
+	// the next frame goes right after the one presented, as the engine may
+	// still read the slots before it
+	_ringHead = (_shownFrame + 1) % _ringSize;
+	_ringCount = 0;
+	_decoderDone = false;
+	// the due times of the next frames count from the position seeked to
+	_clockStart = _pauseStart = g_system->getMillis();
+	_decoderWake.post();
+}
+
 bool MoviePlayer::prepareFrame() {
 	if (!_videoLooping && _videoDecoder->endOfVideo()) {
 		_videoFinished = true;
@@ -105,6 +307,20 @@ bool MoviePlayer::prepareFrame() {
 }
 
 Graphics::Surface *MoviePlayer::getDstSurface() {
+	{
+		// the frame is handed over as it is, and not overwritten until the
+		// next one is asked for. The ring itself is only freed by
+		// stopDecoder(), on the thread which reads the frame.
+		Common::StackLock lock(_ringMutex);
+		if (_decoderThread) {
+			_heldFrame = _shownFrame;
+			_decoderWake.post();
+			if (!_ring || _shownFrame < 0)
+				return _externalSurface;
+			return &_ring[_shownFrame].surface;
+		}
+	}
+
 	Common::StackLock lock(_frameMutex);
 	if (_updateNeeded && _internalSurface) {
 		_externalSurface->copyFrom(*_internalSurface);
@@ -136,6 +352,7 @@ void MoviePlayer::deinit() {
 }
 
 bool MoviePlayer::play(Common::String filename, bool looping, int x, int y) {
+	stopDecoder();
 	Common::StackLock lock(_frameMutex);
 	deinit();
 	_x = x;
@@ -151,8 +368,10 @@ bool MoviePlayer::play(Common::String filename, bool looping, int x, int y) {
 	init();
 	_internalSurface = NULL;
 
+	startDecoder();
 	// Get the first frame immediately
-	timerCallback(0);
+	if (!_decoderThread)
+		timerCallback(0);
 
 	return true;
 }
@@ -25,6 +25,9 @@
 
 #include "common/mutex.h"
 #include "common/system.h"
+#include "common/thread.h"
+
+#include "graphics/surface.h"
 
 #include "video/video_decoder.h"
 
@@ -49,6 +52,33 @@ protected:
 	bool _videoLooping;
 	int _x, _y;
 
+	/**
+	 * A frame decoded ahead of the time it is due.
+	 */
+	struct Frame {
+		Graphics::Surface surface;
+		uint32 due;			// in the clock of the player, 0 for at once
+		uint32 time;		// position in the video
+		int32 frame;
+	};
+
+	// When the decoder thread runs, the frames go through a ring: the one
+	// presented last, the one the engine reads, and the ones decoded ahead.
+	int _framesAhead;
+	Frame *_ring;
+	int _ringSize;
+	int _ringHead;			// next frame to present
+	int _ringCount;			// frames decoded and not presented yet
+	int _shownFrame;		// frame presented last, or -1
+	int _heldFrame;			// frame the engine reads, or -1
+	bool _decoderDone;
+	bool _decoderQuit;
+	OSystem::ThreadRef _decoderThread;	// set and cleared under both mutexes
+	uint32 _clockStart;		// the clock of the player, without the pauses
+	uint32 _pauseStart;
+	Common::Semaphore _decoderWake;
+	Common::Mutex _ringMutex;	// guards the ring, taken after _frameMutex
+
 public:
 	MoviePlayer();
 	virtual ~MoviePlayer();
@@ -90,6 +120,25 @@ public:
 
 protected:
 	static void timerCallback(void *ptr);
+
+	/**
+	 * Whether the frames can be decoded ahead on a thread of their own, which
+	 * is done if the "movie_frames_ahead" setting is not 0. The frames must
+	 * then be decoded by decodeNextFrame() alone, without any handleFrame()
+	 * or postHandleFrame().
+	 */
+	virtual bool canDecodeAhead() { return true; }
+	void startDecoder();
+	void stopDecoder();
+	/**
+	 * Drops the frames decoded ahead and restarts the clock of the player,
+	 * after a seek. Needs _frameMutex.
+	 */
+	void flushFrames();
+	/** Needs _ringMutex. */
+	void presentFrame();
+	/** Milliseconds played since the decoder started. Needs _ringMutex. */
+	uint32 playerClock() const;
 	/**
 	 * Handles basic stuff per frame, like copying the latest frame to
 	 * _externalBuffer, and updating the frame-counters.
@@ -150,6 +199,10 @@ protected:
 	 * @param filename		The filename to be handled.
 	 */
 	virtual bool loadFile(Common::String filename);
+
+private:
+	static int decoderEntry(void *param);
+	bool decodeAhead();
 };
 
 
@@ -51,6 +51,7 @@ public:
 	void deliverFrameFromDecode(int width, int height, uint16 *dat);
 private:
 	void handleFrame();
+	bool canDecodeAhead() { return false; }
 	void init();
 	void deinit();
 	bool loadFile(Common::String filename);
@@ -86,7 +86,9 @@ void SmushPlayer::postHandleFrame() {
 void SmushPlayer::restoreState(SaveGame *state) {
 	MoviePlayer::restoreState(state);
 	if (isPlaying()) {
+		Common::StackLock lock(_frameMutex);
 		getDecoder()->seekToTime((uint32)_movieTime); // Currently not fully working (out of synch)
+		flushFrames();
 	}
 }
 
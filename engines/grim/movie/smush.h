@@ -40,6 +40,8 @@ private:
 	bool loadFile(Common::String filename);
 	void handleFrame();
 	void postHandleFrame();
+	// the demo moves its frames around
+	bool canDecodeAhead() { return !_demo; }
 	SmushDecoder* getDecoder();
 	void init();
 	bool _demo;
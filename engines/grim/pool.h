@@ -3,7 +3,6 @@
 #define GRIM_POOL_H
 
 #include "common/hashmap.h"
-#include "common/list.h"
 #include "common/foreach.h"
 
 #include "engines/grim/savegame.h"
@@ -79,21 +78,19 @@ public:
 	 * This class wraps a C pointer to T, subclass of PoolObject, which gets reset to NULL as soon as
 	 * the object is deleted, e.g by Pool::restoreObjects().
 	 * Its operator overloads allows the Ptr class to be used as if it was a raw C pointer.
+	 * The pointers to an object are chained in an intrusive list, so copying one never allocates.
 	 */
 	class Ptr {
 	public:
-		Ptr() : _obj(NULL) { }
+		Ptr() : _obj(NULL), _prev(NULL), _next(NULL) { }
 		Ptr(T *obj) : _obj(obj) {
-			if (_obj)
-				_obj->addPointer(this);
+			attach();
 		}
 		Ptr(const Ptr &ptr) : _obj(ptr._obj) {
-			if (_obj)
-				_obj->addPointer(this);
+			attach();
 		}
 		~Ptr() {
-			if (_obj)
-				_obj->removePointer(this);
+			detach();
 		}
 
 		Ptr &operator=(T *obj);
@@ -109,9 +106,13 @@ public:
 		inline operator T*() const { return _obj; }
 
 	private:
-		inline void reset() { _obj = NULL; }
+		inline void attach();
+		inline void detach();
+		inline void reset() { _obj = NULL; _prev = _next = NULL; }
 
 		T *_obj;
+		Ptr *_prev;
+		Ptr *_next;
 
 		friend class PoolObject;
 	};
@@ -129,14 +130,12 @@ protected:
 
 private:
 	void setId(int id);
-	void addPointer(Ptr *pointer) { _pointers.push_back(pointer); }
-	void removePointer(Ptr *pointer) { _pointers.remove(pointer); }
 
 	int _id;
 	static int s_id;
 	static Pool *s_pool;
 
-	Common::List<Ptr *> _pointers;
+	Ptr *_pointers;
 
 	friend class Pool;
 	friend class Ptr;
@@ -159,7 +158,8 @@ template <class T, int32 tag>
 typename PoolObject<T, tag>::Pool *PoolObject<T, tag>::s_pool = NULL;
 
 template <class T, int32 tag>
-PoolObject<T, tag>::PoolObject() {
+PoolObject<T, tag>::PoolObject() :
+	_pointers(NULL) {
 	++s_id;
 	_id = s_id;
 
@@ -173,8 +173,11 @@ template <class T, int32 tag>
 PoolObject<T, tag>::~PoolObject() {
 	s_pool->removeObject(_id);
 
-	for (typename Common::List<Ptr *>::iterator i = _pointers.begin(); i != _pointers.end(); ++i) {
-		(*i)->reset();
+	Ptr *pointer = _pointers;
+	while (pointer) {
+		Ptr *next = pointer->_next;
+		pointer->reset();
+		pointer = next;
 	}
 }
 
@@ -317,31 +320,47 @@ void PoolObject<T, tag>::Pool::restoreObjects(SaveGame *state) {
 }
 
 template<class T, int32 tag>
-typename PoolObject<T, tag>::Ptr &PoolObject<T, tag>::Ptr::operator=(T *obj) {
+void PoolObject<T, tag>::Ptr::attach() {
+	_prev = NULL;
 	if (_obj) {
-		_obj->removePointer(this);
-	}
-	_obj = obj;
-	if (obj) {
-		obj->addPointer(this);
+		_next = _obj->_pointers;
+		if (_next)
+			_next->_prev = this;
+		_obj->_pointers = this;
+	} else {
+		_next = NULL;
 	}
+}
 
-	return *this;
+template<class T, int32 tag>
+void PoolObject<T, tag>::Ptr::detach() {
+	if (!_obj)
+		return;
+
+	if (_prev)
+		_prev->_next = _next;
+	else
+		_obj->_pointers = _next;
+	if (_next)
+		_next->_prev = _prev;
 }
 
 template<class T, int32 tag>
-typename PoolObject<T, tag>::Ptr &PoolObject<T, tag>::Ptr::operator=(const Ptr &ptr) {
-	if (_obj) {
-		_obj->removePointer(this);
-	}
-	_obj = ptr._obj;
-	if (_obj) {
-		_obj->addPointer(this);
+typename PoolObject<T, tag>::Ptr &PoolObject<T, tag>::Ptr::operator=(T *obj) {
+	if (_obj != obj) {
+		detach();
+		_obj = obj;
+		attach();
 	}
 
 	return *this;
 }
 
+template<class T, int32 tag>
+typename PoolObject<T, tag>::Ptr &PoolObject<T, tag>::Ptr::operator=(const Ptr &ptr) {
+	return *this = ptr._obj;
+}
+
 }
 
 #endif
@@ -0,0 +1,204 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#include "common/array.h"
+
+#include "engines/grim/prefetch.h"
+#include "engines/grim/lab.h"
+
+namespace Grim {
+
+static volatile byte g_pageSink;
+
+ResourcePrefetcher::ResourcePrefetcher(const Common::List<Lab *> &labs) :
+		_labs(labs), _thread(0), _quit(false) {
+	if (_wake.isValid())
+		_thread = g_system->createThread(threadEntry, this);
+}
+
+ResourcePrefetcher::~ResourcePrefetcher() {
+	if (_thread) {
+		_mutex.lock();
+		_quit = true;
+		_mutex.unlock();
+		_wake.post();
+		g_system->joinThread(_thread);
+	}
+
+	for (Common::List<File>::iterator i = _done.begin(); i != _done.end(); ++i)
+		delete[] i->data;
+}
+
+void ResourcePrefetcher::prefetchSet(const Common::String &fname) {
+	if (!_thread)
+		return;
+
+	Common::String name(fname);
+	name.toLowercase();
+
+	_mutex.lock();
+	bool queued = false;
+	for (Common::List<Common::String>::iterator i = _requests.begin(); i != _requests.end(); ++i) {
+		if (*i == name) {
+			queued = true;
+			break;
+		}
+	}
+	if (!queued)
+		_requests.push_back(name);
+	_mutex.unlock();
+
+	if (!queued)
+		_wake.post();
+}
+
+void ResourcePrefetcher::collect(Common::List<File> &files) {
+	if (!_thread)
+		return;
+
+	Common::StackLock lock(_mutex);
+	while (!_done.empty()) {
+		files.push_back(_done.front());
+		_done.pop_front();
+	}
+}
+
+int ResourcePrefetcher::threadEntry(void *param) {
+	static_cast<ResourcePrefetcher *>(param)->threadLoop();
+	return 0;
+}
+
+void ResourcePrefetcher::threadLoop() {
+	for (;;) {
+		_wake.wait();
+
+		Common::String fname;
+		_mutex.lock();
+		bool quit = _quit;
+		if (!quit && !_requests.empty()) {
+			fname = _requests.front();
+			_requests.pop_front();
+		}
+		_mutex.unlock();
+
+		if (quit)
+			break;
+		if (!fname.empty())
+			fetchSet(fname);
+	}
+}
+
+// Scans a text set file for the names of the files it loads.
+static void scanSetFile(const byte *data, uint32 len, Common::Array<Common::String> &names) {
+	const char *p = (const char *)data;
+	const char *end = p + len;
+
+	while (p < end) {
+		while (p < end && (*p == ' ' || *p == '\t'))
+			++p;
+		const char *line = p;
+		while (p < end && *p != '\n')
+			++p;
+		Common::String str(line, p - line);
+		++p;
+
+		// the lights and sectors reference no file
+		if (str.hasPrefix("section: lights"))
+			break;
+
+		const char *keys[] = { "colormap ", "background ", "zbuffer " };
+		for (int i = 0; i < 3; ++i) {
+			if (!str.hasPrefix(keys[i]))
+				continue;
+			const char *name = str.c_str() + strlen(keys[i]);
+			while (*name == ' ' || *name == '\t')
+				++name;
+			const char *nameEnd = name;
+			while (*nameEnd && *nameEnd != ' ' && *nameEnd != '\t' && *nameEnd != '\r')
+				++nameEnd;
+			Common::String file(name, nameEnd - name);
+			if (!file.empty() && file != "<none>.lbm")
+				names.push_back(file);
+		}
+	}
+}
+
+void ResourcePrefetcher::fetchSet(const Common::String &fname) {
+	uint32 len;
+	byte *buf;
+	const byte *data = fetchFile(fname, len, buf);
+	if (!data)
+		return;
+
+	Common::Array<Common::String> names;
+	if (len >= 7 && memcmp(data, "section", 7) == 0)
+		scanSetFile(data, len, names);
+	handOver(fname, buf, len);
+
+	for (uint i = 0; i < names.size(); ++i) {
+		Common::String name(names[i]);
+		name.toLowercase();
+		if (fetchFile(name, len, buf))
+			handOver(name, buf, len);
+	}
+}
+
+/**
+ * Brings a file in memory and returns its data. If the file is not mapped
+ * the data is read into buf, which must then be handed over.
+ */
+const byte *ResourcePrefetcher::fetchFile(const Common::String &fname, uint32 &len, byte *&buf) {
+	buf = NULL;
+
+	// _labs is in priority order
+	for (Common::List<Lab *>::const_iterator i = _labs.begin(); i != _labs.end(); ++i) {
+		if (!(*i)->hasFile(fname))
+			continue;
+
+		const byte *data = (*i)->getMappedMember(fname, len);
+		if (data) {
+			byte sum = 0;
+			for (uint32 j = 0; j < len; j += 4096)
+				sum += data[j];
+			g_pageSink = sum;
+			return data;
+		}
+
+		buf = (*i)->readMember(fname, len);
+		return buf;
+	}
+	return NULL;
+}
+
+void ResourcePrefetcher::handOver(const Common::String &fname, byte *buf, uint32 len) {
+	if (!buf)
+		return;
+
+	File file;
+	file.fname = fname;
+	file.data = buf;
+	file.len = len;
+	Common::StackLock lock(_mutex);
+	_done.push_back(file);
+}
+
+} // end of namespace Grim
@@ -0,0 +1,82 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#ifndef GRIM_PREFETCH_H
+#define GRIM_PREFETCH_H
+
+#include "common/list.h"
+#include "common/mutex.h"
+#include "common/str.h"
+#include "common/system.h"
+#include "common/thread.h"
+
+namespace Grim {
+
+class Lab;
+
+/**
+ * Reads the files of a set on a background thread before the set is loaded:
+ * the set file, its colormaps and its background and z-buffer bitmaps.
+ *
+ * The pages of mapped archives are only touched, so that loading the set
+ * does not wait for the disk. The files of other archives are read into
+ * buffers which the engine thread collects into the resource cache.
+ * Without thread support in the backend nothing is prefetched.
+ */
+class ResourcePrefetcher {
+public:
+	/**
+	 * A file read ahead, whose data now belongs to the caller.
+	 */
+	struct File {
+		Common::String fname;
+		byte *data;
+		uint32 len;
+	};
+
+	ResourcePrefetcher(const Common::List<Lab *> &labs);
+	~ResourcePrefetcher();
+
+	/** Queue the files of a set, fname being the name of the set file. */
+	void prefetchSet(const Common::String &fname);
+	/** Take the files read since the last call. */
+	void collect(Common::List<File> &files);
+
+private:
+	static int threadEntry(void *param);
+	void threadLoop();
+	void fetchSet(const Common::String &fname);
+	const byte *fetchFile(const Common::String &fname, uint32 &len, byte *&buf);
+	void handOver(const Common::String &fname, byte *buf, uint32 len);
+
+	const Common::List<Lab *> &_labs;
+	OSystem::ThreadRef _thread;
+	Common::Semaphore _wake;
+	Common::Mutex _mutex;	// guards all of the following
+	Common::List<Common::String> _requests;
+	Common::List<File> _done;
+	bool _quit;
+};
+
+} // end of namespace Grim
+
+#endif
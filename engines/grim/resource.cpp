@@ -29,6 +29,7 @@
 #include "engines/grim/lipsync.h"
 #include "engines/grim/savegame.h"
 #include "engines/grim/lab.h"
+#include "engines/grim/prefetch.h"
 #include "engines/grim/bitmap.h"
 #include "engines/grim/font.h"
 #include "engines/grim/model.h"
@@ -37,6 +38,7 @@
 #include "engines/grim/inputdialog.h"
 #include "engines/grim/debug.h"
 #include "common/algorithm.h"
+#include "common/config-manager.h"
 #include "gui/message.h"
 
 namespace Grim {
@@ -58,9 +60,33 @@ public:
 	}
 };
 
+/**
+ * A stream over the data of a cache entry, which keeps the data alive until
+ * the stream is deleted even if the entry leaves the cache meanwhile.
+ */
+class CachedResourceStream : public Common::MemoryReadStream {
+public:
+	CachedResourceStream(ResourceLoader::ResourceCache *entry) :
+			Common::MemoryReadStream(entry->resPtr, entry->len), _entry(entry) {
+		_entry->refCount++;
+	}
+	~CachedResourceStream() {
+		if (--_entry->refCount == 0 && !_entry->cached) {
+			delete[] _entry->resPtr;
+			delete _entry;
+		}
+	}
+
+private:
+	ResourceLoader::ResourceCache *_entry;
+};
+
 ResourceLoader::ResourceLoader() {
-	_cacheDirty = false;
 	_cacheMemorySize = 0;
+	_cacheBudget = MAX(ConfMan.getInt("resource_cache_size"), 0) * 1024;
+	_cacheHits = 0;
+	_cacheMisses = 0;
+	_cacheEvictions = 0;
 
 	Lab *l;
 	Common::ArchiveMemberList files;
@@ -109,38 +135,26 @@ ResourceLoader::ResourceLoader() {
 		filename.toLowercase();
 
 		l = new Lab();
-		if (l->open(filename))
+		if (l->open(filename)) {
 			_files.add(filename, l, priority--, true);
-		else
+			_labs.push_back(l);
+		} else
 			delete l;
 	}
 
 	files.clear();
-}
 
-template<typename T>
-void clearList(Common::List<T> &list) {
-	while (!list.empty()) {
-		T p = list.front();
-		list.erase(list.begin());
-		delete p;
-	}
+	_prefetcher = new ResourcePrefetcher(_labs);
 }
 
 ResourceLoader::~ResourceLoader() {
-	for (Common::Array<ResourceCache>::iterator i = _cache.begin(); i != _cache.end(); ++i) {
-		ResourceCache &r = *i;
-		delete[] r.fname;
-		delete[] r.resPtr;
-	}
-	clearList(_models);
-	clearList(_colormaps);
-	clearList(_keyframeAnims);
-	clearList(_lipsyncs);
-}
-
-static int sortCallback(const void *entry1, const void *entry2) {
-	return scumm_stricmp(((ResourceLoader::ResourceCache *)entry1)->fname, ((ResourceLoader::ResourceCache *)entry2)->fname);
+	delete _prefetcher;
+	while (!_cacheLRU.empty())
+		removeFromCache(_cacheLRU.front());
+	_models.deleteAll();
+	_colormaps.deleteAll();
+	_keyframeAnims.deleteAll();
+	_lipsyncs.deleteAll();
 }
 
 Common::SeekableReadStream *ResourceLoader::getFileFromCache(const Common::String &filename) {
@@ -148,23 +162,20 @@ Common::SeekableReadStream *ResourceLoader::getFileFromCache(const Common::Strin
 	if (!entry)
 		return NULL;
 
-	return new Common::MemoryReadStream(entry->resPtr, entry->len);
+	// move it to the front of the LRU list
+	_cacheLRU.erase(entry->lruPos);
+	_cacheLRU.push_front(entry);
+	entry->lruPos = _cacheLRU.begin();
 
+	return new CachedResourceStream(entry);
 }
 
 ResourceLoader::ResourceCache *ResourceLoader::getEntryFromCache(const Common::String &filename) {
-	if (_cache.empty())
+	CacheMap::iterator i = _cache.find(filename);
+	if (i == _cache.end())
 		return NULL;
 
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
-	}
-
-	ResourceCache key;
-	key.fname = const_cast<char *>(filename.c_str());
-
-	return (ResourceLoader::ResourceCache *)bsearch(&key, _cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
+	return i->_value;
 }
 
 bool ResourceLoader::getFileExists(const Common::String &filename) {
@@ -186,33 +197,118 @@ Common::SeekableReadStream *ResourceLoader::openNewStreamFile(const char *filena
     fname.toLowercase();
 
 	if (cache) {
+		collectPrefetched();
 		s = getFileFromCache(fname);
-		if (!s) {
-			s = loadFile(fname);
-			if (!s)
-				return NULL;
-
-			uint32 size = s->size();
-			byte *buf = new byte[size];
-			s->read(buf, size);
-			putIntoCache(fname, buf, size);
-			return new Common::MemoryReadStream(buf, size);
-		} else
+		if (s) {
+			_cacheHits++;
 			return s;
+		}
+
+		// the files of mapped archives are read in place, without copy
+		uint32 size;
+		const byte *data = getMappedFile(fname, size);
+		if (data)
+			return new Common::MemoryReadStream(data, size);
+
+		_cacheMisses++;
+
+		s = loadFile(fname);
+		if (!s)
+			return NULL;
+
+		size = s->size();
+		byte *buf = new byte[size];
+		s->read(buf, size);
+		delete s;
+		s = new CachedResourceStream(putIntoCache(fname, buf, size));
+		trimCache();
+		return s;
 	}
 
 	return loadFile(fname);
 }
 
-void ResourceLoader::putIntoCache(const Common::String &fname, byte *res, uint32 len) {
-	ResourceCache entry;
-	entry.resPtr = res;
-	entry.len = len;
-	entry.fname = new char[fname.size() + 1];
-	strcpy(entry.fname, fname.c_str());
+const byte *ResourceLoader::getMappedFile(const Common::String &fname, uint32 &len) {
+	// _labs is in the same order as _files
+	for (Common::List<Lab *>::iterator i = _labs.begin(); i != _labs.end(); ++i) {
+		if ((*i)->hasFile(fname))
+			return (*i)->getMappedMember(fname, len);
+	}
+	return NULL;
+}
+
+ResourceLoader::ResourceCache *ResourceLoader::putIntoCache(const Common::String &fname, byte *res, uint32 len) {
+	ResourceCache *entry = new ResourceCache;
+	entry->fname = fname;
+	entry->resPtr = res;
+	entry->len = len;
+	entry->refCount = 0;
+	entry->cached = true;
+	_cacheLRU.push_front(entry);
+	entry->lruPos = _cacheLRU.begin();
+	_cache[fname] = entry;
 	_cacheMemorySize += len;
-	_cache.push_back(entry);
-	_cacheDirty = true;
+	return entry;
+}
+
+void ResourceLoader::removeFromCache(ResourceCache *entry) {
+	_cache.erase(entry->fname);
+	_cacheLRU.erase(entry->lruPos);
+	_cacheMemorySize -= entry->len;
+	entry->cached = false;
+	// otherwise the last stream reading it frees it
+	if (entry->refCount == 0) {
+		delete[] entry->resPtr;
+		delete entry;
+	}
+}
+
+void ResourceLoader::trimCache() {
+	// evict the least recently used files which are not being read
+	Common::List<ResourceCache *>::iterator i = _cacheLRU.end();
+	while (_cacheMemorySize > _cacheBudget && i != _cacheLRU.begin()) {
+		ResourceCache *entry = *--i;
+		if (entry->refCount == 0) {
+			++i;
+			removeFromCache(entry);
+			_cacheEvictions++;
+		}
+	}
+}
+
+void ResourceLoader::prefetchSet(const Common::String &fname) {
+	_prefetcher->prefetchSet(fname);
+}
+
+void ResourceLoader::collectPrefetched() {
+	Common::List<ResourcePrefetcher::File> files;
+	_prefetcher->collect(files);
+	if (files.empty())
+		return;
+
+	for (Common::List<ResourcePrefetcher::File>::iterator i = files.begin(); i != files.end(); ++i) {
+		if (_cache.contains(i->fname))
+			delete[] i->data;
+		else
+			putIntoCache(i->fname, i->data, i->len);
+	}
+	trimCache();
+}
+
+ResourceLoader::CacheStats ResourceLoader::getCacheStats() const {
+	CacheStats stats;
+	stats.entries = _cache.size();
+	stats.memorySize = _cacheMemorySize;
+	stats.budget = _cacheBudget;
+	stats.hits = _cacheHits;
+	stats.misses = _cacheMisses;
+	stats.evictions = _cacheEvictions;
+	return stats;
+}
+
+void ResourceLoader::setCacheBudget(uint32 bytes) {
+	_cacheBudget = bytes;
+	trimCache();
 }
 
 Bitmap *ResourceLoader::loadBitmap(const Common::String &filename) {
@@ -231,13 +327,14 @@ Bitmap *ResourceLoader::loadBitmap(const Common::String &filename) {
 }
 
 CMap *ResourceLoader::loadColormap(const Common::String &filename) {
-	Common::SeekableReadStream *stream = openNewStreamFile(filename.c_str());
+	Common::SeekableReadStream *stream = openNewStreamFile(filename.c_str(), true);
 	if (!stream) {
 		error("Could not find colormap %s", filename.c_str());
 	}
 
+	uint32 size = stream->size();
 	CMap *result = new CMap(filename, stream);
-	_colormaps.push_back(result);
+	_colormaps.add(filename, result, size);
 
 	return result;
 }
@@ -291,8 +388,9 @@ KeyframeAnim *ResourceLoader::loadKeyframe(const Common::String &filename) {
 	if(!stream)
 		error("Could not find keyframe file %s", filename.c_str());
 
+	uint32 size = stream->size();
 	KeyframeAnim *result = new KeyframeAnim(filename, stream);
-	_keyframeAnims.push_back(result);
+	_keyframeAnims.add(filename, result, size);
 
 	return result;
 }
@@ -305,11 +403,12 @@ LipSync *ResourceLoader::loadLipSync(const Common::String &filename) {
 	if(!stream)
 		return NULL;
 
+	uint32 size = stream->size();
 	result = new LipSync(filename, stream);
 
 	// Some lipsync files have no data
 	if (result->isValid())
-		_lipsyncs.push_back(result);
+		_lipsyncs.add(filename, result, size);
 	else {
 		delete result;
 		result = NULL;
@@ -340,8 +439,9 @@ Model *ResourceLoader::loadModel(const Common::String &filename, CMap *c, Model
 	if(!stream)
 		error("Could not find model %s", filename.c_str());
 
+	uint32 size = stream->size();
 	Model *result = new Model(filename, stream, c, parent);
-	_models.push_back(result);
+	_models.add(getModelKey(filename, c), result, size);
 
 	return result;
 }
@@ -381,20 +481,9 @@ void ResourceLoader::uncache(const char *filename) {
 	Common::String fname = filename;
 	fname.toLowercase();
 
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
-	}
-
-	for (unsigned int i = 0; i < _cache.size(); i++) {
-		if (fname.compareTo(_cache[i].fname) == 0) {
-			delete[] _cache[i].fname;
-			_cacheMemorySize -= _cache[i].len;
-			delete[] _cache[i].resPtr;
-			_cache.remove_at(i);
-			_cacheDirty = true;
-		}
-	}
+	ResourceCache *entry = getEntryFromCache(fname);
+	if (entry)
+		removeFromCache(entry);
 }
 
 void ResourceLoader::uncacheModel(Model *m) {
@@ -413,56 +502,68 @@ void ResourceLoader::uncacheLipSync(LipSync *s) {
 	_lipsyncs.remove(s);
 }
 
+ResourceLoader::ModelKey ResourceLoader::getModelKey(const Common::String &fname, const CMap *c) {
+	ModelKey key;
+	key._fname = fname;
+	if (c)
+		key._cmap = c->_fname;
+	return key;
+}
+
 ModelPtr ResourceLoader::getModel(const Common::String &fname, CMap *c) {
-	Common::String filename = fname;
-	filename.toLowercase();
-	for (Common::List<Model *>::const_iterator i = _models.begin(); i != _models.end(); ++i) {
-		Model *m = *i;
-		if (filename == m->_fname && *m->_cmap == *c) {
-			return m;
-		}
-	}
+	Model *m = _models.find(getModelKey(fname, c));
+	if (m)
+		return m;
 
 	return loadModel(fname, c);
 }
 
 CMapPtr ResourceLoader::getColormap(const Common::String &fname) {
-	Common::String filename = fname;
-	filename.toLowercase();
-	for (Common::List<CMap *>::const_iterator i = _colormaps.begin(); i != _colormaps.end(); ++i) {
-		CMap *c = *i;
-		if (filename.equals(c->_fname)) {
-			return c;
-		}
-	}
+	CMap *c = _colormaps.find(fname);
+	if (c)
+		return c;
 
 	return loadColormap(fname);
 }
 
 KeyframeAnimPtr ResourceLoader::getKeyframe(const Common::String &fname) {
-	Common::String filename = fname;
-	filename.toLowercase();
-	for (Common::List<KeyframeAnim *>::const_iterator i = _keyframeAnims.begin(); i != _keyframeAnims.end(); ++i) {
-		KeyframeAnim *k = *i;
-		if (filename == k->getFilename()) {
-			return k;
-		}
-	}
+	KeyframeAnim *k = _keyframeAnims.find(fname);
+	if (k)
+		return k;
 
 	return loadKeyframe(fname);
 }
 
 LipSyncPtr ResourceLoader::getLipSync(const Common::String &fname) {
-	Common::String filename = fname;
-	filename.toLowercase();
-	for (Common::List<LipSync *>::const_iterator i = _lipsyncs.begin(); i != _lipsyncs.end(); ++i) {
-		LipSync *l = *i;
-		if (filename == l->getFilename()) {
-			return l;
-		}
-	}
+	LipSync *l = _lipsyncs.find(fname);
+	if (l)
+		return l;
 
 	return loadLipSync(fname);
 }
 
+void ResourceLoader::getResidentStats(Common::Array<ResidentStats> &stats) const {
+	ResidentStats s;
+
+	s.type = "models";
+	s.count = _models.count();
+	s.bytes = _models.bytes();
+	stats.push_back(s);
+
+	s.type = "colormaps";
+	s.count = _colormaps.count();
+	s.bytes = _colormaps.bytes();
+	stats.push_back(s);
+
+	s.type = "keyframes";
+	s.count = _keyframeAnims.count();
+	s.bytes = _keyframeAnims.bytes();
+	stats.push_back(s);
+
+	s.type = "lipsyncs";
+	s.count = _lipsyncs.count();
+	s.bytes = _lipsyncs.bytes();
+	stats.push_back(s);
+}
+
 } // end of namespace Grim
@@ -24,7 +24,11 @@
 #define GRIM_RESOURCE_H
 
 #include "common/archive.h"
+#include "common/array.h"
 #include "common/file.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/list.h"
 
 #include "engines/grim/object.h"
 #include "engines/grim/lua/lua.h"
@@ -44,6 +48,7 @@ class TrackedObject;
 class SaveGame;
 class Skeleton;
 class Lab;
+class ResourcePrefetcher;
 
 typedef ObjectPtr<Material> MaterialPtr;
 typedef ObjectPtr<Bitmap> BitmapPtr;
@@ -53,6 +58,88 @@ typedef ObjectPtr<KeyframeAnim> KeyframeAnimPtr;
 typedef ObjectPtr<Font> FontPtr;
 typedef ObjectPtr<LipSync> LipSyncPtr;
 
+/**
+ * The loaded resources of one type which can be shared, indexed by a key
+ * built from their file name. Of several resources with the same key, the
+ * one loaded first is found, as long as it is alive.
+ */
+template<class T, class Key = Common::String, class Hash = Common::IgnoreCase_Hash, class EqualTo = Common::IgnoreCase_EqualTo>
+class ResourceRegistry {
+public:
+	ResourceRegistry() : _bytes(0) { }
+
+	T *find(const Key &key) const {
+		typename IndexMap::const_iterator i = _index.find(key);
+		return i == _index.end() ? NULL : i->_value;
+	}
+
+	/**
+	 * Registers a resource, size being the size of the file it was loaded
+	 * from.
+	 */
+	void add(const Key &key, T *res, uint32 size) {
+		Entry entry;
+		entry._res = res;
+		entry._key = key;
+		entry._size = size;
+		_resources.push_back(entry);
+		_bytes += size;
+		if (!_index.contains(key))
+			_index[key] = res;
+	}
+
+	void remove(T *res) {
+		typename EntryList::iterator i;
+		for (i = _resources.begin(); i != _resources.end(); ++i) {
+			if (i->_res == res)
+				break;
+		}
+		if (i == _resources.end())
+			return;
+
+		Key key = i->_key;
+		_bytes -= i->_size;
+		_resources.erase(i);
+
+		typename IndexMap::iterator j = _index.find(key);
+		if (j == _index.end() || j->_value != res)
+			return;
+		_index.erase(j);
+		// let an older resource with the same key take its place
+		EqualTo equal;
+		for (i = _resources.begin(); i != _resources.end(); ++i) {
+			if (equal(i->_key, key)) {
+				_index[key] = i->_res;
+				break;
+			}
+		}
+	}
+
+	void deleteAll() {
+		while (!_resources.empty()) {
+			T *res = _resources.front()._res;
+			remove(res);
+			delete res;
+		}
+	}
+
+	uint count() const { return _resources.size(); }
+	uint32 bytes() const { return _bytes; }
+
+private:
+	struct Entry {
+		T *_res;
+		Key _key;
+		uint32 _size;
+	};
+	typedef Common::List<Entry> EntryList;
+	typedef Common::HashMap<Key, T *, Hash, EqualTo> IndexMap;
+
+	EntryList _resources;
+	IndexMap _index;
+	uint32 _bytes;
+};
+
 class ResourceLoader {
 public:
 	ResourceLoader();
@@ -70,6 +157,11 @@ public:
 	Skeleton *loadSkeleton(const Common::String &fname);
 	Common::SeekableReadStream *openNewStreamFile(const char *filename, bool cache = false);
 	void uncache(const char *fname);
+	/**
+	 * Starts reading the files of a set in the background, fname being the
+	 * name of the set file.
+	 */
+	void prefetchSet(const Common::String &fname);
 	bool getFileExists(const Common::String &filename);  //TODO: make it const again at next scummvm sync
 
 	ModelPtr getModel(const Common::String &fname, CMap *c);
@@ -81,29 +173,85 @@ public:
 	void uncacheKeyframe(KeyframeAnim *kf);
 	void uncacheLipSync(LipSync *l);
 
+	/**
+	 * A file kept in memory by openNewStreamFile(). It is freed once it is
+	 * both out of the cache and no longer read by any stream.
+	 */
 	struct ResourceCache {
-		char *fname;
+		Common::String fname;
 		byte *resPtr;
 		uint32 len;
+		int refCount;		// streams reading resPtr
+		bool cached;
+		Common::List<ResourceCache *>::iterator lruPos;
+	};
+
+	struct CacheStats {
+		uint32 entries;
+		uint32 memorySize;
+		uint32 budget;
+		uint32 hits;
+		uint32 misses;
+		uint32 evictions;
+	};
+
+	struct ResidentStats {
+		const char *type;
+		uint count;
+		uint32 bytes;		// of the files the resources were loaded from
 	};
 
+	CacheStats getCacheStats() const;
+	void getResidentStats(Common::Array<ResidentStats> &stats) const;
+	/**
+	 * Sets the size above which the least recently used files are evicted
+	 * from the cache, unless they are still being read.
+	 */
+	void setCacheBudget(uint32 bytes);
+
 private:
 	Common::SeekableReadStream *loadFile(Common::String &filename);  //TODO: make it const again at next scummvm sync
 	Common::SeekableReadStream *getFileFromCache(const Common::String &filename);
 	ResourceLoader::ResourceCache *getEntryFromCache(const Common::String &filename);
-	void putIntoCache(const Common::String &fname, byte *res, uint32 len);
+	const byte *getMappedFile(const Common::String &fname, uint32 &len);
+	ResourceLoader::ResourceCache *putIntoCache(const Common::String &fname, byte *res, uint32 len);
+	void removeFromCache(ResourceCache *entry);
+	void trimCache();
+	void collectPrefetched();
 
 	Common::SearchSet _files;
+	Common::List<Lab *> _labs;	// owned by _files
+	ResourcePrefetcher *_prefetcher;
+
+	typedef Common::HashMap<Common::String, ResourceCache *> CacheMap;
+	CacheMap _cache;
+	Common::List<ResourceCache *> _cacheLRU;	// most recently used first
+	uint32 _cacheMemorySize;
+	uint32 _cacheBudget;
+	uint32 _cacheHits, _cacheMisses, _cacheEvictions;
 
-	Common::Array<ResourceCache> _cache;
-	bool _cacheDirty;
-	int32 _cacheMemorySize;
+	// a model is shared only with the same colormap
+	struct ModelKey {
+		Common::String _fname;
+		Common::String _cmap;
+	};
+	struct ModelKey_Hash {
+		uint operator()(const ModelKey &k) const {
+			return Common::hashit_lower(k._fname) * 31 + Common::hashit(k._cmap);
+		}
+	};
+	struct ModelKey_EqualTo {
+		bool operator()(const ModelKey &k1, const ModelKey &k2) const {
+			return k1._fname.equalsIgnoreCase(k2._fname) && k1._cmap == k2._cmap;
+		}
+	};
+	static ModelKey getModelKey(const Common::String &fname, const CMap *c);
 
 	Common::List<EMIModel *> _emiModels;
-	Common::List<Model *> _models;
-	Common::List<CMap *> _colormaps;
-	Common::List<KeyframeAnim *> _keyframeAnims;
-	Common::List<LipSync *> _lipsyncs;
+	ResourceRegistry<Model, ModelKey, ModelKey_Hash, ModelKey_EqualTo> _models;
+	ResourceRegistry<CMap> _colormaps;
+	ResourceRegistry<KeyframeAnim> _keyframeAnims;
+	ResourceRegistry<LipSync> _lipsyncs;
 };
 
 extern ResourceLoader *g_resourceloader;
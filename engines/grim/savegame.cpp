@@ -22,6 +22,7 @@
 
 #include "common/endian.h"
 #include "common/system.h"
+#include "common/zlib.h"
 
 #include "math/vector3d.h"
 
@@ -32,8 +33,31 @@ namespace Grim {
 
 #define SAVEGAME_HEADERTAG	'RSAV'
 #define SAVEGAME_FOOTERTAG	'ESAV'
+#define SAVEGAME_DIRECTORYTAG	'SDIR'
+#define SAVEGAME_METATAG	'META'
+#define SAVEINDEX_TAG		'RIDX'
+#define SAVEINDEX_VERSION	2
+#define SAVEINDEX_FILENAME	"grimsaves.idx"
+
+/*
+ * Savegame format (all the values are big endian):
+ *	'RSAV', version
+ *	'META', length of the header, and the header: description, date and
+ *	time, play time, size and pixels of the thumbnail
+ *	the data of each section, compressed on its own
+ *	'SDIR', number of sections, and for each one its tag, offset, length,
+ *	codec and decompressed length
+ *	offset of the directory, 'ESAV'
+ * The file itself is not compressed, so that the sections can be read from
+ * their offset without inflating everything before them.
+ */
+int SaveGame::SAVEGAME_VERSION = 23;
+
+SaveGameHeader::SaveGameHeader() :
+	version(0), year(0), month(0), day(0), hour(0), minute(0), playTime(0),
+	thumbnailWidth(0), thumbnailHeight(0) {
 
-int SaveGame::SAVEGAME_VERSION = 20;
+}
 
 SaveGame *SaveGame::openForLoading(const Common::String &filename) {
 	Common::InSaveFile *inSaveFile = g_system->getSavefileManager()->openForLoading(filename);
@@ -47,55 +71,238 @@ SaveGame *SaveGame::openForLoading(const Common::String &filename) {
 	save->_saving = false;
 	save->_inSaveFile = inSaveFile;
 
-	uint32 tag = inSaveFile->readUint32BE();
-	assert(tag == SAVEGAME_HEADERTAG);
-	save->_version = inSaveFile->readUint32BE();
+	// Older versions are rejected by the callers, and have no directory
+	bool ok = readHeader(inSaveFile, save->_header, false);
+	save->_version = save->_header.version;
+	if (ok && save->_version == SAVEGAME_VERSION)
+		ok = save->readDirectory();
+	if (!ok) {
+		warning("SaveGame::openForLoading() Savegame file %s is corrupt", filename.c_str());
+		delete save;
+		return NULL;
+	}
 
 	return save;
 }
 
 SaveGame *SaveGame::openForSaving(const Common::String &filename) {
-	Common::OutSaveFile *outSaveFile =  g_system->getSavefileManager()->openForSaving(filename);
-	if (!outSaveFile) {
-		warning("SaveGame::openForSaving() Error creating savegame file %s", filename.c_str());
-		return NULL;
-	}
-
 	SaveGame *save = new SaveGame();
 
 	save->_saving = true;
-	save->_outSaveFile = outSaveFile;
-
-	outSaveFile->writeUint32BE(SAVEGAME_HEADERTAG);
-	outSaveFile->writeUint32BE(SAVEGAME_VERSION);
+	save->_filename = filename;
 
 	save->_version = SAVEGAME_VERSION;
 
+	TimeDate t;
+	g_system->getTimeAndDate(t);
+	save->_header.year = t.tm_year + 1900;
+	save->_header.month = t.tm_mon + 1;
+	save->_header.day = t.tm_mday;
+	save->_header.hour = t.tm_hour;
+	save->_header.minute = t.tm_min;
+
 	return save;
 }
 
+bool SaveGame::readHeader(const Common::String &filename, SaveGameHeader &header, bool withThumbnail) {
+	Common::InSaveFile *file = g_system->getSavefileManager()->openForLoading(filename);
+	if (!file)
+		return false;
+	const bool ok = readHeader(file, header, withThumbnail);
+	delete file;
+	return ok;
+}
+
+bool SaveGame::readHeader(Common::InSaveFile *file, SaveGameHeader &header, bool withThumbnail) {
+	if (file->readUint32BE() != SAVEGAME_HEADERTAG)
+		return false;
+	header = SaveGameHeader();
+	header.version = file->readUint32BE();
+	if (header.version != SAVEGAME_VERSION)
+		return !file->err();  // let the caller reject it
+
+	if (file->readUint32BE() != SAVEGAME_METATAG)
+		return false;
+	const uint32 length = file->readUint32BE();
+	const uint32 descLength = file->readUint32BE();
+	if (file->err() || length < 18 || descLength > length - 18 ||
+			descLength > (uint32)(file->size() - file->pos()))
+		return false;
+	char *desc = new char[descLength];
+	file->read(desc, descLength);
+	header.description = Common::String(desc, descLength);
+	delete[] desc;
+	header.year = file->readUint16BE();
+	header.month = file->readByte();
+	header.day = file->readByte();
+	header.hour = file->readByte();
+	header.minute = file->readByte();
+	header.playTime = file->readUint32BE();
+	header.thumbnailWidth = file->readUint16BE();
+	header.thumbnailHeight = file->readUint16BE();
+	// no bigger thumbnails are written, and the length cannot overflow then
+	if (header.thumbnailWidth > kThumbnailWidth || header.thumbnailHeight > kThumbnailHeight)
+		return false;
+	const uint32 pixels = header.thumbnailWidth * header.thumbnailHeight;
+	if (length != descLength + 18 + pixels * 2)
+		return false;
+	if (withThumbnail) {
+		header.thumbnail.resize(pixels);
+		for (uint32 i = 0; i < pixels; i++)
+			header.thumbnail[i] = file->readUint16LE();
+	}
+	return !file->err();
+}
+
 SaveGame::SaveGame() :
-	_currentSection(0), _sectionBuffer(0) {
+	_inSaveFile(0), _outSaveFile(0), _currentSection(0), _sectionBuffer(0), _nextSection(0), _finished(false) {
 
 }
 
 SaveGame::~SaveGame() {
 	if (_saving) {
-		_outSaveFile->writeUint32BE(SAVEGAME_FOOTERTAG);
-		_outSaveFile->finalize();
-		if (_outSaveFile->err())
+		if (!_finished && !finish())
 			warning("SaveGame::~SaveGame() Can't write file. (Disk full?)");
-		delete _outSaveFile;
+		for (uint32 i = 0; i < _sectionData.size(); i++)
+			free(_sectionData[i]);
 	} else {
 		delete _inSaveFile;
 	}
 	free(_sectionBuffer);
 }
 
+bool SaveGame::finish() {
+	assert(_saving && !_finished && _currentSection == 0);
+	_finished = true;
+	free(_sectionBuffer);
+	_sectionBuffer = NULL;
+
+	// The file is only opened now, so that a savegame still being written
+	// to the same file is done with it first.
+	_outSaveFile = g_system->getSavefileManager()->openForSaving(_filename, false);
+	if (!_outSaveFile) {
+		warning("SaveGame::finish() Error creating savegame file %s", _filename.c_str());
+		return false;
+	}
+
+	writeFile();
+	_outSaveFile->finalize();
+	const bool ok = !_outSaveFile->err();
+	delete _outSaveFile;
+	_outSaveFile = NULL;
+	return ok;
+}
+
 int SaveGame::saveVersion() const {
 	return _version;
 }
 
+const SaveGameHeader &SaveGame::getHeader() const {
+	return _header;
+}
+
+void SaveGame::setDescription(const Common::String &description) {
+	_header.description = description;
+}
+
+void SaveGame::setPlayTime(uint32 playTime) {
+	_header.playTime = playTime;
+}
+
+void SaveGame::setThumbnail(const uint16 *data, int width, int height) {
+	_header.thumbnailWidth = width;
+	_header.thumbnailHeight = height;
+	_header.thumbnail.resize(width * height);
+	memcpy(&_header.thumbnail[0], data, width * height * 2);
+}
+
+bool SaveGame::readDirectory() {
+	const int32 size = _inSaveFile->size();
+	if (size < 24)
+		return false;
+	_inSaveFile->seek(size - 8, SEEK_SET);
+	const uint32 offset = _inSaveFile->readUint32BE();
+	if (_inSaveFile->readUint32BE() != SAVEGAME_FOOTERTAG || offset > (uint32)size - 16)
+		return false;
+
+	_inSaveFile->seek(offset, SEEK_SET);
+	if (_inSaveFile->readUint32BE() != SAVEGAME_DIRECTORYTAG)
+		return false;
+	const uint32 count = _inSaveFile->readUint32BE();
+	if (count > (size - offset - 16) / 20)
+		return false;
+	_sections.resize(count);
+	for (uint32 i = 0; i < count; i++) {
+		SectionInfo &info = _sections[i];
+		info.tag = _inSaveFile->readUint32BE();
+		info.offset = _inSaveFile->readUint32BE();
+		info.length = _inSaveFile->readUint32BE();
+		info.codec = _inSaveFile->readUint32BE();
+		info.rawLength = _inSaveFile->readUint32BE();
+		if (info.offset > offset || info.length > offset - info.offset)
+			return false;
+	}
+	return !_inSaveFile->err();
+}
+
+void SaveGame::writeFile() {
+	const SaveGameHeader &h = _header;
+	const uint32 pixels = h.thumbnailWidth * h.thumbnailHeight;
+	_outSaveFile->writeUint32BE(SAVEGAME_HEADERTAG);
+	_outSaveFile->writeUint32BE(SAVEGAME_VERSION);
+	_outSaveFile->writeUint32BE(SAVEGAME_METATAG);
+	_outSaveFile->writeUint32BE(h.description.size() + 18 + pixels * 2);
+	_outSaveFile->writeUint32BE(h.description.size());
+	_outSaveFile->write(h.description.c_str(), h.description.size());
+	_outSaveFile->writeUint16BE(h.year);
+	_outSaveFile->writeByte(h.month);
+	_outSaveFile->writeByte(h.day);
+	_outSaveFile->writeByte(h.hour);
+	_outSaveFile->writeByte(h.minute);
+	_outSaveFile->writeUint32BE(h.playTime);
+	_outSaveFile->writeUint16BE(h.thumbnailWidth);
+	_outSaveFile->writeUint16BE(h.thumbnailHeight);
+	for (uint32 i = 0; i < pixels; i++)
+		_outSaveFile->writeUint16LE(h.thumbnail[i]);
+
+	uint32 pos = 8 + 8 + h.description.size() + 18 + pixels * 2;
+	for (uint32 i = 0; i < _sections.size(); i++) {
+		SectionInfo &info = _sections[i];
+		byte *data = _sectionData[i];
+#if defined(USE_ZLIB)
+		// Keep the data as it is if it does not shrink
+		unsigned long length = info.rawLength;
+		byte *packed = (byte *)malloc(info.rawLength ? info.rawLength : 1);
+		if (packed && Common::compress(packed, &length, data, info.rawLength)) {
+			info.codec = kCodecZlib;
+			info.length = length;
+			free(data);
+			data = packed;
+		} else {
+			free(packed);
+		}
+#endif
+		info.offset = pos;
+		_outSaveFile->write(data, info.length);
+		free(data);
+		pos += info.length;
+	}
+	_sectionData.clear();
+
+	_outSaveFile->writeUint32BE(SAVEGAME_DIRECTORYTAG);
+	_outSaveFile->writeUint32BE(_sections.size());
+	for (uint32 i = 0; i < _sections.size(); i++) {
+		const SectionInfo &info = _sections[i];
+		_outSaveFile->writeUint32BE(info.tag);
+		_outSaveFile->writeUint32BE(info.offset);
+		_outSaveFile->writeUint32BE(info.length);
+		_outSaveFile->writeUint32BE(info.codec);
+		_outSaveFile->writeUint32BE(info.rawLength);
+	}
+	_outSaveFile->writeUint32BE(pos);
+	_outSaveFile->writeUint32BE(SAVEGAME_FOOTERTAG);
+}
+
 uint32 SaveGame::beginSection(uint32 sectionTag) {
 	assert(_version == SAVEGAME_VERSION);
 
@@ -104,22 +311,45 @@ uint32 SaveGame::beginSection(uint32 sectionTag) {
 	_currentSection = sectionTag;
 	_sectionSize = 0;
 	if (!_saving) {
-		uint32 tag = 0;
-
-		while (tag != sectionTag) {
-			tag = _inSaveFile->readUint32BE();
-			if (tag == SAVEGAME_FOOTERTAG)
-				error("Unable to find requested section of savegame");
-			_sectionSize = _inSaveFile->readUint32BE();
-			_inSaveFile->seek(_sectionSize, SEEK_CUR);
+		// The sections are usually read in the order they were written, so
+		// look from the one after the last section read
+		const uint32 count = _sections.size();
+		uint32 i;
+		for (i = 0; i < count; i++) {
+			if (_sections[(_nextSection + i) % count].tag == sectionTag)
+				break;
 		}
+		if (i == count)
+			error("Unable to find requested section of savegame");
+		const SectionInfo &info = _sections[(_nextSection + i) % count];
+		_nextSection = (_nextSection + i + 1) % count;
+
+		_sectionSize = info.rawLength;
 		if (!_sectionBuffer || _sectionAlloc < _sectionSize) {
 			_sectionAlloc = _sectionSize;
 			_sectionBuffer = (byte *)realloc(_sectionBuffer, _sectionAlloc);
 		}
 
-		_inSaveFile->seek(-(int32)_sectionSize, SEEK_CUR);
-		_inSaveFile->read(_sectionBuffer, _sectionSize);
+		_inSaveFile->seek(info.offset, SEEK_SET);
+		if (info.codec == kCodecStored) {
+			if (info.length != _sectionSize)
+				error("Corrupt section of savegame");
+			_inSaveFile->read(_sectionBuffer, _sectionSize);
+		} else if (info.codec == kCodecZlib) {
+#if defined(USE_ZLIB)
+			byte *data = (byte *)malloc(info.length);
+			_inSaveFile->read(data, info.length);
+			unsigned long length = _sectionSize;
+			const bool ok = Common::uncompress(_sectionBuffer, &length, data, info.length);
+			free(data);
+			if (!ok || length != _sectionSize)
+				error("Corrupt section of savegame");
+#else
+			error("Savegame sections are compressed, but zlib support is not compiled in");
+#endif
+		} else {
+			error("Unknown codec %d for savegame section", info.codec);
+		}
 
 	} else {
 		if (!_sectionBuffer) {
@@ -135,9 +365,21 @@ void SaveGame::endSection() {
 	if (_currentSection == 0)
 		error("Tried to end a save game section without starting a section");
 	if (_saving) {
-		_outSaveFile->writeUint32BE(_currentSection);
-		_outSaveFile->writeUint32BE(_sectionSize);
-		_outSaveFile->write(_sectionBuffer, _sectionSize);
+		// The sections are kept until the file is written, so that saving
+		// only costs a copy until then
+		SectionInfo info;
+		info.tag = _currentSection;
+		info.offset = 0;
+		info.codec = kCodecStored;
+		info.length = info.rawLength = _sectionSize;
+
+		byte *data = (byte *)malloc(_sectionSize ? _sectionSize : 1);
+		if (!data)
+			error("Failed to allocate space for savegame section");
+		memcpy(data, _sectionBuffer, _sectionSize);
+
+		_sections.push_back(info);
+		_sectionData.push_back(data);
 	}
 	_currentSection = 0;
 }
@@ -345,4 +587,141 @@ Common::String SaveGame::readString() {
 	return s;
 }
 
+static void writeIndexString(Common::OutSaveFile *file, const Common::String &string) {
+	file->writeUint32BE(string.size());
+	file->write(string.c_str(), string.size());
+}
+
+static Common::String readIndexString(Common::InSaveFile *file) {
+	const uint32 length = file->readUint32BE();
+	if (length > (uint32)(file->size() - file->pos()))
+		return Common::String();
+	char *buf = new char[length];
+	file->read(buf, length);
+	Common::String string(buf, length);
+	delete[] buf;
+	return string;
+}
+
+bool SaveGameIndex::readEntry(const Common::String &filename, Entry &entry) {
+	Common::InSaveFile *file = g_system->getSavefileManager()->openForLoading(filename);
+	if (!file)
+		return false;
+
+	// The footer of a savegame holds the offset of its directory, which
+	// changes with nearly any change to the file
+	const uint32 size = file->size();
+	uint32 tail = 0;
+	if (size >= 8 && file->seek(size - 8))
+		tail = file->readUint32BE();
+
+	if (entry.header.version == 0 || entry.fileSize != size || entry.fileTail != tail) {
+		entry.fileSize = size;
+		entry.fileTail = tail;
+		file->seek(0);
+		if (!SaveGame::readHeader(file, entry.header, false))
+			entry.header = SaveGameHeader();
+	}
+	delete file;
+	return true;
+}
+
+void SaveGameIndex::load(EntryMap &map) {
+	Common::InSaveFile *file = g_system->getSavefileManager()->openForLoading(SAVEINDEX_FILENAME);
+	if (!file)
+		return;
+	if (file->readUint32BE() == SAVEINDEX_TAG && file->readUint32BE() == SAVEINDEX_VERSION) {
+		const uint32 count = file->readUint32BE();
+		for (uint32 i = 0; i < count && !file->eos() && !file->err(); i++) {
+			const Common::String filename = readIndexString(file);
+			Entry entry;
+			entry.fileSize = file->readUint32BE();
+			entry.fileTail = file->readUint32BE();
+			SaveGameHeader &header = entry.header;
+			header.version = file->readUint32BE();
+			header.description = readIndexString(file);
+			header.year = file->readUint16BE();
+			header.month = file->readByte();
+			header.day = file->readByte();
+			header.hour = file->readByte();
+			header.minute = file->readByte();
+			header.playTime = file->readUint32BE();
+			if (file->eos() || file->err())
+				break;
+			map[filename] = entry;
+		}
+	}
+	delete file;
+}
+
+void SaveGameIndex::store(const EntryMap &map) {
+	Common::OutSaveFile *file = g_system->getSavefileManager()->openForSaving(SAVEINDEX_FILENAME, false);
+	if (!file) {
+		warning("SaveGameIndex::store() Error creating %s", SAVEINDEX_FILENAME);
+		return;
+	}
+	file->writeUint32BE(SAVEINDEX_TAG);
+	file->writeUint32BE(SAVEINDEX_VERSION);
+	file->writeUint32BE(map.size());
+	for (EntryMap::const_iterator i = map.begin(); i != map.end(); ++i) {
+		const SaveGameHeader &header = i->_value.header;
+		writeIndexString(file, i->_key);
+		file->writeUint32BE(i->_value.fileSize);
+		file->writeUint32BE(i->_value.fileTail);
+		file->writeUint32BE(header.version);
+		writeIndexString(file, header.description);
+		file->writeUint16BE(header.year);
+		file->writeByte(header.month);
+		file->writeByte(header.day);
+		file->writeByte(header.hour);
+		file->writeByte(header.minute);
+		file->writeUint32BE(header.playTime);
+	}
+	file->finalize();
+	if (file->err())
+		warning("SaveGameIndex::store() Can't write %s", SAVEINDEX_FILENAME);
+	delete file;
+}
+
+void SaveGameIndex::getHeaders(const Common::StringArray &filenames, Common::Array<SaveGameHeader> &headers) {
+	EntryMap map, found;
+	load(map);
+
+	bool changed = false;
+	for (Common::StringArray::const_iterator i = filenames.begin(); i != filenames.end(); ++i) {
+		Entry entry;
+		EntryMap::const_iterator indexed = map.find(*i);
+		if (indexed != map.end())
+			entry = indexed->_value;
+		const Entry old = entry;
+		if (!readEntry(*i, entry))
+			entry.header = SaveGameHeader();
+		if (indexed == map.end() || entry.fileSize != old.fileSize || entry.fileTail != old.fileTail)
+			changed = true;
+		found[*i] = entry;
+		headers.push_back(entry.header);
+	}
+	// Also drop the entries of the savegames which are gone
+	if (changed || found.size() != map.size())
+		store(found);
+}
+
+void SaveGameIndex::update(const Common::String &filename) {
+	EntryMap map;
+	load(map);
+	Entry entry;
+	if (readEntry(filename, entry) && entry.header.version != 0)
+		map[filename] = entry;
+	else
+		map.erase(filename);
+	store(map);
+}
+
+void SaveGameIndex::remove(const Common::String &filename) {
+	EntryMap map;
+	load(map);
+	map.erase(filename);
+	store(map);
+}
+
 } // end of namespace Grim
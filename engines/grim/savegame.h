@@ -23,7 +23,11 @@
 #ifndef GRIM_SAVEGAME_H
 #define GRIM_SAVEGAME_H
 
+#include "common/array.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
 #include "common/savefile.h"
+#include "common/str-array.h"
 
 #include "math/mathfwd.h"
 
@@ -31,15 +35,57 @@ namespace Grim {
 
 class Color;
 
+// Size of the thumbnails in the savegame headers
+enum {
+	kThumbnailWidth = 160,
+	kThumbnailHeight = 120
+};
+
+/**
+ * The metadata of a savegame. It is stored in a small block right after the
+ * version, so that listing the savegames does not have to read the rest.
+ */
+struct SaveGameHeader {
+	SaveGameHeader();
+
+	int version;
+	Common::String description;
+	int year, month, day, hour, minute;
+	uint32 playTime;	// in milliseconds
+	int thumbnailWidth, thumbnailHeight;
+	Common::Array<uint16> thumbnail;	// RGB565, only read on request
+};
+
 class SaveGame {
 public:
 	static SaveGame *openForLoading(const Common::String &filename);
 	static SaveGame *openForSaving(const Common::String &filename);
 	~SaveGame();
 
+	/**
+	 * Reads only the header of a savegame.
+	 *
+	 * @return false if the file cannot be opened, or is corrupt
+	 */
+	static bool readHeader(const Common::String &filename, SaveGameHeader &header, bool withThumbnail = false);
+
+	/**
+	 * Creates the file of a savegame being saved, and compresses and writes
+	 * out its sections, which until then are only kept in memory. The
+	 * destructor does it if it was not done. Once the savegame is complete,
+	 * this may run on any thread.
+	 *
+	 * @return false if the file could not be written
+	 */
+	bool finish();
+
 	static int SAVEGAME_VERSION;
 
 	int saveVersion() const;
+	const SaveGameHeader &getHeader() const;
+	void setDescription(const Common::String &description);
+	void setPlayTime(uint32 playTime);
+	void setThumbnail(const uint16 *data, int width, int height);
 	uint32 beginSection(uint32 sectionTag);
 	void endSection();
 	uint32 getBufferPos();
@@ -70,17 +116,84 @@ public:
 protected:
 	SaveGame();
 
+	enum SectionCodec {
+		kCodecStored = 0,
+		kCodecZlib = 1
+	};
+
+	/**
+	 * An entry of the section directory, which is written at the end of
+	 * the file so that the sections can be loaded in any order.
+	 */
+	struct SectionInfo {
+		uint32 tag;
+		uint32 offset;
+		uint32 length;		// length of the data in the file
+		uint32 codec;
+		uint32 rawLength;	// length of the data once decompressed
+	};
+
+	static bool readHeader(Common::InSaveFile *file, SaveGameHeader &header, bool withThumbnail);
+	bool readDirectory();
+	void writeFile();
+
 	int _version;
 	bool _saving;
 	Common::InSaveFile *_inSaveFile;
 	Common::OutSaveFile *_outSaveFile;
+	Common::String _filename;
 	uint32 _currentSection;
 	uint32 _sectionSize;
 	uint32 _sectionAlloc;
 	uint32 _sectionPtr;
 	byte *_sectionBuffer;
+	Common::Array<SectionInfo> _sections;
+	Common::Array<byte *> _sectionData;	// data of the sections, until they are written
+	uint32 _nextSection;
+	bool _finished;
+	SaveGameHeader _header;
 
 	static const int _allocAmmount = 1048576;
+
+	friend class SaveGameIndex;
+};
+
+/**
+ * An index of the headers of the savegames, without the thumbnails, so that
+ * the savegames can be listed without reading each of them. It is refreshed
+ * whenever the engine writes or deletes a savegame. Each entry keeps the size
+ * and the last word of its file, and the header is read again if the file
+ * no longer matches them, e.g. when it was replaced from outside the game.
+ */
+class SaveGameIndex {
+public:
+	/**
+	 * Gets the headers of the given savegames, from the index if they are in
+	 * it, and from the savegames themselves otherwise. The version is 0 in
+	 * the headers of the savegames which cannot be read.
+	 */
+	static void getHeaders(const Common::StringArray &filenames, Common::Array<SaveGameHeader> &headers);
+	static void update(const Common::String &filename);
+	static void remove(const Common::String &filename);
+
+private:
+	struct Entry {
+		Entry() : fileSize(0), fileTail(0) { }
+
+		SaveGameHeader header;
+		uint32 fileSize;
+		uint32 fileTail;
+	};
+
+	typedef Common::HashMap<Common::String, Entry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> EntryMap;
+
+	/**
+	 * Reads the header of a savegame unless the entry already matches its
+	 * file, and returns false if the file cannot be opened.
+	 */
+	static bool readEntry(const Common::String &filename, Entry &entry);
+	static void load(EntryMap &map);
+	static void store(const EntryMap &map);
 };
 
 } // end of namespace Grim
@@ -0,0 +1,124 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#include "engines/grim/savewriter.h"
+#include "engines/grim/savegame.h"
+
+namespace Grim {
+
+SaveGameWriter::SaveGameWriter() :
+		_thread(0), _busy(false), _flushing(false), _quit(false) {
+	if (_wake.isValid() && _flushed.isValid())
+		_thread = g_system->createThread(threadEntry, this);
+}
+
+SaveGameWriter::~SaveGameWriter() {
+	if (_thread) {
+		_mutex.lock();
+		_quit = true;
+		_mutex.unlock();
+		_wake.post();
+		g_system->joinThread(_thread);
+	}
+}
+
+void SaveGameWriter::write(SaveGame *save, const Common::String &filename) {
+	Result result;
+	result.filename = filename;
+
+	if (!_thread) {
+		result.ok = save->finish();
+		delete save;
+		_done.push_back(result);
+		return;
+	}
+
+	Request request;
+	request.save = save;
+	request.filename = filename;
+	_mutex.lock();
+	_requests.push_back(request);
+	_mutex.unlock();
+	_wake.post();
+}
+
+void SaveGameWriter::collect(Common::List<Result> &results) {
+	Common::StackLock lock(_mutex);
+	while (!_done.empty()) {
+		results.push_back(_done.front());
+		_done.pop_front();
+	}
+}
+
+void SaveGameWriter::flush() {
+	if (!_thread)
+		return;
+
+	_mutex.lock();
+	const bool idle = !_busy && _requests.empty();
+	_flushing = !idle;
+	_mutex.unlock();
+	if (!idle)
+		_flushed.wait();
+}
+
+int SaveGameWriter::threadEntry(void *param) {
+	static_cast<SaveGameWriter *>(param)->threadLoop();
+	return 0;
+}
+
+void SaveGameWriter::threadLoop() {
+	for (;;) {
+		_wake.wait();
+
+		// The pending savegames are still written when quitting
+		_mutex.lock();
+		const bool quit = _quit && _requests.empty();
+		Request request;
+		request.save = NULL;
+		if (!_requests.empty()) {
+			request = _requests.front();
+			_requests.pop_front();
+			_busy = true;
+		}
+		_mutex.unlock();
+
+		if (request.save) {
+			Result result;
+			result.filename = request.filename;
+			result.ok = request.save->finish();
+			delete request.save;
+
+			Common::StackLock lock(_mutex);
+			_done.push_back(result);
+			_busy = false;
+			if (_flushing && _requests.empty()) {
+				_flushing = false;
+				_flushed.post();
+			}
+		}
+		if (quit)
+			break;
+	}
+}
+
+} // end of namespace Grim
@@ -0,0 +1,86 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#ifndef GRIM_SAVEWRITER_H
+#define GRIM_SAVEWRITER_H
+
+#include "common/list.h"
+#include "common/mutex.h"
+#include "common/str.h"
+#include "common/system.h"
+#include "common/thread.h"
+
+namespace Grim {
+
+class SaveGame;
+
+/**
+ * Compresses and writes savegames on a background thread, so that saving
+ * only stops the game for as long as it takes to copy its state in memory.
+ *
+ * The engine collects the savegames which are done once per frame. Without
+ * thread support in the backend the savegames are written right away.
+ */
+class SaveGameWriter {
+public:
+	/**
+	 * A savegame written out, successfully or not.
+	 */
+	struct Result {
+		Common::String filename;
+		bool ok;
+	};
+
+	SaveGameWriter();
+	/** Writes out the pending savegames first. */
+	~SaveGameWriter();
+
+	/** Queue a complete savegame, which now belongs to the writer. */
+	void write(SaveGame *save, const Common::String &filename);
+	/** Take the results of the savegames written since the last call. */
+	void collect(Common::List<Result> &results);
+	/** Wait until all the queued savegames are written. */
+	void flush();
+
+private:
+	struct Request {
+		SaveGame *save;
+		Common::String filename;
+	};
+
+	static int threadEntry(void *param);
+	void threadLoop();
+
+	OSystem::ThreadRef _thread;
+	Common::Semaphore _wake;
+	Common::Semaphore _flushed;	// posted when the queue drains during flush()
+	Common::Mutex _mutex;	// guards all of the following
+	Common::List<Request> _requests;
+	Common::List<Result> _done;
+	bool _busy;
+	bool _flushing;
+	bool _quit;
+};
+
+} // end of namespace Grim
+
+#endif
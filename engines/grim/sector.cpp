@@ -32,6 +32,8 @@
 
 namespace Grim {
 
+uint32 Sector::_changeCount = 0;
+
 Sector::Sector(const Sector &other) {
 	*this = other;
 }
@@ -93,6 +95,7 @@ bool Sector::restoreState(SaveGame *savedState) {
 	} else {
 		_origVertices = NULL;
 	}
+	++_changeCount;
 
 	return true;
 }
@@ -153,9 +156,11 @@ void Sector::load(TextSplitter &ts) {
 	float length = _normal.getMagnitude();
 	if (length > 0)
 		_normal /= length;
+	++_changeCount;
 }
 
 void Sector::loadBinary(Common::SeekableReadStream *data) {
+	++_changeCount;
 	_numVertices = data->readUint32LE();
 	_vertices = new Math::Vector3d[_numVertices];
 	for(int i = 0; i < _numVertices; i++) {
@@ -181,6 +186,8 @@ void Sector::loadBinary(Common::SeekableReadStream *data) {
 }
 
 void Sector::setVisible(bool vis) {
+	if (_visible != vis)
+		++_changeCount;
 	_visible = vis;
 }
 
@@ -188,6 +195,7 @@ void Sector::shrink(float radius) {
 	if ((getType() & WalkType) == 0 || _shrinkRadius == radius)
 		return;
 
+	++_changeCount;
 	_shrinkRadius = radius;
 	if (!_origVertices) {
 		_origVertices = _vertices;
@@ -255,6 +263,7 @@ void Sector::shrink(float radius) {
 
 void Sector::unshrink() {
 	if (_shrinkRadius != 0.f) {
+		++_changeCount;
 		_shrinkRadius = 0.f;
 		_invalid = false;
 		if (_origVertices) {
@@ -470,6 +479,7 @@ Sector &Sector::operator=(const Sector &other) {
 	_normal = other._normal;
 	_shrinkRadius = other._shrinkRadius;
 	_invalid = other._invalid;
+	++_changeCount;
 
 	return *this;
 }
@@ -90,7 +90,15 @@ public:
 	Sector &operator=(const Sector &other);
 	bool operator==(const Sector &other) const;
 
+	/**
+	 * Returns a number which changes whenever the shape or the visibility
+	 * of any sector changes.
+	 */
+	static uint32 getChangeCount() { return _changeCount; }
+
 private:
+	static uint32 _changeCount;
+
 	int _numVertices, _id;
 
 	Common::String _name;
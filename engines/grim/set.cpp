@@ -40,7 +40,7 @@ namespace Grim {
 
 Set::Set(const Common::String &sceneName, Common::SeekableReadStream *data) :
 		PoolObject<Set, MKTAG('S', 'E', 'T', ' ')>(), _locked(false), _name(sceneName), _enableLights(false),
-		_lightsConfigured(false) {
+		_lightsConfigured(false), _sectorLinksChangeCount(0) {
 
 	char header[7];
 	data->read(header, 7);
@@ -55,7 +55,7 @@ Set::Set(const Common::String &sceneName, Common::SeekableReadStream *data) :
 }
 
 Set::Set() :
-	PoolObject<Set, MKTAG('S', 'E', 'T', ' ')>(), _cmaps(NULL) {
+	PoolObject<Set, MKTAG('S', 'E', 'T', ' ')>(), _cmaps(NULL), _sectorLinksChangeCount(0) {
 
 }
 
@@ -578,6 +578,50 @@ void Set::unshrinkBoxes() {
 	}
 }
 
+int Set::getSectorIndex(const Sector *sector) const {
+	for (int i = 0; i < _numSectors; i++) {
+		if (_sectors[i] == sector)
+			return i;
+	}
+	return -1;
+}
+
+const Common::Array<Set::SectorLink> &Set::getSectorLinks(int index) {
+	assert(index >= 0 && index < _numSectors);
+
+	// the links of all the sectors are dropped as soon as one sector is
+	// shown, hidden, shrunk or unshrunk
+	if (_sectorLinksChangeCount != Sector::getChangeCount() || (int)_sectorLinks.size() != _numSectors) {
+		_sectorLinks.clear();
+		_sectorLinks.resize(_numSectors);
+		_sectorLinksChangeCount = Sector::getChangeCount();
+	}
+
+	SectorLinks &links = _sectorLinks[index];
+	if (links._valid)
+		return links._links;
+
+	Sector *sector = _sectors[index];
+	for (int i = 0; i < _numSectors; i++) {
+		Sector *s = _sectors[i];
+		int type = s->getType();
+		if (i == index || (type != Sector::WalkType && type != Sector::HotType && type != Sector::FunnelType) || !s->isVisible())
+			continue;
+
+		Common::List<Math::Line3d> bridges = sector->getBridgesTo(s);
+		if (bridges.empty())
+			continue; // The sectors are not adjacent.
+
+		SectorLink link;
+		link._sector = i;
+		for (Common::List<Math::Line3d>::const_iterator j = bridges.begin(); j != bridges.end(); ++j)
+			link._bridges.push_back(*j);
+		links._links.push_back(link);
+	}
+	links._valid = true;
+	return links._links;
+}
+
 void Set::setLightsDirty() {
 	_lightsConfigured = false;
 }
@@ -23,6 +23,8 @@
 #ifndef GRIM_SET_H
 #define GRIM_SET_H
 
+#include "common/array.h"
+
 #include "engines/grim/pool.h"
 #include "engines/grim/object.h"
 #include "engines/grim/color.h"
@@ -94,6 +96,21 @@ public:
 	void shrinkBoxes(float radius);
 	void unshrinkBoxes();
 
+	/**
+	 * A sector which can be walked into from another one, with the edges
+	 * to cross to get into it.
+	 */
+	struct SectorLink {
+		int _sector;		// index of the sector in the set
+		Common::Array<Math::Line3d> _bridges;
+	};
+	int getSectorIndex(const Sector *sector) const;
+	/**
+	 * Returns the visible walk sectors adjacent to a sector. They are
+	 * computed once and kept until any sector changes.
+	 */
+	const Common::Array<SectorLink> &getSectorLinks(int index);
+
 	void addObjectState(const ObjectState::Ptr &s);
 	void deleteObjectState(const ObjectState::Ptr &s) {
 		_states.remove(s);
@@ -131,6 +148,13 @@ private:
 	int _numSetups, _numLights, _numSectors, _numObjectStates;
 	bool _enableLights;
 	Sector **_sectors;
+	struct SectorLinks {
+		SectorLinks() : _valid(false) { }
+		bool _valid;
+		Common::Array<SectorLink> _links;
+	};
+	Common::Array<SectorLinks> _sectorLinks;
+	uint32 _sectorLinksChangeCount;	// Sector::getChangeCount() when computed
 	Light *_lights;
 	Setup *_setups;
 	bool _lightsConfigured;
@@ -30,10 +30,13 @@ MODULE_OBJS := \
 	tinygl/select.o \
 	tinygl/specbuf.o \
 	tinygl/texture.o \
+	tinygl/vblock.o \
 	tinygl/vertex.o \
+	tinygl/zbin.o \
 	tinygl/zbuffer.o \
 	tinygl/zline.o \
 	tinygl/zmath.o \
+	tinygl/zspan.o \
 	tinygl/ztriangle.o \
 	tinygl/ztriangle_shadow.o
 
@@ -585,7 +585,9 @@ void tglCallList(unsigned int list) {
 }
 
 void tglFlush() {
-	// nothing to do
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	// rasterize the triangles still waiting in the bins
+	TinyGL::ZB_flushTriangles(c->zb);
 }
 
 void tglHint(int target, int mode) {
@@ -607,6 +609,8 @@ void tglDebug(int mode) {
 
 void tglSetShadowMaskBuf(unsigned char *buf) {
 	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	// the caller owns the mask and may reuse it once it is unset
+	TinyGL::ZB_flushTriangles(c->zb);
 	c->zb->shadow_mask_buf = buf;
 }
 
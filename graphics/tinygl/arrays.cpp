@@ -1,4 +1,3 @@
-
 #include "graphics/tinygl/zgl.h"
 
 #define VERTEX_ARRAY	0x0001
@@ -8,27 +7,31 @@
 
 namespace TinyGL {
 
-void glopArrayElement(GLContext *c, GLParam *param) {
+// Sets the current state from the enabled arrays, and returns the
+// coordinates of the element if the vertex array is enabled.
+static int gl_load_array_element(GLContext *c, int idx, V4 *coord) {
 	int i;
 	int states = c->client_states;
-	int idx = param[1].i;
 
 	if (states & COLOR_ARRAY) {
-		GLParam p[5];
-		int size = c->color_array_size; 
+		GLParam p[8];
+		int size = c->color_array_size;
 		i = idx * (size + c->color_array_stride);
 		p[1].f = c->color_array[i];
 		p[2].f = c->color_array[i + 1];
 		p[3].f = c->color_array[i + 2];
 		p[4].f = size > 3 ? c->color_array[i + 3] : 1.0f;
-		glopColor(c, p);  
+		p[5].ui = (unsigned int)(p[1].f * (ZB_POINT_RED_MAX - ZB_POINT_RED_MIN) + ZB_POINT_RED_MIN);
+		p[6].ui = (unsigned int)(p[2].f * (ZB_POINT_GREEN_MAX - ZB_POINT_GREEN_MIN) + ZB_POINT_GREEN_MIN);
+		p[7].ui = (unsigned int)(p[3].f * (ZB_POINT_BLUE_MAX - ZB_POINT_BLUE_MIN) + ZB_POINT_BLUE_MIN);
+		glopColor(c, p);
 	}
 	if (states & NORMAL_ARRAY) {
 		i = idx * (3 + c->normal_array_stride);
 		c->current_normal.X = c->normal_array[i];
 		c->current_normal.Y = c->normal_array[i + 1];
 		c->current_normal.Z = c->normal_array[i + 2];
-		c->current_normal.Z = 0.0f;
+		c->current_normal.W = 0.0f;
 	}
 	if (states & TEXCOORD_ARRAY) {
 		int size = c->texcoord_array_size;
@@ -39,36 +42,170 @@ void glopArrayElement(GLContext *c, GLParam *param) {
 		c->current_tex_coord.W = size > 3 ? c->texcoord_array[i + 3] : 1.0f;
 	}
 	if (states & VERTEX_ARRAY) {
-		GLParam p[5];
 		int size = c->vertex_array_size;
 		i = idx * (size + c->vertex_array_stride);
-		p[1].f = c->vertex_array[i];
-		p[2].f = c->vertex_array[i + 1];
-		p[3].f = size > 2 ? c->vertex_array[i+2] : 0.0f;
-		p[4].f = size > 3 ? c->vertex_array[i+3] : 1.0f;
+		coord->X = c->vertex_array[i];
+		coord->Y = c->vertex_array[i + 1];
+		coord->Z = size > 2 ? c->vertex_array[i + 2] : 0.0f;
+		coord->W = size > 3 ? c->vertex_array[i + 3] : 1.0f;
+		return 1;
+	}
+	return 0;
+}
+
+void glopArrayElement(GLContext *c, GLParam *param) {
+	V4 coord;
+
+	if (gl_load_array_element(c, param[1].i, &coord)) {
+		GLParam p[5];
+		p[1].f = coord.X;
+		p[2].f = coord.Y;
+		p[3].f = coord.Z;
+		p[4].f = coord.W;
 		glopVertex(c, p);
 	}
 }
 
-void glArrayElement(TGLint i) {
-	GLParam p[2];
-	p[0].op = OP_ArrayElement;
-	p[1].i = i;
-	gl_add_op(p);
+static inline int gl_get_element(const GLParam *param, int i) {
+	if (param[3].i == TGL_UNSIGNED_SHORT)
+		return ((const unsigned short *)param[4].p)[i];
+	return ((const unsigned int *)param[4].p)[i];
+}
+
+void glopDrawElements(GLContext *c, GLParam *param) {
+	GLParam p[5];
+	int mode = param[1].i;
+	int count = param[2].i;
+	int i, idx, max_idx;
+
+	if (!(c->client_states & VERTEX_ARRAY) || count <= 0)
+		return;
+
+	if (mode != TGL_TRIANGLES) {
+		// no vertex is shared, go through the regular path
+		p[1].i = mode;
+		glopBegin(c, p);
+		for (i = 0; i < count; i++) {
+			p[1].i = gl_get_element(param, i);
+			glopArrayElement(c, p);
+		}
+		glopEnd(c, p);
+		return;
+	}
+
+	max_idx = 0;
+	for (i = 0; i < count; i++) {
+		idx = gl_get_element(param, i);
+		if (idx > max_idx)
+			max_idx = idx;
+	}
+	if (max_idx >= c->element_max) {
+		gl_free(c->element_vertex);
+		gl_free(c->element_stamp);
+		c->element_max = max_idx + 1;
+		c->element_vertex = (GLVertex *)gl_malloc(c->element_max * sizeof(GLVertex));
+		c->element_stamp = (int *)gl_zalloc(c->element_max * sizeof(int));
+		if (!c->element_vertex || !c->element_stamp)
+			error("unable to allocate the glDrawElements vertex cache");
+		c->element_serial = 0;
+	}
+	// a new serial invalidates all the cached vertices at once
+	if (++c->element_serial == 0) {
+		memset(c->element_stamp, 0, c->element_max * sizeof(int));
+		c->element_serial = 1;
+	}
+
+	// sets up the matrices and the triangle functions
+	p[1].i = TGL_TRIANGLES;
+	glopBegin(c, p);
+
+	// each element used is transformed and lit once, by blocks unless the
+	// color array may change the material from one element to the next
+	for (i = 0; i < count; i++) {
+		idx = gl_get_element(param, i);
+		if (c->element_stamp[idx] != c->element_serial) {
+			GLVertex *v = &c->element_vertex[idx];
+			c->element_stamp[idx] = c->element_serial;
+			gl_load_array_element(c, idx, &v->coord);
+			gl_vertex_attribs(c, v);
+			if (c->client_states & COLOR_ARRAY)
+				gl_vertex_transform_light(c, v);
+			else
+				gl_vertex_block_add(c, v);
+		}
+	}
+	gl_vertex_block_flush(c);
+
+	for (i = 0; i + 2 < count; i += 3) {
+		gl_draw_triangle(c, &c->element_vertex[gl_get_element(param, i)],
+				&c->element_vertex[gl_get_element(param, i + 1)],
+				&c->element_vertex[gl_get_element(param, i + 2)]);
+	}
+	glopEnd(c, p);
 }
 
 void glopEnableClientState(GLContext *c, GLParam *p) {
 	c->client_states |= p[1].i;
 }
 
-void glEnableClientState(TGLenum array) {
-	GLParam p[2];
-	p[0].op = OP_EnableClientState;
+void glopDisableClientState(GLContext *c, GLParam *p) {
+	c->client_states &= p[1].i;
+}
+
+void glopVertexPointer(GLContext *c, GLParam *p) {
+	c->vertex_array_size = p[1].i;
+	c->vertex_array_stride = p[2].i;
+	c->vertex_array = (float *)p[3].p;
+}
+
+void glopColorPointer(GLContext *c, GLParam *p) {
+	c->color_array_size = p[1].i;
+	c->color_array_stride = p[2].i;
+	c->color_array = (float *)p[3].p;
+}
+
+void glopNormalPointer(GLContext *c, GLParam *p) {
+	c->normal_array_stride = p[1].i;
+	c->normal_array = (float *)p[2].p;
+}
+
+void glopTexCoordPointer(GLContext *c, GLParam *p) {
+	c->texcoord_array_size = p[1].i;
+	c->texcoord_array_stride = p[2].i;
+	c->texcoord_array = (float *)p[3].p;
+}
+
+} // end of namespace TinyGL
+
+void tglArrayElement(TGLint i) {
+	TinyGL::GLParam p[2];
+	p[0].op = TinyGL::OP_ArrayElement;
+	p[1].i = i;
+	TinyGL::gl_add_op(p);
+}
+
+// The arrays are used when the call is executed, even from a display list.
+// Only triangles share their vertices: each element is transformed and lit
+// once per call however many times it is referenced.
+void tglDrawElements(TGLenum mode, TGLsizei count, TGLenum type, const TGLvoid *indices) {
+	TinyGL::GLParam p[5];
+	assert(type == TGL_UNSIGNED_INT || type == TGL_UNSIGNED_SHORT);
+	p[0].op = TinyGL::OP_DrawElements;
+	p[1].i = mode;
+	p[2].i = count;
+	p[3].i = type;
+	p[4].p = const_cast<void *>(indices);
+	TinyGL::gl_add_op(p);
+}
+
+void tglEnableClientState(TGLenum array) {
+	TinyGL::GLParam p[2];
+	p[0].op = TinyGL::OP_EnableClientState;
 
 	switch(array) {
 	case TGL_VERTEX_ARRAY:
 		p[1].i = VERTEX_ARRAY;
-		break;  
+		break;
 	case TGL_NORMAL_ARRAY:
 		p[1].i = NORMAL_ARRAY;
 		break;
@@ -82,21 +219,17 @@ void glEnableClientState(TGLenum array) {
 		assert(0);
 		break;
 	}
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopDisableClientState(GLContext *c, GLParam *p) {
-	c->client_states &= p[1].i;
-}
+void tglDisableClientState(TGLenum array) {
+	TinyGL::GLParam p[2];
+	p[0].op = TinyGL::OP_DisableClientState;
 
-void glDisableClientState(TGLenum array) {
-	GLParam p[2];
-	p[0].op = OP_DisableClientState;
-    
 	switch(array) {
 	case TGL_VERTEX_ARRAY:
 		p[1].i = ~VERTEX_ARRAY;
-		break;  
+		break;
 	case TGL_NORMAL_ARRAY:
 		p[1].i = ~NORMAL_ARRAY;
 		break;
@@ -110,69 +243,46 @@ void glDisableClientState(TGLenum array) {
 		assert(0);
 		break;
 	}
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopVertexPointer(GLContext *c, GLParam *p) {
-	c->vertex_array_size = p[1].i;
-	c->vertex_array_stride = p[2].i;
-	c->vertex_array = (float *)p[3].p;
-}
+// the stride is a number of floats between two elements, not of bytes
 
-void  glVertexPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[4];
+void tglVertexPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[4];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_VertexPointer;
+	p[0].op = TinyGL::OP_VertexPointer;
 	p[1].i = size;
 	p[2].i = stride;
 	p[3].p = const_cast<void *>(pointer);
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopColorPointer(GLContext *c, GLParam *p) {
-	c->color_array_size = p[1].i;
-	c->color_array_stride = p[2].i;
-	c->color_array = (float *)p[3].p;  
-}
-
-void  glColorPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[4];
+void tglColorPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[4];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_ColorPointer;
+	p[0].op = TinyGL::OP_ColorPointer;
 	p[1].i = size;
 	p[2].i = stride;
 	p[3].p = const_cast<void *>(pointer);
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopNormalPointer(GLContext *c, GLParam *p) {
-	c->normal_array_stride = p[1].i;
-	c->normal_array = (float *)p[2].p;
-}
-
-void glNormalPointer(TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[3];
+void tglNormalPointer(TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[3];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_NormalPointer;
+	p[0].op = TinyGL::OP_NormalPointer;
 	p[1].i = stride;
 	p[2].p = const_cast<void *>(pointer);
-	gl_add_op(p);
-}
-
-void glopTexCoordPointer(GLContext *c, GLParam *p) {
-	c->texcoord_array_size = p[1].i;
-	c->texcoord_array_stride = p[2].i;
-	c->texcoord_array = (float *)p[3].p;
+	TinyGL::gl_add_op(p);
 }
 
-void glTexCoordPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[4];
+void tglTexCoordPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[4];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_TexCoordPointer;
+	p[0].op = TinyGL::OP_TexCoordPointer;
 	p[1].i = size;
 	p[2].i = stride;
 	p[3].p = const_cast<void *>(pointer);
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
-
-} // end of namespace TinyGL
@@ -62,6 +62,7 @@ static void gl_add_select1(GLContext *c, int z1, int z2, int z3) {
 // point
 
 void gl_draw_point(GLContext *c, GLVertex *p0) {
+	ZB_flushTriangles(c->zb);
 	if (p0->clip_code == 0) {
 		if (c->render_mode == TGL_SELECT) {
 			gl_add_select(c,p0->zp.z,p0->zp.z);
@@ -115,6 +116,8 @@ void gl_draw_line(GLContext *c, GLVertex *p1, GLVertex *p2) {
 	GLVertex q1, q2;
 	int cc1, cc2;
   
+	ZB_flushTriangles(c->zb);
+
 	cc1 = p1->clip_code;
 	cc2 = p2->clip_code;
 
@@ -387,28 +390,36 @@ void gl_draw_triangle_fill(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p
 	}
 #endif
     
+	ZB_fillTriangleFunc fill;
+
 	if (c->shadow_mode & 1) {
 		assert(c->zb->shadow_mask_buf);
-		ZB_fillTriangleFlatShadowMask(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		fill = ZB_fillTriangleFlatShadowMask;
 	} else if (c->shadow_mode & 2) {
 		assert(c->zb->shadow_mask_buf);
-		ZB_fillTriangleFlatShadow(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		fill = ZB_fillTriangleFlatShadow;
 	} else if (c->texture_2d_enabled) {
 #ifdef TINYGL_PROFILE
 		count_triangles_textured++;
 #endif
 		ZB_setTexture(c->zb, (PIXEL *)c->current_texture->images[0].pixmap);
-		ZB_fillTriangleMappingPerspective(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		fill = ZB_fillTriangleMappingPerspective;
 	} else if (c->current_shade_model == TGL_SMOOTH) {
-		ZB_fillTriangleSmooth(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		fill = ZB_fillTriangleSmooth;
 	} else {
-		ZB_fillTriangleFlat(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		fill = ZB_fillTriangleFlat;
 	}
+
+	if (c->zb->bins)
+		ZB_binTriangle(c->zb, fill, &p0->zp, &p1->zp, &p2->zp);
+	else
+		fill(c->zb, &p0->zp, &p1->zp, &p2->zp);
 }
 
 // Render a clipped triangle in line mode
 
 void gl_draw_triangle_line(GLContext *c, GLVertex *p0, GLVertex *p1,GLVertex *p2) {
+	ZB_flushTriangles(c->zb);
 	if (c->depth_test) {
 		if (p0->edge_flag)
 			ZB_line_z(c->zb, &p0->zp, &p1->zp);
@@ -428,6 +439,7 @@ void gl_draw_triangle_line(GLContext *c, GLVertex *p0, GLVertex *p1,GLVertex *p2
 
 // Render a clipped triangle in point mode
 void gl_draw_triangle_point(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p2) {
+	ZB_flushTriangles(c->zb);
 	if (p0->edge_flag)
 		ZB_plot(c->zb, &p0->zp);
 	if (p1->edge_flag)
@@ -162,6 +162,11 @@ void glInit(void *zbuffer1) {
 
 	// opengl 1.1 arrays
 	c->client_states = 0;
+	c->element_vertex = NULL;
+	c->element_stamp = NULL;
+	c->element_max = 0;
+	c->element_serial = 0;
+	c->vertex_block.n = 0;
 
 	// opengl 1.1 polygon offset
 	c->offset_states = 0;
@@ -184,6 +189,8 @@ void glInit(void *zbuffer1) {
 void glClose() {
 	GLContext *c = gl_get_context();
 	endSharedState(c);
+	gl_free(c->element_vertex);
+	gl_free(c->element_stamp);
 	gl_free(c);
 }
 
@@ -115,8 +115,11 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 	im = &c->current_texture->images[level];
 	im->xsize = width;
 	im->ysize = height;
-	if (im->pixmap)
+	if (im->pixmap) {
+		// binned triangles may still sample the old image
+		ZB_flushTriangles(c->zb);
 		gl_free(im->pixmap);
+	}
 	im->pixmap = gl_malloc(width * height * 3);
 	if (im->pixmap)
 		gl_convertRGB_to_5R6G5B8A((unsigned short *)im->pixmap, pixels1, width, height);
@@ -199,6 +202,9 @@ void tglDeleteTextures(int n, const unsigned int *textures) {
 	int i;
 	TinyGL::GLTexture *t;
 
+	// binned triangles may still sample the textures
+	TinyGL::ZB_flushTriangles(c->zb);
+
 	for (i = 0; i < n; i++) {
 		t = TinyGL::find_texture(c, textures[i]);
 		if (t) {
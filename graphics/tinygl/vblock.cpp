@@ -0,0 +1,319 @@
+
+// Transformation and lighting of blocks of vertices
+//
+// The vertices of a glDrawElements() call are queued with their object
+// coordinates and normals kept as separate arrays, then transformed and lit
+// four at a time with SSE2. The result is exactly the one of
+// gl_vertex_transform_light(), which handles the other targets and the
+// local viewer lighting model.
+
+#include "graphics/tinygl/zgl.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define GL_VERTEX_BLOCK_SSE2
+#endif
+
+namespace TinyGL {
+
+void gl_vertex_block_add(GLContext *c, GLVertex *v) {
+	GLVertexBlock *b = &c->vertex_block;
+	int i = b->n++;
+
+	b->vertex[i] = v;
+	b->x[i] = v->coord.X;
+	b->y[i] = v->coord.Y;
+	b->z[i] = v->coord.Z;
+	b->nx[i] = c->current_normal.X;
+	b->ny[i] = c->current_normal.Y;
+	b->nz[i] = c->current_normal.Z;
+
+	if (b->n == GL_VERTEX_BLOCK)
+		gl_vertex_block_flush(c);
+}
+
+static void gl_vertex_block_scalar(GLContext *c, GLVertexBlock *b) {
+	V4 normal = c->current_normal;
+
+	for (int i = 0; i < b->n; i++) {
+		c->current_normal.X = b->nx[i];
+		c->current_normal.Y = b->ny[i];
+		c->current_normal.Z = b->nz[i];
+		c->current_normal.W = 0;
+		gl_vertex_transform_light(c, b->vertex[i]);
+	}
+	c->current_normal = normal;
+}
+
+#ifdef GL_VERTEX_BLOCK_SSE2
+
+// The operations are done in the same order as in gl_vertex_transform()
+// and gl_shade_vertex(), so that the results are the same to the bit.
+
+static inline __m128 gl_select4(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 gl_abs4(__m128 a) {
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+
+// x * m[0] + y * m[1] + z * m[2]
+static inline __m128 gl_dot4(__m128 x, __m128 y, __m128 z, const float *m) {
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(m[0])), _mm_mul_ps(y, _mm_set1_ps(m[1]))),
+			_mm_mul_ps(z, _mm_set1_ps(m[2])));
+}
+
+// x * m[0] + y * m[1] + z * m[2] + m[3]
+static inline __m128 gl_affine4(__m128 x, __m128 y, __m128 z, const float *m) {
+	return _mm_add_ps(gl_dot4(x, y, z, m), _mm_set1_ps(m[3]));
+}
+
+// x * m[0] + y * m[1] + z * m[2] + w * m[3]
+static inline __m128 gl_linear4(__m128 x, __m128 y, __m128 z, __m128 w, const float *m) {
+	return _mm_add_ps(gl_dot4(x, y, z, m), _mm_mul_ps(w, _mm_set1_ps(m[3])));
+}
+
+// lighting of four vertices, see gl_shade_vertex()
+static void gl_shade4(GLContext *c, const __m128 ec[3], const __m128 n[3], __m128 color[3], GLSpecBuf **specbuf) {
+	GLMaterial *m = &c->materials[0];
+	int twoside = c->light_model_two_side;
+	const __m128 zero = _mm_setzero_ps();
+	// dist > 1E-3 in double precision is dist >= 1E-3f, which rounds up
+	const __m128 epsilon = _mm_set1_ps(1E-3f);
+	__m128 R, G, B;
+
+	R = _mm_set1_ps(m->emission.v[0] + m->ambient.v[0] * c->ambient_light_model.v[0]);
+	G = _mm_set1_ps(m->emission.v[1] + m->ambient.v[1] * c->ambient_light_model.v[1]);
+	B = _mm_set1_ps(m->emission.v[2] + m->ambient.v[2] * c->ambient_light_model.v[2]);
+
+	for (GLLight *l = c->first_light; l != NULL; l = l->next) {
+		__m128 lR, lG, lB, dx, dy, dz, att, dot, lit, skip;
+
+		// ambient
+		lR = _mm_set1_ps(l->ambient.v[0] * m->ambient.v[0]);
+		lG = _mm_set1_ps(l->ambient.v[1] * m->ambient.v[1]);
+		lB = _mm_set1_ps(l->ambient.v[2] * m->ambient.v[2]);
+
+		if (l->position.v[3] == 0) {
+			// light at infinity
+			dx = _mm_set1_ps(l->position.v[0]);
+			dy = _mm_set1_ps(l->position.v[1]);
+			dz = _mm_set1_ps(l->position.v[2]);
+			att = _mm_set1_ps(1.0f);
+		} else {
+			// distance attenuation
+			__m128 dist, far, tmp;
+			dx = _mm_sub_ps(_mm_set1_ps(l->position.v[0]), ec[0]);
+			dy = _mm_sub_ps(_mm_set1_ps(l->position.v[1]), ec[1]);
+			dz = _mm_sub_ps(_mm_set1_ps(l->position.v[2]), ec[2]);
+			dist = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			far = _mm_cmpge_ps(dist, epsilon);
+			tmp = _mm_div_ps(_mm_set1_ps(1.0f), dist);
+			dx = gl_select4(far, _mm_mul_ps(dx, tmp), dx);
+			dy = gl_select4(far, _mm_mul_ps(dy, tmp), dy);
+			dz = gl_select4(far, _mm_mul_ps(dz, tmp), dz);
+			att = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_set1_ps(l->attenuation[0]),
+					_mm_mul_ps(dist, _mm_add_ps(_mm_set1_ps(l->attenuation[1]),
+					_mm_mul_ps(dist, _mm_set1_ps(l->attenuation[2]))))));
+		}
+		dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, n[0]), _mm_mul_ps(dy, n[1])), _mm_mul_ps(dz, n[2]));
+		if (twoside)
+			dot = gl_abs4(dot);
+		lit = _mm_cmpgt_ps(dot, zero);
+		skip = zero;
+
+		if (_mm_movemask_ps(lit)) {
+			__m128 sz, dot_spec, spec;
+
+			// diffuse light
+			lR = gl_select4(lit, _mm_add_ps(lR, _mm_mul_ps(_mm_mul_ps(dot, _mm_set1_ps(l->diffuse.v[0])), _mm_set1_ps(m->diffuse.v[0]))), lR);
+			lG = gl_select4(lit, _mm_add_ps(lG, _mm_mul_ps(_mm_mul_ps(dot, _mm_set1_ps(l->diffuse.v[1])), _mm_set1_ps(m->diffuse.v[1]))), lG);
+			lB = gl_select4(lit, _mm_add_ps(lB, _mm_mul_ps(_mm_mul_ps(dot, _mm_set1_ps(l->diffuse.v[2])), _mm_set1_ps(m->diffuse.v[2]))), lB);
+
+			// spot light
+			if (l->spot_cutoff != 180) {
+				__m128 dot_spot = _mm_xor_ps(_mm_set1_ps(-0.0f),
+						gl_dot4(dx, dy, dz, l->norm_spot_direction.v));
+				if (twoside)
+					dot_spot = gl_abs4(dot_spot);
+				// no contribution at all outside of the cone
+				skip = _mm_and_ps(lit, _mm_cmplt_ps(dot_spot, _mm_set1_ps(l->cos_spot_cutoff)));
+				lit = _mm_andnot_ps(skip, lit);
+
+				if (l->spot_exponent > 0) {
+					float a[4], d[4];
+					int mask = _mm_movemask_ps(lit);
+					_mm_storeu_ps(a, att);
+					_mm_storeu_ps(d, dot_spot);
+					for (int j = 0; j < 4; j++) {
+						if (mask & (1 << j)) {
+							float dot_spot1 = d[j];
+							a[j] = a[j] * pow(dot_spot1, l->spot_exponent);
+						}
+					}
+					att = _mm_loadu_ps(a);
+				}
+			}
+
+			// specular light
+			sz = _mm_add_ps(dz, _mm_set1_ps(1.0f));
+			dot_spec = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n[0], dx), _mm_mul_ps(n[1], dy)), _mm_mul_ps(n[2], sz));
+			if (twoside)
+				dot_spec = gl_abs4(dot_spec);
+			spec = _mm_and_ps(lit, _mm_cmpgt_ps(dot_spec, zero));
+
+			if (_mm_movemask_ps(spec)) {
+				__m128 tmp;
+				float d[4], s[4];
+				int mask = _mm_movemask_ps(spec);
+
+				tmp = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(sz, sz)));
+				dot_spec = gl_select4(_mm_cmpge_ps(tmp, epsilon), _mm_div_ps(dot_spec, tmp), dot_spec);
+
+				if (!*specbuf)
+					*specbuf = specbuf_get_buffer(c, m->shininess_i, m->shininess);
+				_mm_storeu_ps(d, dot_spec);
+				for (int j = 0; j < 4; j++) {
+					s[j] = 0;
+					if (mask & (1 << j)) {
+						int idx = (int)(d[j] * SPECULAR_BUFFER_SIZE);
+						if (idx > SPECULAR_BUFFER_SIZE)
+							idx = SPECULAR_BUFFER_SIZE;
+						s[j] = (*specbuf)->buf[idx];
+					}
+				}
+				dot_spec = _mm_loadu_ps(s);
+				lR = gl_select4(spec, _mm_add_ps(lR, _mm_mul_ps(_mm_mul_ps(dot_spec, _mm_set1_ps(l->specular.v[0])), _mm_set1_ps(m->specular.v[0]))), lR);
+				lG = gl_select4(spec, _mm_add_ps(lG, _mm_mul_ps(_mm_mul_ps(dot_spec, _mm_set1_ps(l->specular.v[1])), _mm_set1_ps(m->specular.v[1]))), lG);
+				lB = gl_select4(spec, _mm_add_ps(lB, _mm_mul_ps(_mm_mul_ps(dot_spec, _mm_set1_ps(l->specular.v[2])), _mm_set1_ps(m->specular.v[2]))), lB);
+			}
+		}
+
+		R = gl_select4(skip, R, _mm_add_ps(R, _mm_mul_ps(att, lR)));
+		G = gl_select4(skip, G, _mm_add_ps(G, _mm_mul_ps(att, lG)));
+		B = gl_select4(skip, B, _mm_add_ps(B, _mm_mul_ps(att, lB)));
+	}
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	color[0] = _mm_min_ps(_mm_max_ps(R, zero), one);
+	color[1] = _mm_min_ps(_mm_max_ps(G, zero), one);
+	color[2] = _mm_min_ps(_mm_max_ps(B, zero), one);
+}
+
+static void gl_vertex_block_sse2(GLContext *c, GLVertexBlock *b) {
+	GLSpecBuf *specbuf = NULL;
+	float alpha = c->materials[0].diffuse.v[3];
+
+	if (alpha < 0)
+		alpha = 0;
+	else if (alpha > 1)
+		alpha = 1;
+
+	// the last group is completed with vertices whose results are unused
+	for (int i = b->n; i & 3; i++) {
+		b->x[i] = b->y[i] = b->z[i] = 0;
+		b->nx[i] = b->ny[i] = b->nz[i] = 0;
+	}
+
+	for (int i = 0; i < b->n; i += 4) {
+		__m128 x = _mm_loadu_ps(b->x + i);
+		__m128 y = _mm_loadu_ps(b->y + i);
+		__m128 z = _mm_loadu_ps(b->z + i);
+		float ec[4][4], pc[4][4], normal[3][4], color[3][4];
+		const float *m;
+
+		if (c->lighting_enabled) {
+			__m128 e[4], nv[3], cv[3];
+
+			// eye coordinates needed for lighting
+			m = &c->matrix_stack_ptr[0]->m[0][0];
+			for (int k = 0; k < 4; k++)
+				e[k] = gl_affine4(x, y, z, m + 4 * k);
+
+			// projection coordinates
+			m = &c->matrix_stack_ptr[1]->m[0][0];
+			for (int k = 0; k < 4; k++) {
+				_mm_storeu_ps(ec[k], e[k]);
+				_mm_storeu_ps(pc[k], gl_linear4(e[0], e[1], e[2], e[3], m + 4 * k));
+			}
+
+			m = &c->matrix_model_view_inv.m[0][0];
+			x = _mm_loadu_ps(b->nx + i);
+			y = _mm_loadu_ps(b->ny + i);
+			z = _mm_loadu_ps(b->nz + i);
+			for (int k = 0; k < 3; k++)
+				nv[k] = gl_dot4(x, y, z, m + 4 * k);
+
+			if (c->normalize_enabled) {
+				__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nv[0], nv[0]), _mm_mul_ps(nv[1], nv[1])), _mm_mul_ps(nv[2], nv[2])));
+				__m128 nonzero = _mm_cmpneq_ps(len, _mm_setzero_ps());
+				for (int k = 0; k < 3; k++)
+					nv[k] = gl_select4(nonzero, _mm_div_ps(nv[k], len), nv[k]);
+			}
+
+			gl_shade4(c, e, nv, cv, &specbuf);
+			for (int k = 0; k < 3; k++) {
+				_mm_storeu_ps(normal[k], nv[k]);
+				_mm_storeu_ps(color[k], cv[k]);
+			}
+		} else {
+			// no eye coordinates needed, no normal
+			m = &c->matrix_model_projection.m[0][0];
+			for (int k = 0; k < 3; k++)
+				_mm_storeu_ps(pc[k], gl_affine4(x, y, z, m + 4 * k));
+			if (c->matrix_model_projection_no_w_transform)
+				_mm_storeu_ps(pc[3], _mm_set1_ps(m[15]));
+			else
+				_mm_storeu_ps(pc[3], gl_affine4(x, y, z, m + 12));
+		}
+
+		for (int j = 0; j < 4 && i + j < b->n; j++) {
+			GLVertex *v = b->vertex[i + j];
+
+			v->pc.X = pc[0][j];
+			v->pc.Y = pc[1][j];
+			v->pc.Z = pc[2][j];
+			v->pc.W = pc[3][j];
+			if (c->lighting_enabled) {
+				v->ec.X = ec[0][j];
+				v->ec.Y = ec[1][j];
+				v->ec.Z = ec[2][j];
+				v->ec.W = ec[3][j];
+				v->normal.X = normal[0][j];
+				v->normal.Y = normal[1][j];
+				v->normal.Z = normal[2][j];
+				v->color.X = color[0][j];
+				v->color.Y = color[1][j];
+				v->color.Z = color[2][j];
+				v->color.W = alpha;
+			} else {
+				v->color = c->current_color;
+			}
+			v->clip_code = gl_clipcode(v->pc.X, v->pc.Y, v->pc.Z, v->pc.W);
+
+			// precompute the mapping to the viewport
+			if (v->clip_code == 0)
+				gl_transform_to_viewport(c, v);
+		}
+	}
+}
+
+#endif
+
+// transformation, lighting and viewport mapping of the queued vertices
+void gl_vertex_block_flush(GLContext *c) {
+	GLVertexBlock *b = &c->vertex_block;
+
+	if (b->n == 0)
+		return;
+#ifdef GL_VERTEX_BLOCK_SSE2
+	if (!c->lighting_enabled || !c->local_light_model)
+		gl_vertex_block_sse2(c, b);
+	else
+#endif
+		gl_vertex_block_scalar(c, b);
+	b->n = 0;
+}
+
+} // end of namespace TinyGL
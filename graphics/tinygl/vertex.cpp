@@ -188,6 +188,48 @@ static inline void gl_vertex_transform(GLContext *c, GLVertex *v) {
 	v->clip_code = gl_clipcode(v->pc.X, v->pc.Y, v->pc.Z, v->pc.W);
 }
 
+// texture coordinates and edge flag of a vertex, from the current state
+void gl_vertex_attribs(GLContext *c, GLVertex *v) {
+	// tex coords
+
+	if (c->texture_2d_enabled) {
+		if (c->apply_texture_matrix) {
+			gl_M4_MulV4(&v->tex_coord, c->matrix_stack_ptr[2], &c->current_tex_coord);
+		} else {
+			v->tex_coord = c->current_tex_coord;
+		}
+	}
+
+    // edge flag
+
+	v->edge_flag = c->current_edge_flag;
+}
+
+// transformation, lighting and viewport mapping of a vertex whose
+// coordinates and attributes are set, using the current normal and color
+void gl_vertex_transform_light(GLContext *c, GLVertex *v) {
+	gl_vertex_transform(c, v);
+
+	// color
+
+	if (c->lighting_enabled) {
+		gl_shade_vertex(c, v);
+	} else {
+		v->color = c->current_color;
+	}
+
+    // precompute the mapping to the viewport
+	if (v->clip_code == 0)
+		gl_transform_to_viewport(c, v);
+}
+
+// transformation, lighting and viewport mapping of a vertex whose
+// coordinates are set, using the current state
+void gl_vertex_setup(GLContext *c, GLVertex *v) {
+	gl_vertex_attribs(c, v);
+	gl_vertex_transform_light(c, v);
+}
+
 void glopVertex(GLContext *c, GLParam *p) {
 	GLVertex *v;
 	int n, i, cnt;
@@ -220,32 +262,7 @@ void glopVertex(GLContext *c, GLParam *p) {
 	v->coord.Z = p[3].f;
 	v->coord.W = p[4].f;
 
-	gl_vertex_transform(c, v);
-
-	// color
-
-	if (c->lighting_enabled) {
-		gl_shade_vertex(c, v);
-	} else {
-		v->color = c->current_color;
-	}
-
-	// tex coords
-
-	if (c->texture_2d_enabled) {
-		if (c->apply_texture_matrix) {
-			gl_M4_MulV4(&v->tex_coord, c->matrix_stack_ptr[2], &c->current_tex_coord);
-		} else {
-			v->tex_coord = c->current_tex_coord;
-		}
-	}
-    // precompute the mapping to the viewport
-	if (v->clip_code == 0)
-		gl_transform_to_viewport(c, v);
-
-    // edge flag
-
-	v->edge_flag = c->current_edge_flag;
+	gl_vertex_setup(c, v);
 
 	switch (c->begin_type) {
 	case TGL_POINTS:
@@ -0,0 +1,181 @@
+// Binned triangle rasterization
+//
+// When enabled, the fill routines are not called right away: each triangle
+// is recorded, together with the state it needs, in every horizontal band of
+// the screen it touches. The bands are rasterized in parallel at flush time.
+// A band is only ever drawn by a single thread, and inside a band triangles
+// are drawn in submission order, so the result is the same as drawing them
+// one after the other.
+
+#include "common/thread.h"
+#include "common/util.h"
+
+#include "graphics/tinygl/zbuffer.h"
+
+namespace TinyGL {
+
+// height of a band, in scan lines
+#define ZB_BAND_HEIGHT 16
+// number of triangles recorded before the bins are flushed
+#define ZB_MAX_BINNED_TRIANGLES 4096
+
+struct ZBufferTriangle {
+	ZB_fillTriangleFunc fill;
+	PIXEL *texture;
+	unsigned char *shadow_mask_buf;
+	int shadow_color_r;
+	int shadow_color_g;
+	int shadow_color_b;
+	ZBufferPoint p[3];
+};
+
+struct ZBufferBins {
+	Common::WorkerPool *pool;
+	ZBufferTriangle *triangles;
+	int nb_triangles;
+	int nb_bands;
+	int **band_triangles;
+	int *band_count;
+};
+
+static void ZB_freeBands(ZBufferBins *bins) {
+	for (int i = 0; i < bins->nb_bands; i++)
+		gl_free(bins->band_triangles[i]);
+	gl_free(bins->band_triangles);
+	gl_free(bins->band_count);
+	bins->band_triangles = NULL;
+	bins->band_count = NULL;
+	bins->nb_bands = 0;
+}
+
+static void ZB_allocBands(ZBufferBins *bins, int ysize) {
+	bins->nb_bands = (ysize + ZB_BAND_HEIGHT - 1) / ZB_BAND_HEIGHT;
+	bins->band_triangles = (int **)gl_malloc(bins->nb_bands * sizeof(int *));
+	bins->band_count = (int *)gl_zalloc(bins->nb_bands * sizeof(int));
+	for (int i = 0; i < bins->nb_bands; i++)
+		bins->band_triangles[i] = (int *)gl_malloc(ZB_MAX_BINNED_TRIANGLES * sizeof(int));
+}
+
+void ZB_closeBins(ZBuffer *zb) {
+	ZBufferBins *bins = zb->bins;
+
+	if (!bins)
+		return;
+
+	ZB_flushTriangles(zb);
+	zb->bins = NULL;
+
+	delete bins->pool;
+	ZB_freeBands(bins);
+	gl_free(bins->triangles);
+	gl_free(bins);
+}
+
+void ZB_setRasterThreads(ZBuffer *zb, int numThreads) {
+	ZBufferBins *bins;
+
+	ZB_closeBins(zb);
+
+	// the calling thread rasterizes too
+	if (numThreads <= 1)
+		return;
+
+	bins = (ZBufferBins *)gl_zalloc(sizeof(ZBufferBins));
+	bins->pool = new Common::WorkerPool(numThreads - 1);
+	if (bins->pool->getNumThreads() == 0) {
+		// no thread support: keep drawing triangles immediately
+		delete bins->pool;
+		gl_free(bins);
+		return;
+	}
+
+	bins->triangles = (ZBufferTriangle *)gl_malloc(ZB_MAX_BINNED_TRIANGLES * sizeof(ZBufferTriangle));
+	ZB_allocBands(bins, zb->ysize);
+	zb->bins = bins;
+}
+
+void ZB_binTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill, ZBufferPoint *p0,
+					ZBufferPoint *p1, ZBufferPoint *p2) {
+	ZBufferBins *bins = zb->bins;
+	ZBufferTriangle *t;
+	int ymin, ymax, band, last_band, index;
+
+	if (bins->nb_triangles == ZB_MAX_BINNED_TRIANGLES)
+		ZB_flushTriangles(zb);
+
+	// the screen may have been resized since the bands were set up
+	if (bins->nb_bands != (zb->ysize + ZB_BAND_HEIGHT - 1) / ZB_BAND_HEIGHT) {
+		ZB_freeBands(bins);
+		ZB_allocBands(bins, zb->ysize);
+	}
+
+	ymin = MIN(p0->y, MIN(p1->y, p2->y));
+	ymax = MAX(p0->y, MAX(p1->y, p2->y));
+	if (ymax < 0 || ymin >= zb->ysize)
+		return;
+	if (ymin < 0)
+		ymin = 0;
+	if (ymax >= zb->ysize)
+		ymax = zb->ysize - 1;
+
+	index = bins->nb_triangles++;
+	t = &bins->triangles[index];
+	t->fill = fill;
+	t->texture = zb->current_texture;
+	t->shadow_mask_buf = zb->shadow_mask_buf;
+	t->shadow_color_r = zb->shadow_color_r;
+	t->shadow_color_g = zb->shadow_color_g;
+	t->shadow_color_b = zb->shadow_color_b;
+	t->p[0] = *p0;
+	t->p[1] = *p1;
+	t->p[2] = *p2;
+
+	last_band = ymax / ZB_BAND_HEIGHT;
+	for (band = ymin / ZB_BAND_HEIGHT; band <= last_band; band++)
+		bins->band_triangles[band][bins->band_count[band]++] = index;
+}
+
+static void ZB_rasterizeBand(void *param, int band) {
+	ZBuffer *zb = (ZBuffer *)param;
+	ZBufferBins *bins = zb->bins;
+	ZBufferPoint p0, p1, p2;
+	ZBuffer local;
+	int i, n;
+
+	// each band draws through its own copy of the z buffer state, clipped
+	// to the band's scan lines
+	local = *zb;
+	local.bins = NULL;
+	local.clip_ymin = MAX(band * ZB_BAND_HEIGHT, zb->clip_ymin);
+	local.clip_ymax = MIN((band + 1) * ZB_BAND_HEIGHT, zb->clip_ymax);
+
+	n = bins->band_count[band];
+	for (i = 0; i < n; i++) {
+		ZBufferTriangle *t = &bins->triangles[bins->band_triangles[band][i]];
+
+		local.current_texture = t->texture;
+		local.shadow_mask_buf = t->shadow_mask_buf;
+		local.shadow_color_r = t->shadow_color_r;
+		local.shadow_color_g = t->shadow_color_g;
+		local.shadow_color_b = t->shadow_color_b;
+
+		// the fill routines may modify the points
+		p0 = t->p[0];
+		p1 = t->p[1];
+		p2 = t->p[2];
+		t->fill(&local, &p0, &p1, &p2);
+	}
+	bins->band_count[band] = 0;
+}
+
+void ZB_flushTriangles(ZBuffer *zb) {
+	ZBufferBins *bins = zb->bins;
+
+	if (!bins || bins->nb_triangles == 0)
+		return;
+
+	bins->pool->run(ZB_rasterizeBand, zb, bins->nb_bands);
+	bins->nb_triangles = 0;
+}
+
+} // end of namespace TinyGL
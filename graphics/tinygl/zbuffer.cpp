@@ -2,6 +2,7 @@
 // Z buffer: 16,32 bits Z / 16 bits color
 
 #include "common/scummsys.h"
+#include "common/util.h"
 
 #include "graphics/tinygl/zbuffer.h"
 
@@ -53,9 +54,18 @@ ZBuffer *ZB_open(int xsize, int ysize, int mode, void *frame_buffer) {
 		zb->pbuf = (PIXEL *)frame_buffer;
 	}
 
+	// zero is below any depth, so the tiles never hide anything until updated
+	zb->ztiles_xsize = (zb->xsize + ZB_TILE_SIZE - 1) >> ZB_TILE_SHIFT;
+	zb->ztiles_ysize = (zb->ysize + ZB_TILE_SIZE - 1) >> ZB_TILE_SHIFT;
+	zb->ztiles = (unsigned short *)gl_zalloc(zb->ztiles_xsize * zb->ztiles_ysize * sizeof(unsigned short));
+
 	zb->current_texture = NULL;
 	zb->shadow_mask_buf = NULL;
 
+	zb->clip_ymin = 0;
+	zb->clip_ymax = zb->ysize;
+	zb->bins = NULL;
+
 	return zb;
 error:
 	gl_free(zb);
@@ -63,23 +73,30 @@ error:
 }
 
 void ZB_close(ZBuffer *zb) {
+    ZB_closeBins(zb);
+
     if (zb->frame_buffer_allocated)
 		gl_free(zb->pbuf);
 
     gl_free(zb->zbuf);
     gl_free(zb->zbuf2);
+    gl_free(zb->ztiles);
     gl_free(zb);
 }
 
 void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize) {
 	int size;
 
+	ZB_flushTriangles(zb);
+
 	// xsize must be a multiple of 4
 	xsize = xsize & ~3;
 
 	zb->xsize = xsize;
 	zb->ysize = ysize;
 	zb->linesize = (xsize * PSZB + 3) & ~3;
+	zb->clip_ymin = 0;
+	zb->clip_ymax = ysize;
 
 	size = zb->xsize * zb->ysize * sizeof(unsigned short);
 
@@ -91,6 +108,11 @@ void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize) {
 	gl_free(zb->zbuf2);
 	zb->zbuf2 = (unsigned int *)gl_malloc(size);
 
+	gl_free(zb->ztiles);
+	zb->ztiles_xsize = (zb->xsize + ZB_TILE_SIZE - 1) >> ZB_TILE_SHIFT;
+	zb->ztiles_ysize = (zb->ysize + ZB_TILE_SIZE - 1) >> ZB_TILE_SHIFT;
+	zb->ztiles = (unsigned short *)gl_zalloc(zb->ztiles_xsize * zb->ztiles_ysize * sizeof(unsigned short));
+
 	if (zb->frame_buffer_allocated)
 		gl_free(zb->pbuf);
 
@@ -103,6 +125,84 @@ void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize) {
 	}
 }
 
+// Coarse z buffer
+//
+// The fill routines only draw a pixel if its depth is at least the zbuf
+// value, which is only ever written by ZB_clear() and by the users blitting
+// a prerendered z bitmap into it. Keeping the lowest zbuf value of each tile
+// lets a span be rejected at once when it stays below all the tiles it
+// crosses. zbuf2 is not tracked: the fill routines only raise it, and
+// testing it needs the pixel loop anyway.
+
+void ZB_updateTiles(ZBuffer *zb, int x, int y, int w, int h) {
+	int tx0, ty0, tx1, ty1, tx, ty;
+
+	if (x < 0) {
+		w += x;
+		x = 0;
+	}
+	if (y < 0) {
+		h += y;
+		y = 0;
+	}
+	if (x + w > zb->xsize)
+		w = zb->xsize - x;
+	if (y + h > zb->ysize)
+		h = zb->ysize - y;
+	if (w <= 0 || h <= 0)
+		return;
+
+	tx0 = x >> ZB_TILE_SHIFT;
+	ty0 = y >> ZB_TILE_SHIFT;
+	tx1 = (x + w - 1) >> ZB_TILE_SHIFT;
+	ty1 = (y + h - 1) >> ZB_TILE_SHIFT;
+
+	for (ty = ty0; ty <= ty1; ty++) {
+		int ymin = ty << ZB_TILE_SHIFT;
+		int ymax = MIN(ymin + ZB_TILE_SIZE, zb->ysize);
+		for (tx = tx0; tx <= tx1; tx++) {
+			int xmin = tx << ZB_TILE_SHIFT;
+			int xmax = MIN(xmin + ZB_TILE_SIZE, zb->xsize);
+			unsigned short zmin = 0xffff;
+			for (int py = ymin; py < ymax; py++) {
+				unsigned short *pz = zb->zbuf + py * zb->xsize;
+				for (int px = xmin; px < xmax; px++) {
+					if (pz[px] < zmin)
+						zmin = pz[px];
+				}
+			}
+			zb->ztiles[ty * zb->ztiles_xsize + tx] = zmin;
+		}
+	}
+}
+
+// Returns whether no pixel of the n pixels span starting at (x, y) can pass
+// the z test. The depth of the pixels is z + i * dzdx, computed modulo 2^32
+// by the fill routines.
+int ZB_spanHidden(ZBuffer *zb, int y, int x, int n, int z, int dzdx) {
+	unsigned short *tile, *last;
+	double zstart, zend;
+	unsigned int zmax;
+
+	if (n <= 0)
+		return 1;
+
+	// give up if the depth wraps around along the span
+	zstart = (double)(unsigned int)z;
+	zend = zstart + (double)(n - 1) * dzdx;
+	if (zend < 0.0 || zend >= 4294967296.0)
+		return 0;
+	zmax = (unsigned int)MAX(zstart, zend) >> ZB_POINT_Z_FRAC_BITS;
+
+	tile = zb->ztiles + (y >> ZB_TILE_SHIFT) * zb->ztiles_xsize;
+	last = tile + ((x + n - 1) >> ZB_TILE_SHIFT);
+	for (tile += x >> ZB_TILE_SHIFT; tile <= last; tile++) {
+		if (zmax >= *tile)
+			return 0;
+	}
+	return 1;
+}
+
 static void ZB_copyBuffer(ZBuffer *zb, void *buf, int linesize) {
 	unsigned char *p1;
 	PIXEL *q;
@@ -177,8 +277,11 @@ void ZB_clear(ZBuffer *zb, int clear_z, int z, int clear_color, int r, int g, in
 	int y;
 	PIXEL *pp;
 
+	ZB_flushTriangles(zb);
+
 	if (clear_z) {
 		memset_s(zb->zbuf, z, zb->xsize * zb->ysize);
+		memset_s(zb->ztiles, z, zb->ztiles_xsize * zb->ztiles_ysize);
 	}
 	if (clear_z) {
 		memset_l(zb->zbuf2, z, zb->xsize * zb->ysize);
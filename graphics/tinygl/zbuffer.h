@@ -30,6 +30,12 @@ typedef unsigned short PIXEL;
 #define PSZB 2 
 #define PSZSH 4 
 
+// size of the tiles of the coarse z buffer, as a power of 2
+#define ZB_TILE_SHIFT 3
+#define ZB_TILE_SIZE (1 << ZB_TILE_SHIFT)
+
+struct ZBufferBins;
+
 typedef struct {
 	int xsize, ysize;
 	int linesize; // line size, in bytes
@@ -47,6 +53,15 @@ typedef struct {
 	unsigned char *dctable;
 	int *ctable;
 	PIXEL *current_texture;
+
+	// coarse z buffer: the lowest zbuf value of each tile
+	unsigned short *ztiles;
+	int ztiles_xsize, ztiles_ysize;
+
+	// the fill routines only draw the scan lines in [clip_ymin, clip_ymax)
+	int clip_ymin, clip_ymax;
+	// non-NULL when triangles are binned for threaded rasterization
+	struct ZBufferBins *bins;
 } ZBuffer;
 
 typedef struct {
@@ -65,6 +80,9 @@ void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize);
 void ZB_clear(ZBuffer *zb, int clear_z, int z, int clear_color, int r, int g, int b);
 // linesize is in BYTES
 void ZB_copyFrameBuffer(ZBuffer *zb, void *buf, int linesize);
+// must be called after writing to zbuf directly
+void ZB_updateTiles(ZBuffer *zb, int x, int y, int w, int h);
+int ZB_spanHidden(ZBuffer *zb, int y, int x, int n, int z, int dzdx);
 
 // zline.c
 
@@ -90,6 +108,37 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0,
 typedef void (*ZB_fillTriangleFunc)(ZBuffer *, ZBufferPoint *,
 									ZBufferPoint *, ZBufferPoint *);
 
+// zspan.c
+
+// Kernels drawing the n pixels of a scan line for the fill routines. The
+// perspective one always draws 8 pixels.
+typedef struct {
+	void (*flat)(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+				 unsigned int z, int dzdx, PIXEL color);
+	void (*smooth)(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+				   unsigned int z, int dzdx, unsigned int rgb, unsigned int drgbdx);
+	void (*mapping)(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+					unsigned int z, int dzdx, unsigned int s, int dsdx,
+					unsigned int t, int dtdx, PIXEL *texture);
+	void (*mappingPerspective8)(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+								unsigned int z, int dzdx, unsigned int s, int dsdx,
+								unsigned int t, int dtdx, unsigned int rgb,
+								unsigned int drgbdx, PIXEL *texture);
+} ZBufferSpans;
+
+extern ZBufferSpans zb_spans;
+// use the SIMD kernels if built in (the default), or the C ones; returns
+// whether the SIMD kernels are in use
+int ZB_selectSpans(int simd);
+
+// zbin.c
+
+void ZB_setRasterThreads(ZBuffer *zb, int numThreads);
+void ZB_binTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill, ZBufferPoint *p0,
+					ZBufferPoint *p1, ZBufferPoint *p2);
+void ZB_flushTriangles(ZBuffer *zb);
+void ZB_closeBins(ZBuffer *zb);
+
 // memory.c
 void gl_free(void *p);
 void *gl_malloc(int size);
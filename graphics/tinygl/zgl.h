@@ -123,6 +123,17 @@ typedef struct GLVertex {
 	ZBufferPoint zp;      // integer coordinates for the rasterization
 } GLVertex;
 
+#define GL_VERTEX_BLOCK 64
+
+// vertices waiting to be transformed and lit together, with their object
+// coordinates and normals kept as separate arrays
+typedef struct GLVertexBlock {
+	GLVertex *vertex[GL_VERTEX_BLOCK];
+	float x[GL_VERTEX_BLOCK], y[GL_VERTEX_BLOCK], z[GL_VERTEX_BLOCK];
+	float nx[GL_VERTEX_BLOCK], ny[GL_VERTEX_BLOCK], nz[GL_VERTEX_BLOCK];
+	int n;
+} GLVertexBlock;
+
 typedef struct GLImage {
 	void *pixmap;
 	int xsize, ysize;
@@ -252,6 +263,14 @@ typedef struct GLContext {
 	int texcoord_array_stride;
 	int client_states;
 
+	// glDrawElements: the array elements already processed by the current
+	// call are those whose stamp is element_serial
+	GLVertex *element_vertex;
+	int *element_stamp;
+	int element_max;
+	int element_serial;
+	GLVertexBlock vertex_block;
+
 	// opengl 1.1 polygon offset
 	float offset_factor;
 	float offset_units;
@@ -278,6 +297,15 @@ extern GLContext *gl_ctx;
 
 void gl_add_op(GLParam *p);
 
+// vertex.c
+void gl_vertex_attribs(GLContext *c, GLVertex *v);
+void gl_vertex_transform_light(GLContext *c, GLVertex *v);
+void gl_vertex_setup(GLContext *c, GLVertex *v);
+
+// vblock.c
+void gl_vertex_block_add(GLContext *c, GLVertex *v);
+void gl_vertex_block_flush(GLContext *c);
+
 // clip.c
 void gl_transform_to_viewport(GLContext *c, GLVertex *v);
 void gl_draw_triangle(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p2);
@@ -0,0 +1,572 @@
+
+// Span kernels for the triangle fill routines
+//
+// A span is the run of pixels of one scan line covered by a triangle. The
+// plain C kernels are the reference implementation; the SSE2 and NEON ones
+// test and write 8 pixels per iteration and must give exactly the same
+// result. The fastest kernels built in are used unless ZB_selectSpans()
+// asks for the reference ones.
+
+#include "common/endian.h"
+
+#include "graphics/tinygl/zbuffer.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ZB_SPANS_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ZB_SPANS_NEON
+#endif
+
+namespace TinyGL {
+
+#define ZCMP(z, zpix) ((z) >= (zpix))
+
+// bits cleared after each step of the packed rgb value, so that a field
+// never carries into the next one
+#define RGB_GUARD_BITS 0x00200800
+
+static inline PIXEL ZB_lightTexel(PIXEL pixel, unsigned int rgb) {
+	unsigned int tmp = rgb & 0xF81F07E0;
+	unsigned int light = tmp | (tmp >> 16);
+	unsigned int c_r = (pixel & 0xF800) >> 8;
+	unsigned int c_g = (pixel & 0x07E0) >> 3;
+	unsigned int c_b = (pixel & 0x001F) << 3;
+	unsigned int l_r = (light & 0xF800) >> 8;
+	unsigned int l_g = (light & 0x07E0) >> 3;
+	unsigned int l_b = (light & 0x001F) << 3;
+	c_r = (c_r * l_r) / 256;
+	c_g = (c_g * l_g) / 256;
+	c_b = (c_b * l_b) / 256;
+	return ((c_r & 0xF8) << 8) | ((c_g & 0xFC) << 3) | (c_b >> 3);
+}
+
+static inline const char *ZB_perspectiveTexel(PIXEL *texture, unsigned int s, unsigned int t) {
+	unsigned int ttt = (t & 0x003FC000) >> (9 - PSZSH);
+	unsigned int sss = (s & 0x003FC000) >> (17 - PSZSH);
+	return (const char *)texture + (((ttt | sss) >> 1) * 3);
+}
+
+static void ZB_spanFlatC(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+						 unsigned int z, int dzdx, PIXEL color) {
+	for (int i = 0; i < n; i++) {
+		unsigned int zz = z >> ZB_POINT_Z_FRAC_BITS;
+		if (ZCMP(zz, pz[i]) && ZCMP(z, pz_2[i])) {
+			pp[i] = color;
+			pz_2[i] = z;
+		}
+		z += dzdx;
+	}
+}
+
+static void ZB_spanSmoothC(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+						   unsigned int z, int dzdx, unsigned int rgb, unsigned int drgbdx) {
+	for (int i = 0; i < n; i++) {
+		unsigned int zz = z >> ZB_POINT_Z_FRAC_BITS;
+		if (ZCMP(zz, pz[i]) && ZCMP(z, pz_2[i])) {
+			unsigned int tmp = rgb & 0xF81F07E0;
+			pp[i] = tmp | (tmp >> 16);
+			pz_2[i] = z;
+		}
+		z += dzdx;
+		rgb = (rgb + drgbdx) & (~RGB_GUARD_BITS);
+	}
+}
+
+static void ZB_spanMappingC(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+							unsigned int z, int dzdx, unsigned int s, int dsdx,
+							unsigned int t, int dtdx, PIXEL *texture) {
+	for (int i = 0; i < n; i++) {
+		unsigned int zz = z >> ZB_POINT_Z_FRAC_BITS;
+		if (ZCMP(zz, pz[i]) && ZCMP(z, pz_2[i])) {
+			pp[i] = texture[((t & 0x3FC00000) | s) >> 14];
+			pz_2[i] = z;
+		}
+		z += dzdx;
+		s += dsdx;
+		t += dtdx;
+	}
+}
+
+static void ZB_spanMappingPerspective8C(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+										unsigned int z, int dzdx, unsigned int s, int dsdx,
+										unsigned int t, int dtdx, unsigned int rgb,
+										unsigned int drgbdx, PIXEL *texture) {
+	for (int i = 0; i < 8; i++) {
+		unsigned int zz = z >> ZB_POINT_Z_FRAC_BITS;
+		if (ZCMP(zz, pz[i]) && ZCMP(z, pz_2[i])) {
+			const char *ptr = ZB_perspectiveTexel(texture, s, t);
+			if (*(ptr + 2) == '\xff') {
+				pp[i] = ZB_lightTexel(READ_UINT16(ptr), rgb);
+				pz_2[i] = z;
+			}
+		}
+		z += dzdx;
+		s += dsdx;
+		t += dtdx;
+		rgb = (rgb + drgbdx) & (~RGB_GUARD_BITS);
+	}
+}
+
+#if defined(ZB_SPANS_SSE2) || defined(ZB_SPANS_NEON)
+
+// the rgb step, applied 8 times to each color field
+static inline unsigned int ZB_rgbStep8(unsigned int drgbdx) {
+	for (int i = 0; i < 3; i++)
+		drgbdx = (drgbdx + drgbdx) & (~RGB_GUARD_BITS);
+	return drgbdx;
+}
+
+// the values of an interpolant at the 8 pixels of a block
+static inline void ZB_lanes8(unsigned int *lanes, unsigned int v, int dvdx) {
+	for (int i = 0; i < 8; i++) {
+		lanes[i] = v;
+		v += dvdx;
+	}
+}
+
+static inline void ZB_rgbLanes8(unsigned int *lanes, unsigned int rgb, unsigned int drgbdx) {
+	for (int i = 0; i < 8; i++) {
+		lanes[i] = rgb;
+		rgb = (rgb + drgbdx) & (~RGB_GUARD_BITS);
+	}
+}
+
+#endif
+
+#ifdef ZB_SPANS_SSE2
+
+// a >= b on unsigned 32 bit lanes
+static inline __m128i ZB_cmpgeU32(__m128i a, __m128i b) {
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	__m128i lt = _mm_cmpgt_epi32(_mm_xor_si128(b, bias), _mm_xor_si128(a, bias));
+	return _mm_xor_si128(lt, _mm_set1_epi32(-1));
+}
+
+// z test of 8 pixels: returns the 16 bit lane mask, and the 32 bit ones
+// for each half in m0 and m1
+static inline __m128i ZB_zTest8(__m128i z0, __m128i z1, const unsigned short *pz,
+								const unsigned int *pz_2, __m128i &m0, __m128i &m1) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i zpix = _mm_loadu_si128((const __m128i *)pz);
+	m0 = _mm_and_si128(ZB_cmpgeU32(_mm_srli_epi32(z0, ZB_POINT_Z_FRAC_BITS), _mm_unpacklo_epi16(zpix, zero)),
+					   ZB_cmpgeU32(z0, _mm_loadu_si128((const __m128i *)pz_2)));
+	m1 = _mm_and_si128(ZB_cmpgeU32(_mm_srli_epi32(z1, ZB_POINT_Z_FRAC_BITS), _mm_unpackhi_epi16(zpix, zero)),
+					   ZB_cmpgeU32(z1, _mm_loadu_si128((const __m128i *)(pz_2 + 4))));
+	return _mm_packs_epi32(m0, m1);
+}
+
+static inline void ZB_store8(void *dst, __m128i v, __m128i mask) {
+	__m128i old = _mm_loadu_si128((const __m128i *)dst);
+	_mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_and_si128(mask, v), _mm_andnot_si128(mask, old)));
+}
+
+static inline void ZB_storeZ8(unsigned int *pz_2, __m128i z0, __m128i z1, __m128i m0, __m128i m1) {
+	ZB_store8(pz_2, z0, m0);
+	ZB_store8(pz_2 + 4, z1, m1);
+}
+
+// the 16 bit pixels for packed rgb values
+static inline __m128i ZB_rgbToPixel8(__m128i rgb0, __m128i rgb1) {
+	const __m128i fields = _mm_set1_epi32((int)0xF81F07E0);
+	__m128i p0 = _mm_and_si128(rgb0, fields);
+	__m128i p1 = _mm_and_si128(rgb1, fields);
+	p0 = _mm_or_si128(p0, _mm_srli_epi32(p0, 16));
+	p1 = _mm_or_si128(p1, _mm_srli_epi32(p1, 16));
+	// sign extend the low halves so that the saturating pack keeps them
+	p0 = _mm_srai_epi32(_mm_slli_epi32(p0, 16), 16);
+	p1 = _mm_srai_epi32(_mm_slli_epi32(p1, 16), 16);
+	return _mm_packs_epi32(p0, p1);
+}
+
+static void ZB_spanFlatSSE2(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+							unsigned int z, int dzdx, PIXEL color) {
+	unsigned int lanes[8];
+	__m128i z0, z1, m0, m1, mask;
+	const __m128i vcolor = _mm_set1_epi16((short)color);
+	const __m128i dz8 = _mm_set1_epi32((int)((unsigned int)dzdx * 8));
+
+	ZB_lanes8(lanes, z, dzdx);
+	z0 = _mm_loadu_si128((const __m128i *)lanes);
+	z1 = _mm_loadu_si128((const __m128i *)(lanes + 4));
+	while (n >= 8) {
+		mask = ZB_zTest8(z0, z1, pz, pz_2, m0, m1);
+		if (_mm_movemask_epi8(mask)) {
+			ZB_store8(pp, vcolor, mask);
+			ZB_storeZ8(pz_2, z0, z1, m0, m1);
+		}
+		z0 = _mm_add_epi32(z0, dz8);
+		z1 = _mm_add_epi32(z1, dz8);
+		z += (unsigned int)dzdx * 8;
+		pp += 8;
+		pz += 8;
+		pz_2 += 8;
+		n -= 8;
+	}
+	ZB_spanFlatC(pp, pz, pz_2, n, z, dzdx, color);
+}
+
+static void ZB_spanSmoothSSE2(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+							  unsigned int z, int dzdx, unsigned int rgb, unsigned int drgbdx) {
+	unsigned int lanes[8];
+	__m128i z0, z1, rgb0, rgb1, m0, m1, mask;
+	const __m128i dz8 = _mm_set1_epi32((int)((unsigned int)dzdx * 8));
+	const unsigned int drgb8 = ZB_rgbStep8(drgbdx);
+	const __m128i vdrgb8 = _mm_set1_epi32((int)drgb8);
+	const __m128i guard = _mm_set1_epi32((int)(~RGB_GUARD_BITS));
+
+	ZB_lanes8(lanes, z, dzdx);
+	z0 = _mm_loadu_si128((const __m128i *)lanes);
+	z1 = _mm_loadu_si128((const __m128i *)(lanes + 4));
+	ZB_rgbLanes8(lanes, rgb, drgbdx);
+	rgb0 = _mm_loadu_si128((const __m128i *)lanes);
+	rgb1 = _mm_loadu_si128((const __m128i *)(lanes + 4));
+	while (n >= 8) {
+		mask = ZB_zTest8(z0, z1, pz, pz_2, m0, m1);
+		if (_mm_movemask_epi8(mask)) {
+			ZB_store8(pp, ZB_rgbToPixel8(rgb0, rgb1), mask);
+			ZB_storeZ8(pz_2, z0, z1, m0, m1);
+		}
+		z0 = _mm_add_epi32(z0, dz8);
+		z1 = _mm_add_epi32(z1, dz8);
+		rgb0 = _mm_and_si128(_mm_add_epi32(rgb0, vdrgb8), guard);
+		rgb1 = _mm_and_si128(_mm_add_epi32(rgb1, vdrgb8), guard);
+		z += (unsigned int)dzdx * 8;
+		rgb = (rgb + drgb8) & (~RGB_GUARD_BITS);
+		pp += 8;
+		pz += 8;
+		pz_2 += 8;
+		n -= 8;
+	}
+	ZB_spanSmoothC(pp, pz, pz_2, n, z, dzdx, rgb, drgbdx);
+}
+
+static void ZB_spanMappingSSE2(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+							   unsigned int z, int dzdx, unsigned int s, int dsdx,
+							   unsigned int t, int dtdx, PIXEL *texture) {
+	unsigned int lanes[8];
+	PIXEL texels[8];
+	__m128i z0, z1, m0, m1, mask;
+	const __m128i dz8 = _mm_set1_epi32((int)((unsigned int)dzdx * 8));
+
+	ZB_lanes8(lanes, z, dzdx);
+	z0 = _mm_loadu_si128((const __m128i *)lanes);
+	z1 = _mm_loadu_si128((const __m128i *)(lanes + 4));
+	while (n >= 8) {
+		mask = ZB_zTest8(z0, z1, pz, pz_2, m0, m1);
+		int bits = _mm_movemask_epi8(mask);
+		if (bits) {
+			// only fetch the texels of visible pixels
+			unsigned int ss = s, tt = t;
+			for (int i = 0; i < 8; i++) {
+				texels[i] = (bits & (1 << (2 * i))) ? texture[((tt & 0x3FC00000) | ss) >> 14] : 0;
+				ss += dsdx;
+				tt += dtdx;
+			}
+			ZB_store8(pp, _mm_loadu_si128((const __m128i *)texels), mask);
+			ZB_storeZ8(pz_2, z0, z1, m0, m1);
+		}
+		z0 = _mm_add_epi32(z0, dz8);
+		z1 = _mm_add_epi32(z1, dz8);
+		z += (unsigned int)dzdx * 8;
+		s += (unsigned int)dsdx * 8;
+		t += (unsigned int)dtdx * 8;
+		pp += 8;
+		pz += 8;
+		pz_2 += 8;
+		n -= 8;
+	}
+	ZB_spanMappingC(pp, pz, pz_2, n, z, dzdx, s, dsdx, t, dtdx, texture);
+}
+
+static void ZB_spanMappingPerspective8SSE2(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+										   unsigned int z, int dzdx, unsigned int s, int dsdx,
+										   unsigned int t, int dtdx, unsigned int rgb,
+										   unsigned int drgbdx, PIXEL *texture) {
+	unsigned int lanes[8];
+	PIXEL texels[8];
+	short opaque[8];
+	__m128i z0, z1, m0, m1, mask, c, l, r, g, b;
+
+	ZB_lanes8(lanes, z, dzdx);
+	z0 = _mm_loadu_si128((const __m128i *)lanes);
+	z1 = _mm_loadu_si128((const __m128i *)(lanes + 4));
+	mask = ZB_zTest8(z0, z1, pz, pz_2, m0, m1);
+	int bits = _mm_movemask_epi8(mask);
+	if (!bits)
+		return;
+
+	for (int i = 0; i < 8; i++) {
+		texels[i] = 0;
+		opaque[i] = 0;
+		if (bits & (1 << (2 * i))) {
+			const char *ptr = ZB_perspectiveTexel(texture, s, t);
+			texels[i] = READ_UINT16(ptr);
+			opaque[i] = (*(ptr + 2) == '\xff') ? -1 : 0;
+		}
+		s += dsdx;
+		t += dtdx;
+	}
+	mask = _mm_and_si128(mask, _mm_loadu_si128((const __m128i *)opaque));
+	if (!_mm_movemask_epi8(mask))
+		return;
+
+	ZB_rgbLanes8(lanes, rgb, drgbdx);
+	l = ZB_rgbToPixel8(_mm_loadu_si128((const __m128i *)lanes), _mm_loadu_si128((const __m128i *)(lanes + 4)));
+	c = _mm_loadu_si128((const __m128i *)texels);
+
+	// the products of two 8 bit components fit in the 16 bit lanes
+	r = _mm_srli_epi16(_mm_mullo_epi16(_mm_srli_epi16(_mm_and_si128(c, _mm_set1_epi16((short)0xF800)), 8),
+									   _mm_srli_epi16(_mm_and_si128(l, _mm_set1_epi16((short)0xF800)), 8)), 8);
+	g = _mm_srli_epi16(_mm_mullo_epi16(_mm_srli_epi16(_mm_and_si128(c, _mm_set1_epi16(0x07E0)), 3),
+									   _mm_srli_epi16(_mm_and_si128(l, _mm_set1_epi16(0x07E0)), 3)), 8);
+	b = _mm_srli_epi16(_mm_mullo_epi16(_mm_slli_epi16(_mm_and_si128(c, _mm_set1_epi16(0x001F)), 3),
+									   _mm_slli_epi16(_mm_and_si128(l, _mm_set1_epi16(0x001F)), 3)), 8);
+	c = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(r, _mm_set1_epi16(0xF8)), 8),
+					 _mm_or_si128(_mm_slli_epi16(_mm_and_si128(g, _mm_set1_epi16(0xFC)), 3),
+								  _mm_srli_epi16(b, 3)));
+
+	ZB_store8(pp, c, mask);
+	ZB_storeZ8(pz_2, z0, z1, _mm_unpacklo_epi16(mask, mask), _mm_unpackhi_epi16(mask, mask));
+}
+
+#endif // ZB_SPANS_SSE2
+
+#ifdef ZB_SPANS_NEON
+
+// z test of 8 pixels: returns the 16 bit lane mask, and the 32 bit ones
+// for each half in m0 and m1
+static inline uint16x8_t ZB_zTest8(uint32x4_t z0, uint32x4_t z1, const unsigned short *pz,
+								   const unsigned int *pz_2, uint32x4_t &m0, uint32x4_t &m1) {
+	uint16x8_t zpix = vld1q_u16(pz);
+	m0 = vandq_u32(vcgeq_u32(vshrq_n_u32(z0, ZB_POINT_Z_FRAC_BITS), vmovl_u16(vget_low_u16(zpix))),
+				   vcgeq_u32(z0, vld1q_u32(pz_2)));
+	m1 = vandq_u32(vcgeq_u32(vshrq_n_u32(z1, ZB_POINT_Z_FRAC_BITS), vmovl_u16(vget_high_u16(zpix))),
+				   vcgeq_u32(z1, vld1q_u32(pz_2 + 4)));
+	return vcombine_u16(vmovn_u32(m0), vmovn_u32(m1));
+}
+
+static inline bool ZB_anyLane(uint16x8_t mask) {
+	uint16x4_t m = vorr_u16(vget_low_u16(mask), vget_high_u16(mask));
+	return vget_lane_u64(vreinterpret_u64_u16(m), 0) != 0;
+}
+
+static inline void ZB_storeZ8(unsigned int *pz_2, uint32x4_t z0, uint32x4_t z1, uint32x4_t m0, uint32x4_t m1) {
+	vst1q_u32(pz_2, vbslq_u32(m0, z0, vld1q_u32(pz_2)));
+	vst1q_u32(pz_2 + 4, vbslq_u32(m1, z1, vld1q_u32(pz_2 + 4)));
+}
+
+// the 16 bit pixels for packed rgb values
+static inline uint16x8_t ZB_rgbToPixel8(uint32x4_t rgb0, uint32x4_t rgb1) {
+	const uint32x4_t fields = vdupq_n_u32(0xF81F07E0);
+	uint32x4_t p0 = vandq_u32(rgb0, fields);
+	uint32x4_t p1 = vandq_u32(rgb1, fields);
+	p0 = vorrq_u32(p0, vshrq_n_u32(p0, 16));
+	p1 = vorrq_u32(p1, vshrq_n_u32(p1, 16));
+	return vcombine_u16(vmovn_u32(p0), vmovn_u32(p1));
+}
+
+static void ZB_spanFlatNEON(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+							unsigned int z, int dzdx, PIXEL color) {
+	unsigned int lanes[8];
+	uint32x4_t z0, z1, m0, m1;
+	uint16x8_t mask;
+	const uint16x8_t vcolor = vdupq_n_u16(color);
+	const uint32x4_t dz8 = vdupq_n_u32((unsigned int)dzdx * 8);
+
+	ZB_lanes8(lanes, z, dzdx);
+	z0 = vld1q_u32(lanes);
+	z1 = vld1q_u32(lanes + 4);
+	while (n >= 8) {
+		mask = ZB_zTest8(z0, z1, pz, pz_2, m0, m1);
+		if (ZB_anyLane(mask)) {
+			vst1q_u16(pp, vbslq_u16(mask, vcolor, vld1q_u16(pp)));
+			ZB_storeZ8(pz_2, z0, z1, m0, m1);
+		}
+		z0 = vaddq_u32(z0, dz8);
+		z1 = vaddq_u32(z1, dz8);
+		z += (unsigned int)dzdx * 8;
+		pp += 8;
+		pz += 8;
+		pz_2 += 8;
+		n -= 8;
+	}
+	ZB_spanFlatC(pp, pz, pz_2, n, z, dzdx, color);
+}
+
+static void ZB_spanSmoothNEON(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+							  unsigned int z, int dzdx, unsigned int rgb, unsigned int drgbdx) {
+	unsigned int lanes[8];
+	uint32x4_t z0, z1, rgb0, rgb1, m0, m1;
+	uint16x8_t mask;
+	const uint32x4_t dz8 = vdupq_n_u32((unsigned int)dzdx * 8);
+	const unsigned int drgb8 = ZB_rgbStep8(drgbdx);
+	const uint32x4_t vdrgb8 = vdupq_n_u32(drgb8);
+	const uint32x4_t guard = vdupq_n_u32(~RGB_GUARD_BITS);
+
+	ZB_lanes8(lanes, z, dzdx);
+	z0 = vld1q_u32(lanes);
+	z1 = vld1q_u32(lanes + 4);
+	ZB_rgbLanes8(lanes, rgb, drgbdx);
+	rgb0 = vld1q_u32(lanes);
+	rgb1 = vld1q_u32(lanes + 4);
+	while (n >= 8) {
+		mask = ZB_zTest8(z0, z1, pz, pz_2, m0, m1);
+		if (ZB_anyLane(mask)) {
+			vst1q_u16(pp, vbslq_u16(mask, ZB_rgbToPixel8(rgb0, rgb1), vld1q_u16(pp)));
+			ZB_storeZ8(pz_2, z0, z1, m0, m1);
+		}
+		z0 = vaddq_u32(z0, dz8);
+		z1 = vaddq_u32(z1, dz8);
+		rgb0 = vandq_u32(vaddq_u32(rgb0, vdrgb8), guard);
+		rgb1 = vandq_u32(vaddq_u32(rgb1, vdrgb8), guard);
+		z += (unsigned int)dzdx * 8;
+		rgb = (rgb + drgb8) & (~RGB_GUARD_BITS);
+		pp += 8;
+		pz += 8;
+		pz_2 += 8;
+		n -= 8;
+	}
+	ZB_spanSmoothC(pp, pz, pz_2, n, z, dzdx, rgb, drgbdx);
+}
+
+static void ZB_spanMappingNEON(PIXEL *pp, unsigned short *pz, unsigned int *pz_2, int n,
+							   unsigned int z, int dzdx, unsigned int s, int dsdx,
+							   unsigned int t, int dtdx, PIXEL *texture) {
+	unsigned int lanes[8];
+	unsigned short visible[8];
+	PIXEL texels[8];
+	uint32x4_t z0, z1, m0, m1;
+	uint16x8_t mask;
+	const uint32x4_t dz8 = vdupq_n_u32((unsigned int)dzdx * 8);
+
+	ZB_lanes8(lanes, z, dzdx);
+	z0 = vld1q_u32(lanes);
+	z1 = vld1q_u32(lanes + 4);
+	while (n >= 8) {
+		mask = ZB_zTest8(z0, z1, pz, pz_2, m0, m1);
+		if (ZB_anyLane(mask)) {
+			// only fetch the texels of visible pixels
+			unsigned int ss = s, tt = t;
+			vst1q_u16(visible, mask);
+			for (int i = 0; i < 8; i++) {
+				texels[i] = visible[i] ? texture[((tt & 0x3FC00000) | ss) >> 14] : 0;
+				ss += dsdx;
+				tt += dtdx;
+			}
+			vst1q_u16(pp, vbslq_u16(mask, vld1q_u16(texels), vld1q_u16(pp)));
+			ZB_storeZ8(pz_2, z0, z1, m0, m1);
+		}
+		z0 = vaddq_u32(z0, dz8);
+		z1 = vaddq_u32(z1, dz8);
+		z += (unsigned int)dzdx * 8;
+		s += (unsigned int)dsdx * 8;
+		t += (unsigned int)dtdx * 8;
+		pp += 8;
+		pz += 8;
+		pz_2 += 8;
+		n -= 8;
+	}
+	ZB_spanMappingC(pp, pz, pz_2, n, z, dzdx, s, dsdx, t, dtdx, texture);
+}
+
+static void ZB_spanMappingPerspective8NEON(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+										   unsigned int z, int dzdx, unsigned int s, int dsdx,
+										   unsigned int t, int dtdx, unsigned int rgb,
+										   unsigned int drgbdx, PIXEL *texture) {
+	unsigned int lanes[8];
+	unsigned short visible[8];
+	PIXEL texels[8];
+	uint32x4_t z0, z1, m0, m1;
+	uint16x8_t mask, c, l, r, g, b;
+
+	ZB_lanes8(lanes, z, dzdx);
+	z0 = vld1q_u32(lanes);
+	z1 = vld1q_u32(lanes + 4);
+	mask = ZB_zTest8(z0, z1, pz, pz_2, m0, m1);
+	if (!ZB_anyLane(mask))
+		return;
+
+	vst1q_u16(visible, mask);
+	for (int i = 0; i < 8; i++) {
+		texels[i] = 0;
+		if (visible[i]) {
+			const char *ptr = ZB_perspectiveTexel(texture, s, t);
+			texels[i] = READ_UINT16(ptr);
+			if (*(ptr + 2) != '\xff')
+				visible[i] = 0;
+		}
+		s += dsdx;
+		t += dtdx;
+	}
+	mask = vld1q_u16(visible);
+	if (!ZB_anyLane(mask))
+		return;
+
+	ZB_rgbLanes8(lanes, rgb, drgbdx);
+	l = ZB_rgbToPixel8(vld1q_u32(lanes), vld1q_u32(lanes + 4));
+	c = vld1q_u16(texels);
+
+	// the products of two 8 bit components fit in the 16 bit lanes
+	r = vshrq_n_u16(vmulq_u16(vshrq_n_u16(vandq_u16(c, vdupq_n_u16(0xF800)), 8),
+							  vshrq_n_u16(vandq_u16(l, vdupq_n_u16(0xF800)), 8)), 8);
+	g = vshrq_n_u16(vmulq_u16(vshrq_n_u16(vandq_u16(c, vdupq_n_u16(0x07E0)), 3),
+							  vshrq_n_u16(vandq_u16(l, vdupq_n_u16(0x07E0)), 3)), 8);
+	b = vshrq_n_u16(vmulq_u16(vshlq_n_u16(vandq_u16(c, vdupq_n_u16(0x001F)), 3),
+							  vshlq_n_u16(vandq_u16(l, vdupq_n_u16(0x001F)), 3)), 8);
+	c = vorrq_u16(vshlq_n_u16(vandq_u16(r, vdupq_n_u16(0xF8)), 8),
+				  vorrq_u16(vshlq_n_u16(vandq_u16(g, vdupq_n_u16(0xFC)), 3),
+							vshrq_n_u16(b, 3)));
+
+	vst1q_u16(pp, vbslq_u16(mask, c, vld1q_u16(pp)));
+	m0 = vreinterpretq_u32_s32(vmovl_s16(vreinterpret_s16_u16(vget_low_u16(mask))));
+	m1 = vreinterpretq_u32_s32(vmovl_s16(vreinterpret_s16_u16(vget_high_u16(mask))));
+	ZB_storeZ8(pz_2, z0, z1, m0, m1);
+}
+
+#endif // ZB_SPANS_NEON
+
+static const ZBufferSpans zb_spans_c = {
+	ZB_spanFlatC,
+	ZB_spanSmoothC,
+	ZB_spanMappingC,
+	ZB_spanMappingPerspective8C
+};
+
+#if defined(ZB_SPANS_SSE2)
+static const ZBufferSpans zb_spans_simd = {
+	ZB_spanFlatSSE2,
+	ZB_spanSmoothSSE2,
+	ZB_spanMappingSSE2,
+	ZB_spanMappingPerspective8SSE2
+};
+#define ZB_SPANS_SIMD
+#elif defined(ZB_SPANS_NEON)
+static const ZBufferSpans zb_spans_simd = {
+	ZB_spanFlatNEON,
+	ZB_spanSmoothNEON,
+	ZB_spanMappingNEON,
+	ZB_spanMappingPerspective8NEON
+};
+#define ZB_SPANS_SIMD
+#endif
+
+#ifdef ZB_SPANS_SIMD
+ZBufferSpans zb_spans = zb_spans_simd;
+#else
+ZBufferSpans zb_spans = zb_spans_c;
+#endif
+
+int ZB_selectSpans(int simd) {
+#ifdef ZB_SPANS_SIMD
+	if (simd) {
+		zb_spans = zb_spans_simd;
+		return 1;
+	}
+#endif
+	zb_spans = zb_spans_c;
+	return 0;
+}
+
+} // end of namespace TinyGL
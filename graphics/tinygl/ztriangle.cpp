@@ -15,13 +15,9 @@ void ZB_fillTriangleFlat(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuffe
 	color = RGB_TO_PIXEL(p2->r, p2->g, p2->b);	\
 }
 
-#define PUT_PIXEL(_a) {						\
-	zz = z >> ZB_POINT_Z_FRAC_BITS;			\
-	if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {	\
-	pp[_a] = color;						\
-	pz_2[_a] = z;							\
-	}										\
-	z += dzdx;								\
+#define DRAW_LINE() {										\
+	zb_spans.flat(pp1 + x1, pz1 + x1, pz2 + x1,			\
+				  (x2 >> 16) - x1 + 1, z1, dzdx, color);	\
 }
 
 #include "graphics/tinygl/ztriangle.h"
@@ -44,49 +40,14 @@ void ZB_fillTriangleSmooth(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuf
 	_drgbdx |= (SAR_RND_TO_ZERO(dbdx, 7) << 12) & 0x001FF000; 	\
 }
 
-#define PUT_PIXEL(_a) {						\
-	zz = z >> ZB_POINT_Z_FRAC_BITS;			\
-	if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {	\
-		tmp = rgb & 0xF81F07E0;				\
-		pp[_a] = tmp | (tmp >> 16);			\
-		pz_2[_a] = z;						\
-	}										\
-	z += dzdx;								\
-	rgb = (rgb + drgbdx) & (~0x00200800);	\
-}
-
-#define DRAW_LINE()	{								\
-	register unsigned short *pz;					\
-	register unsigned int *pz_2;					\
-	register PIXEL *pp;								\
-	register unsigned int z, zz, rgb, drgbdx;	\
-	register int n;									\
-	n = (x2 >> 16) - x1;							\
-	pp = pp1 + x1;									\
-	pz = pz1 + x1;									\
-	pz_2 = pz2 + x1;								\
-	z = z1;											\
-	rgb =(r1 << 16) & 0xFFC00000;					\
+#define DRAW_LINE() {									\
+	register unsigned int rgb;						\
+	rgb = (r1 << 16) & 0xFFC00000;					\
 	rgb |= (g1 >> 5) & 0x000007FF;					\
 	rgb |= (b1 << 5) & 0x001FF000;					\
-	drgbdx = _drgbdx;								\
-	while (n >= 3) {								\
-		PUT_PIXEL(0);								\
-		PUT_PIXEL(1);								\
-		PUT_PIXEL(2);								\
-		PUT_PIXEL(3);								\
-		pz += 4;									\
-		pz_2 += 4;									\
-		pp += 4;									\
-		n -= 4;										\
-	}												\
-	while (n >= 0) {								\
-		PUT_PIXEL(0);								\
-		pz += 1;									\
-		pz_2 += 1;									\
-		pp += 1;									\
-		n -= 1;										\
-	}												\
+	zb_spans.smooth(pp1 + x1, pz1 + x1, pz2 + x1,	\
+					(x2 >> 16) - x1 + 1, z1, dzdx,	\
+					rgb, _drgbdx);					\
 }
 
 #include "graphics/tinygl/ztriangle.h"
@@ -106,15 +67,10 @@ void ZB_fillTriangleMapping(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBu
 	texture = zb->current_texture;	\
 }
 
-#define PUT_PIXEL(_a) {						\
-	zz = z >> ZB_POINT_Z_FRAC_BITS;			\
-	if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {	\
-		pp[_a] = texture[((t & 0x3FC00000) | s) >> 14];	\
-		pz_2[_a] = z;						\
-	}										\
-	z += dzdx;								\
-	s += dsdx;								\
-	t += dtdx;								\
+#define DRAW_LINE() {										\
+	zb_spans.mapping(pp1 + x1, pz1 + x1, pz2 + x1,		\
+					 (x2 >> 16) - x1 + 1, z1, dzdx,		\
+					 s1, dsdx, t1, dtdx, texture);		\
 }
 
 #include "graphics/tinygl/ztriangle.h"
@@ -123,7 +79,7 @@ void ZB_fillTriangleMapping(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBu
 void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
 	PIXEL *texture;
 	float fdzdx, fndzdx, ndszdx, ndtzdx;
-	int _drgbdx;
+	int _drgbdx, drgbdx8;
 
 #define NB_INTERP 8
 
@@ -134,7 +90,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	PIXEL *pp1;
 	int part, update_left, update_right;
 
-	int nb_lines, dx1, dy1, tmp, dx2, dy2;
+	int nb_lines, dx1, dy1, tmp, dx2, dy2, cur_y;
 
 	int error = 0, derror = 0;
 	int x1 = 0, dxdy_min = 0, dxdy_max = 0;
@@ -167,6 +123,10 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 		p2 = tp;
 	}
 
+	// nothing to draw inside the clip band
+	if (p2->y < zb->clip_ymin || p0->y >= zb->clip_ymax)
+		return;
+
 	// we compute dXdx and dXdy for all interpolated values
   
 	fdx1 = (float)(p1->x - p0->x);
@@ -242,6 +202,11 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	_drgbdx = ((drdx / (1 << 6)) << 22) & 0xFFC00000;
 	_drgbdx |= (dgdx / (1 << 5)) & 0x000007FF;
 	_drgbdx |= ((dbdx / (1 << 7)) << 12) & 0x001FF000;
+	// the color step of NB_INTERP pixels, done field by field
+	drgbdx8 = _drgbdx;
+	for (tmp = 1; tmp < NB_INTERP; tmp <<= 1)
+		drgbdx8 = (drgbdx8 + drgbdx8) & (~0x00200800);
+	cur_y = p0->y;
 
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
@@ -333,7 +298,9 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 
 		while (nb_lines > 0) {
 			nb_lines--;
-			{
+			if (cur_y >= zb->clip_ymax)
+				return;
+			if (cur_y >= zb->clip_ymin && !ZB_spanHidden(zb, cur_y, x1, (x2 >> 16) - x1 + 1, z1, dzdx)) {
 				register unsigned short *pz;
 				register unsigned int *pz_2;
 				register PIXEL *pp;
@@ -365,36 +332,10 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 						fz += fndzdx;
 						zinv = (float)(1.0 / fz);
 					}
-					for (int _a = 0; _a < 8; _a++) {
-						zz = z >> ZB_POINT_Z_FRAC_BITS;
-						if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {
-							unsigned ttt = (t & 0x003FC000) >> (9 - PSZSH);
-							unsigned sss = (s & 0x003FC000) >> (17 - PSZSH);
-							char *ptr = (char *)(texture) + (((ttt | sss) >> 1) * 3);
-							PIXEL pixel = READ_UINT16(ptr);
-							char alpha = *(ptr + 2);
-							if (alpha == '\xff') {
-								tmp = rgb & 0xF81F07E0;
-								unsigned int light = tmp | (tmp >> 16);
-								unsigned int c_r = (pixel & 0xF800) >> 8;
-								unsigned int c_g = (pixel & 0x07E0) >> 3;
-								unsigned int c_b = (pixel & 0x001F) << 3;
-								unsigned int l_r = (light & 0xF800) >> 8;
-								unsigned int l_g = (light & 0x07E0) >> 3;
-								unsigned int l_b = (light & 0x001F) << 3;
-								c_r = (c_r * l_r) / 256;
-								c_g = (c_g * l_g) / 256;
-								c_b = (c_b * l_b) / 256;
-								pixel = ((c_r & 0xF8) << 8) | ((c_g & 0xFC) << 3) | (c_b >> 3);
-								pp[_a] = pixel;
-								pz_2[_a] = z;
-							}
-						}
-						z += dzdx;
-						s += dsdx;
-						t += dtdx;
-						rgb = (rgb + drgbdx) & (~0x00200800);
-					}
+					zb_spans.mappingPerspective8(pp, pz, pz_2, z, dzdx, s, dsdx, t, dtdx,
+												 rgb, drgbdx, texture);
+					z += NB_INTERP * dzdx;
+					rgb = (rgb + drgbdx8) & (~0x00200800);
 
 					pz += NB_INTERP;
 					pz_2 += NB_INTERP;
@@ -486,6 +427,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 			pp1 = (PIXEL *)((char *)pp1 + zb->linesize);
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
+			cur_y++;
 		}
 	}
 }
@@ -9,7 +9,7 @@
 	PIXEL *pp1;
 	int part, update_left, update_right;
 
-	int nb_lines, dx1, dy1, tmp, dx2, dy2;
+	int nb_lines, dx1, dy1, tmp, dx2, dy2, cur_y;
 
 	int error = 0, derror = 0;
 	int x1 = 0, dxdy_min = 0, dxdy_max = 0;
@@ -50,6 +50,10 @@
 		p2 = tp;
 	}
 
+	// nothing to draw inside the clip band
+	if (p2->y < zb->clip_ymin || p0->y >= zb->clip_ymax)
+		return;
+
 	// we compute dXdx and dXdy for all interpolated values
 
 	fdx1 = (float)(p1->x - p0->x);
@@ -136,6 +140,8 @@
 	pz1 = zb->zbuf + p0->y * zb->xsize;
 	pz2 = zb->zbuf2 + p0->y * zb->xsize;
 
+	cur_y = p0->y;
+
 	DRAW_INIT();
 
 	for (part = 0; part < 2; part++) {
@@ -241,9 +247,11 @@
 
 		while (nb_lines>0) {
 			nb_lines--;
+			if (cur_y >= zb->clip_ymax)
+				return;
 #ifndef DRAW_LINE
 			// generic draw line
-			{
+			if (cur_y >= zb->clip_ymin) {
 				register PIXEL *pp;
 				register int n;
 #ifdef INTERP_Z
@@ -304,7 +312,8 @@
 				}
 			}
 #else
-			DRAW_LINE();
+			if (cur_y >= zb->clip_ymin && !ZB_spanHidden(zb, cur_y, x1, (x2 >> 16) - x1 + 1, z1, dzdx))
+				DRAW_LINE();
 #endif
       
 			// left edge
@@ -355,6 +364,7 @@
 			pp1 = (PIXEL *)((char *)pp1 + zb->linesize);
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
+			cur_y++;
 		}
 	}
 }
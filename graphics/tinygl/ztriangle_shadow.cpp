@@ -11,7 +11,7 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 	unsigned char *pm1;
 	int part, update_left, update_right;
 
-	int nb_lines, dx1, dy1, tmp, dx2, dy2;
+	int nb_lines, dx1, dy1, tmp, dx2, dy2, cur_y;
 
 	int error = 0, derror = 0;
 	int x1 = 0, dxdy_min = 0, dxdy_max = 0;
@@ -35,6 +35,10 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 		p2 = t;
 	}
 
+	// nothing to draw inside the clip band
+	if (p2->y < zb->clip_ymin || p0->y >= zb->clip_ymax)
+		return;
+
 	// we compute dXdx and dXdy for all interpolated values
 
 	fdx1 = (float)(p1->x - p0->x);
@@ -56,6 +60,7 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 	// screen coordinates
 
 	pm1 = zb->shadow_mask_buf + zb->xsize * p0->y;
+	cur_y = p0->y;
 
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
@@ -121,8 +126,10 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 		// we draw all the scan line of the part
 		while (nb_lines > 0) {
 			nb_lines--;
+			if (cur_y >= zb->clip_ymax)
+				return;
 			// generic draw line
-			{
+			if (cur_y >= zb->clip_ymin) {
 				register unsigned char *pm;
 				register int n;
 
@@ -156,6 +163,7 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 
 			// screen coordinates
 			pm1 = pm1 + zb->xsize;
+			cur_y++;
 		}
 	}
 }
@@ -170,7 +178,7 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 	PIXEL *pp1;
 	int part, update_left, update_right;
 
-	int nb_lines, dx1, dy1, tmp, dx2, dy2;
+	int nb_lines, dx1, dy1, tmp, dx2, dy2, cur_y;
 
 	int error = 0, derror = 0;
 	int x1 = 0, dxdy_min = 0, dxdy_max = 0;
@@ -196,6 +204,10 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 		p2 = t;
 	}
 
+	// nothing to draw inside the clip band
+	if (p2->y < zb->clip_ymin || p0->y >= zb->clip_ymax)
+		return;
+
 	// we compute dXdx and dXdy for all interpolated values
 
 	fdx1 = (float)(p1->x - p0->x);
@@ -227,6 +239,7 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 	pz2 = zb->zbuf2 + p0->y * zb->xsize;
 
 	color = RGB_TO_PIXEL(zb->shadow_color_r, zb->shadow_color_g, zb->shadow_color_b);
+	cur_y = p0->y;
 
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
@@ -298,8 +311,10 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 
 		while (nb_lines > 0) {
 			nb_lines--;
+			if (cur_y >= zb->clip_ymax)
+				return;
 			// generic draw line
-			{
+			if (cur_y >= zb->clip_ymin && !ZB_spanHidden(zb, cur_y, x1, (x2 >> 16) - x1 + 1, z1, dzdx)) {
 				register PIXEL *pp;
 				register unsigned char *pm;
 				register int n;
@@ -361,6 +376,7 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
 			pm1 += zb->xsize;
+			cur_y++;
 		}
 	}
 }
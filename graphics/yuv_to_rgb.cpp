@@ -87,9 +87,20 @@
 // SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
 
 #include "common/scummsys.h"
+#include "common/mutex.h"
 #include "common/singleton.h"
+#include "common/util.h"
 
 #include "graphics/surface.h"
+#include "graphics/yuv_to_rgb.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define YUV_TO_RGB_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define YUV_TO_RGB_NEON
+#endif
 
 namespace Graphics {
 
@@ -167,6 +178,7 @@ private:
 
 	Graphics::PixelFormat _lastFormat;
 	YUVToRGBLookup *_lookup;
+	Common::Mutex _mutex;	// slices may be converted from several threads
 };
 
 YUVToRGBManager::YUVToRGBManager() {
@@ -178,6 +190,7 @@ YUVToRGBManager::~YUVToRGBManager() {
 }
 
 const YUVToRGBLookup *YUVToRGBManager::getLookup(Graphics::PixelFormat format) {
+	Common::StackLock lock(_mutex);
 	if (_lastFormat == format)
 		return _lookup;
 
@@ -240,21 +253,366 @@ void convertYUV420ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup
 	}
 }
 
+#if defined(YUV_TO_RGB_SSE2) || defined(YUV_TO_RGB_NEON)
+
+// The SIMD kernels work out the chroma terms of the lookup tables rather than
+// looking them up: each term is x * factor / 32768, rounded toward 0, for the
+// chroma value x - 128. These factors give exactly the values of the tables,
+// so that both ways convert to the same pixels.
+enum {
+	kCrRFactor = 45919,	// 0.419 / 0.299
+	kCrGFactor = 23383,	// 0.299 / 0.419, subtracted
+	kCbGFactor = 11285,	// 0.114 / 0.331, subtracted
+	kCbBFactor = 58111	// 0.587 / 0.331
+};
+
+static inline int chromaTerm(int x, int factor, bool negative) {
+	int t = (ABS(x) * 2 * factor) >> 16;
+	return ((x < 0) != negative) ? -t : t;
+}
+
+// Finds whether each component of a 32 bit format takes a whole byte of the
+// pixels, in memory order, and which one
+static bool getBytePositions(const Graphics::PixelFormat &format, int *pos) {
+	int loss[4] = { format.rLoss, format.gLoss, format.bLoss, format.aLoss };
+	int shift[4] = { format.rShift, format.gShift, format.bShift, format.aShift };
+	int used = 0;
+
+	if (format.bytesPerPixel != 4)
+		return false;
+
+	for (int i = 0; i < 3; i++) {
+		if (loss[i] != 0 || (shift[i] & 7))
+			return false;
+		pos[i] = shift[i] >> 3;
+		used |= 1 << pos[i];
+	}
+	if (loss[3] == 8) {
+		// no alpha: the remaining byte is 0
+		pos[3] = 0;
+		while (used & (1 << pos[3]))
+			pos[3]++;
+	} else if (loss[3] == 0 && !(shift[3] & 7)) {
+		pos[3] = shift[3] >> 3;
+	} else {
+		return false;
+	}
+	used |= 1 << pos[3];
+	if (used != 0xF)
+		return false;
+
+#ifdef SCUMM_BIG_ENDIAN
+	for (int i = 0; i < 4; i++)
+		pos[i] = 3 - pos[i];
+#endif
+	return true;
+}
+
+// Converts the pixels from w on of two rows sharing their chroma values
+template<typename PixelInt>
+static void convertPairC(byte *dstPtr, int dstPitch, const Graphics::PixelFormat &format, const byte *ySrc, int yPitch, const byte *uSrc, const byte *vSrc, int w, int yWidth) {
+	for (; w < yWidth; w += 2) {
+		int u = uSrc[w >> 1] - 128;
+		int v = vSrc[w >> 1] - 128;
+		int cr_r  = chromaTerm(v, kCrRFactor, false);
+		int crb_g = chromaTerm(v, kCrGFactor, true) + chromaTerm(u, kCbGFactor, true);
+		int cb_b  = chromaTerm(u, kCbBFactor, false);
+
+		for (int i = 0; i < 4; i++) {
+			int y = ySrc[(i >> 1) * yPitch + w + (i & 1)];
+			byte *d = dstPtr + (i >> 1) * dstPitch + (w + (i & 1)) * sizeof(PixelInt);
+			*((PixelInt *)d) = format.RGBToColor(CLIP(y + cr_r, 0, 255), CLIP(y + crb_g, 0, 255), CLIP(y + cb_b, 0, 255));
+		}
+	}
+}
+
+#endif
+
+#ifdef YUV_TO_RGB_SSE2
+
+struct YUVToRGBShifts {
+	__m128i rLoss, rShift, gLoss, gShift, bLoss, bShift;
+	__m128i alpha16, alpha32;
+	int bytePos[4];	// of r, g, b and alpha in the pixels, if byteAligned
+	bool byteAligned;
+	__m128i alphaBytes;
+
+	YUVToRGBShifts(const Graphics::PixelFormat &format) {
+		byteAligned = getBytePositions(format, bytePos);
+		alphaBytes = _mm_set1_epi8(format.aLoss == 8 ? 0 : (char)0xFF);
+		rLoss = _mm_cvtsi32_si128(format.rLoss);
+		rShift = _mm_cvtsi32_si128(format.rShift);
+		gLoss = _mm_cvtsi32_si128(format.gLoss);
+		gShift = _mm_cvtsi32_si128(format.gShift);
+		bLoss = _mm_cvtsi32_si128(format.bLoss);
+		bShift = _mm_cvtsi32_si128(format.bShift);
+		alpha16 = _mm_set1_epi16((short)format.ARGBToColor(0xFF, 0, 0, 0));
+		alpha32 = _mm_set1_epi32(format.ARGBToColor(0xFF, 0, 0, 0));
+	}
+};
+
+static inline __m128i chromaTerms(__m128i x, int factor, bool negative) {
+	__m128i m = _mm_srai_epi16(x, 15);
+	__m128i t = _mm_sub_epi16(_mm_xor_si128(x, m), m);
+	t = _mm_mulhi_epu16(_mm_slli_epi16(t, 1), _mm_set1_epi16((short)factor));
+	if (negative)
+		m = _mm_xor_si128(m, _mm_set1_epi16(-1));
+	return _mm_sub_epi16(_mm_xor_si128(t, m), m);
+}
+
+static inline void storePixels(uint16 *dst, __m128i r, __m128i g, __m128i b, const YUVToRGBShifts &s) {
+	__m128i zero = _mm_setzero_si128();
+	for (int i = 0; i < 2; i++) {
+		__m128i r16 = i ? _mm_unpackhi_epi8(r, zero) : _mm_unpacklo_epi8(r, zero);
+		__m128i g16 = i ? _mm_unpackhi_epi8(g, zero) : _mm_unpacklo_epi8(g, zero);
+		__m128i b16 = i ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+		__m128i p = _mm_or_si128(s.alpha16, _mm_sll_epi16(_mm_srl_epi16(r16, s.rLoss), s.rShift));
+		p = _mm_or_si128(p, _mm_sll_epi16(_mm_srl_epi16(g16, s.gLoss), s.gShift));
+		p = _mm_or_si128(p, _mm_sll_epi16(_mm_srl_epi16(b16, s.bLoss), s.bShift));
+		_mm_storeu_si128((__m128i *)(dst + i * 8), p);
+	}
+}
+
+static inline void storePixels(uint32 *dst, __m128i r, __m128i g, __m128i b, const YUVToRGBShifts &s) {
+	__m128i zero = _mm_setzero_si128();
+
+	if (s.byteAligned) {
+		// interleave the bytes of the components
+		__m128i c[4];
+		c[s.bytePos[0]] = r;
+		c[s.bytePos[1]] = g;
+		c[s.bytePos[2]] = b;
+		c[s.bytePos[3]] = s.alphaBytes;
+		__m128i lo01 = _mm_unpacklo_epi8(c[0], c[1]), hi01 = _mm_unpackhi_epi8(c[0], c[1]);
+		__m128i lo23 = _mm_unpacklo_epi8(c[2], c[3]), hi23 = _mm_unpackhi_epi8(c[2], c[3]);
+		_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(lo01, lo23));
+		_mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(lo01, lo23));
+		_mm_storeu_si128((__m128i *)(dst + 8), _mm_unpacklo_epi16(hi01, hi23));
+		_mm_storeu_si128((__m128i *)(dst + 12), _mm_unpackhi_epi16(hi01, hi23));
+		return;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		__m128i r32 = (i & 2) ? _mm_unpackhi_epi8(r, zero) : _mm_unpacklo_epi8(r, zero);
+		__m128i g32 = (i & 2) ? _mm_unpackhi_epi8(g, zero) : _mm_unpacklo_epi8(g, zero);
+		__m128i b32 = (i & 2) ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+		r32 = (i & 1) ? _mm_unpackhi_epi16(r32, zero) : _mm_unpacklo_epi16(r32, zero);
+		g32 = (i & 1) ? _mm_unpackhi_epi16(g32, zero) : _mm_unpacklo_epi16(g32, zero);
+		b32 = (i & 1) ? _mm_unpackhi_epi16(b32, zero) : _mm_unpacklo_epi16(b32, zero);
+		__m128i p = _mm_or_si128(s.alpha32, _mm_sll_epi32(_mm_srl_epi32(r32, s.rLoss), s.rShift));
+		p = _mm_or_si128(p, _mm_sll_epi32(_mm_srl_epi32(g32, s.gLoss), s.gShift));
+		p = _mm_or_si128(p, _mm_sll_epi32(_mm_srl_epi32(b32, s.bLoss), s.bShift));
+		_mm_storeu_si128((__m128i *)(dst + i * 4), p);
+	}
+}
+
+// Converts 16 pixels at a time of two rows sharing their chroma values, and
+// returns the number of pixels converted
+template<typename PixelInt>
+static int convertPairSIMD(byte *dstPtr, int dstPitch, const YUVToRGBShifts &shifts, const byte *ySrc, int yPitch, const byte *uSrc, const byte *vSrc, int yWidth) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	int w;
+
+	for (w = 0; w + 16 <= yWidth; w += 16) {
+		__m128i u = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(uSrc + (w >> 1))), zero), bias);
+		__m128i v = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(vSrc + (w >> 1))), zero), bias);
+		__m128i cr_r  = chromaTerms(v, kCrRFactor, false);
+		__m128i crb_g = _mm_add_epi16(chromaTerms(v, kCrGFactor, true), chromaTerms(u, kCbGFactor, true));
+		__m128i cb_b  = chromaTerms(u, kCbBFactor, false);
+
+		// each chroma value goes with two pixels of each row
+		__m128i rLo = _mm_unpacklo_epi16(cr_r, cr_r), rHi = _mm_unpackhi_epi16(cr_r, cr_r);
+		__m128i gLo = _mm_unpacklo_epi16(crb_g, crb_g), gHi = _mm_unpackhi_epi16(crb_g, crb_g);
+		__m128i bLo = _mm_unpacklo_epi16(cb_b, cb_b), bHi = _mm_unpackhi_epi16(cb_b, cb_b);
+
+		for (int row = 0; row < 2; row++) {
+			__m128i y = _mm_loadu_si128((const __m128i *)(ySrc + row * yPitch + w));
+			__m128i yLo = _mm_unpacklo_epi8(y, zero);
+			__m128i yHi = _mm_unpackhi_epi8(y, zero);
+
+			// the saturation clips the components as the tables do
+			__m128i r = _mm_packus_epi16(_mm_add_epi16(yLo, rLo), _mm_add_epi16(yHi, rHi));
+			__m128i g = _mm_packus_epi16(_mm_add_epi16(yLo, gLo), _mm_add_epi16(yHi, gHi));
+			__m128i b = _mm_packus_epi16(_mm_add_epi16(yLo, bLo), _mm_add_epi16(yHi, bHi));
+			storePixels((PixelInt *)(dstPtr + row * dstPitch) + w, r, g, b, shifts);
+		}
+	}
+
+	return w;
+}
+
+#endif // YUV_TO_RGB_SSE2
+
+#ifdef YUV_TO_RGB_NEON
+
+struct YUVToRGBShifts {
+	int16x8_t rLoss16, rShift16, gLoss16, gShift16, bLoss16, bShift16;
+	int32x4_t rLoss32, rShift32, gLoss32, gShift32, bLoss32, bShift32;
+	uint16x8_t alpha16;
+	uint32x4_t alpha32;
+	int bytePos[4];	// of r, g, b and alpha in the pixels, if byteAligned
+	bool byteAligned;
+	uint8x16_t alphaBytes;
+
+	// the losses are negative shifts, which shift to the right
+	YUVToRGBShifts(const Graphics::PixelFormat &format) {
+		byteAligned = getBytePositions(format, bytePos);
+		alphaBytes = vdupq_n_u8(format.aLoss == 8 ? 0 : 0xFF);
+		rLoss16 = vdupq_n_s16(-format.rLoss);
+		rShift16 = vdupq_n_s16(format.rShift);
+		gLoss16 = vdupq_n_s16(-format.gLoss);
+		gShift16 = vdupq_n_s16(format.gShift);
+		bLoss16 = vdupq_n_s16(-format.bLoss);
+		bShift16 = vdupq_n_s16(format.bShift);
+		rLoss32 = vdupq_n_s32(-format.rLoss);
+		rShift32 = vdupq_n_s32(format.rShift);
+		gLoss32 = vdupq_n_s32(-format.gLoss);
+		gShift32 = vdupq_n_s32(format.gShift);
+		bLoss32 = vdupq_n_s32(-format.bLoss);
+		bShift32 = vdupq_n_s32(format.bShift);
+		alpha16 = vdupq_n_u16((uint16)format.ARGBToColor(0xFF, 0, 0, 0));
+		alpha32 = vdupq_n_u32(format.ARGBToColor(0xFF, 0, 0, 0));
+	}
+};
+
+static inline int16x8_t chromaTerms(int16x8_t x, int factor, bool negative) {
+	uint16x8_t ax = vreinterpretq_u16_s16(vshlq_n_s16(vabsq_s16(x), 1));
+	uint16x4_t f = vdup_n_u16((uint16)factor);
+	uint16x8_t t = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(ax), f), 16),
+	                            vshrn_n_u32(vmull_u16(vget_high_u16(ax), f), 16));
+	uint16x8_t neg = vcltq_s16(x, vdupq_n_s16(0));
+	if (negative)
+		neg = vmvnq_u16(neg);
+	return vbslq_s16(neg, vnegq_s16(vreinterpretq_s16_u16(t)), vreinterpretq_s16_u16(t));
+}
+
+static inline void storePixels(uint16 *dst, uint8x16_t r, uint8x16_t g, uint8x16_t b, const YUVToRGBShifts &s) {
+	for (int i = 0; i < 2; i++) {
+		uint16x8_t r16 = vmovl_u8(i ? vget_high_u8(r) : vget_low_u8(r));
+		uint16x8_t g16 = vmovl_u8(i ? vget_high_u8(g) : vget_low_u8(g));
+		uint16x8_t b16 = vmovl_u8(i ? vget_high_u8(b) : vget_low_u8(b));
+		uint16x8_t p = vorrq_u16(s.alpha16, vshlq_u16(vshlq_u16(r16, s.rLoss16), s.rShift16));
+		p = vorrq_u16(p, vshlq_u16(vshlq_u16(g16, s.gLoss16), s.gShift16));
+		p = vorrq_u16(p, vshlq_u16(vshlq_u16(b16, s.bLoss16), s.bShift16));
+		vst1q_u16(dst + i * 8, p);
+	}
+}
+
+static inline void storePixels(uint32 *dst, uint8x16_t r, uint8x16_t g, uint8x16_t b, const YUVToRGBShifts &s) {
+	if (s.byteAligned) {
+		// interleave the bytes of the components
+		uint8x16x4_t c;
+		c.val[s.bytePos[0]] = r;
+		c.val[s.bytePos[1]] = g;
+		c.val[s.bytePos[2]] = b;
+		c.val[s.bytePos[3]] = s.alphaBytes;
+		vst4q_u8((uint8 *)dst, c);
+		return;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		uint16x8_t r16 = vmovl_u8((i & 2) ? vget_high_u8(r) : vget_low_u8(r));
+		uint16x8_t g16 = vmovl_u8((i & 2) ? vget_high_u8(g) : vget_low_u8(g));
+		uint16x8_t b16 = vmovl_u8((i & 2) ? vget_high_u8(b) : vget_low_u8(b));
+		uint32x4_t r32 = vmovl_u16((i & 1) ? vget_high_u16(r16) : vget_low_u16(r16));
+		uint32x4_t g32 = vmovl_u16((i & 1) ? vget_high_u16(g16) : vget_low_u16(g16));
+		uint32x4_t b32 = vmovl_u16((i & 1) ? vget_high_u16(b16) : vget_low_u16(b16));
+		uint32x4_t p = vorrq_u32(s.alpha32, vshlq_u32(vshlq_u32(r32, s.rLoss32), s.rShift32));
+		p = vorrq_u32(p, vshlq_u32(vshlq_u32(g32, s.gLoss32), s.gShift32));
+		p = vorrq_u32(p, vshlq_u32(vshlq_u32(b32, s.bLoss32), s.bShift32));
+		vst1q_u32(dst + i * 4, p);
+	}
+}
+
+// Converts 16 pixels at a time of two rows sharing their chroma values, and
+// returns the number of pixels converted
+template<typename PixelInt>
+static int convertPairSIMD(byte *dstPtr, int dstPitch, const YUVToRGBShifts &shifts, const byte *ySrc, int yPitch, const byte *uSrc, const byte *vSrc, int yWidth) {
+	const int16x8_t bias = vdupq_n_s16(128);
+	int w;
+
+	for (w = 0; w + 16 <= yWidth; w += 16) {
+		int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(uSrc + (w >> 1)))), bias);
+		int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(vSrc + (w >> 1)))), bias);
+		int16x8_t cr_r  = chromaTerms(v, kCrRFactor, false);
+		int16x8_t crb_g = vaddq_s16(chromaTerms(v, kCrGFactor, true), chromaTerms(u, kCbGFactor, true));
+		int16x8_t cb_b  = chromaTerms(u, kCbBFactor, false);
+
+		// each chroma value goes with two pixels of each row
+		int16x8x2_t rr = vzipq_s16(cr_r, cr_r);
+		int16x8x2_t gg = vzipq_s16(crb_g, crb_g);
+		int16x8x2_t bb = vzipq_s16(cb_b, cb_b);
+
+		for (int row = 0; row < 2; row++) {
+			uint8x16_t y = vld1q_u8(ySrc + row * yPitch + w);
+			int16x8_t yLo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y)));
+			int16x8_t yHi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y)));
+
+			// the saturation clips the components as the tables do
+			uint8x16_t r = vcombine_u8(vqmovun_s16(vaddq_s16(yLo, rr.val[0])), vqmovun_s16(vaddq_s16(yHi, rr.val[1])));
+			uint8x16_t g = vcombine_u8(vqmovun_s16(vaddq_s16(yLo, gg.val[0])), vqmovun_s16(vaddq_s16(yHi, gg.val[1])));
+			uint8x16_t b = vcombine_u8(vqmovun_s16(vaddq_s16(yLo, bb.val[0])), vqmovun_s16(vaddq_s16(yHi, bb.val[1])));
+			storePixels((PixelInt *)(dstPtr + row * dstPitch) + w, r, g, b, shifts);
+		}
+	}
+
+	return w;
+}
+
+#endif // YUV_TO_RGB_NEON
+
+#if defined(YUV_TO_RGB_SSE2) || defined(YUV_TO_RGB_NEON)
+
+template<typename PixelInt>
+static void convertYUV420ToRGBSIMD(byte *dstPtr, int dstPitch, const Graphics::PixelFormat &format, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
+	YUVToRGBShifts shifts(format);
+
+	for (int h = 0; h < yHeight; h += 2) {
+		int w = convertPairSIMD<PixelInt>(dstPtr, dstPitch, shifts, ySrc, yPitch, uSrc, vSrc, yWidth);
+		convertPairC<PixelInt>(dstPtr, dstPitch, format, ySrc, yPitch, uSrc, vSrc, w, yWidth);
+
+		dstPtr += dstPitch << 1;
+		ySrc += yPitch << 1;
+		uSrc += uvPitch;
+		vSrc += uvPitch;
+	}
+}
+
+#endif
+
 void convertYUV420ToRGB(Graphics::Surface *dst, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
+	convertYUV420ToRGBSlice(dst, ySrc, uSrc, vSrc, yWidth, yPitch, uvPitch, 0, yHeight);
+}
+
+void convertYUV420ToRGBSlice(Graphics::Surface *dst, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yPitch, int uvPitch, int yStart, int yEnd) {
 	// Sanity checks
 	assert(dst && dst->pixels);
 	assert(dst->format.bytesPerPixel == 2 || dst->format.bytesPerPixel == 4);
 	assert(ySrc && uSrc && vSrc);
 	assert((yWidth & 1) == 0);
-	assert((yHeight & 1) == 0);
+	assert((yStart & 1) == 0 && (yEnd & 1) == 0);
+
+	byte *dstPtr = (byte *)dst->getBasePtr(0, yStart);
+	ySrc += yStart * yPitch;
+	uSrc += (yStart >> 1) * uvPitch;
+	vSrc += (yStart >> 1) * uvPitch;
+	int yHeight = yEnd - yStart;
 
+#if defined(YUV_TO_RGB_SSE2) || defined(YUV_TO_RGB_NEON)
+	if (dst->format.bytesPerPixel == 2)
+		convertYUV420ToRGBSIMD<uint16>(dstPtr, dst->pitch, dst->format, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+	else
+		convertYUV420ToRGBSIMD<uint32>(dstPtr, dst->pitch, dst->format, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+#else
 	const YUVToRGBLookup *lookup = YUVToRGBMan.getLookup(dst->format);
 
 	// Use a templated function to avoid an if check on every pixel
 	if (dst->format.bytesPerPixel == 2)
-		convertYUV420ToRGB<uint16>((byte *)dst->pixels, dst->pitch, lookup, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+		convertYUV420ToRGB<uint16>(dstPtr, dst->pitch, lookup, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
 	else
-		convertYUV420ToRGB<uint32>((byte *)dst->pixels, dst->pitch, lookup, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+		convertYUV420ToRGB<uint32>(dstPtr, dst->pitch, lookup, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+#endif
 }
 
 } // End of namespace Graphics
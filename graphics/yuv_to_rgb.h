@@ -54,6 +54,23 @@ struct Surface;
  */
 void convertYUV420ToRGB(Graphics::Surface *dst, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch);
 
+/**
+ * Convert the rows yStart to yEnd - 1 of a YUV420 image to the same rows of an
+ * RGB surface. Several slices of an image can be converted at the same time by
+ * different threads.
+ *
+ * @param dst     the destination surface
+ * @param ySrc    the source of the y component
+ * @param uSrc    the source of the u component
+ * @param vSrc    the source of the v component
+ * @param yWidth  the width of the y surface (must be divisible by 2)
+ * @param yPitch  the pitch of the y surface
+ * @param uvPitch the pitch of the u and v surfaces
+ * @param yStart  the first row of the slice (must be divisible by 2)
+ * @param yEnd    the row after the slice (must be divisible by 2)
+ */
+void convertYUV420ToRGBSlice(Graphics::Surface *dst, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yPitch, int uvPitch, int yStart, int yEnd);
+
 } // End of namespace Graphics
 
 #endif
@@ -37,6 +37,7 @@
 #include "common/rdft.h"
 #include "common/dct.h"
 #include "common/system.h"
+#include "common/thread.h"
 
 #include "graphics/yuv_to_rgb.h"
 #include "graphics/surface.h"
@@ -44,6 +45,14 @@
 #include "video/binkdata.h"
 #include "video/bink_decoder.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BINK_IDCT_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BINK_IDCT_NEON
+#endif
+
 static const uint32 kBIKfID = MKTAG('B', 'I', 'K', 'f');
 static const uint32 kBIKgID = MKTAG('B', 'I', 'K', 'g');
 static const uint32 kBIKhID = MKTAG('B', 'I', 'K', 'h');
@@ -100,23 +109,36 @@ BinkDecoder::BinkDecoder() {
 		_bundles[i].curPtr   = 0;
 	}
 
-	for (int i = 0; i < 16; i++) {
-		_colHighHuffman[i].index = 0;
-		for (int j = 0; j < 16; j++)
-			_colHighHuffman[i].symbols[j] = j;
-	}
-
 	for (int i = 0; i < 4; i++) {
 		_curPlanes[i] = 0;
 		_oldPlanes[i] = 0;
 	}
 
+	_threadPool = 0;
+
 	_audioStream = 0;
 	_audioStarted = false;
 }
 
 BinkDecoder::~BinkDecoder() {
 	close();
+
+	delete _threadPool;
+}
+
+void BinkDecoder::setThreadCount(int numThreads) {
+	delete _threadPool;
+	_threadPool = 0;
+
+	if (numThreads <= 1)
+		return;
+
+	_threadPool = new Common::WorkerPool(numThreads - 1);
+	if (_threadPool->getNumThreads() == 0) {
+		// no thread support
+		delete _threadPool;
+		_threadPool = 0;
+	}
 }
 
 void BinkDecoder::close() {
@@ -129,6 +151,7 @@ void BinkDecoder::close() {
 	}
 
 	_audioStarted = false;
+	_packet.clear();
 
 	for (int i = 0; i < 4; i++) {
 		delete[] _curPlanes[i]; _curPlanes[i] = 0;
@@ -160,12 +183,6 @@ void BinkDecoder::close() {
 		_bundles[i].curPtr   = 0;
 	}
 
-	for (int i = 0; i < 16; i++) {
-		_colHighHuffman[i].index = 0;
-		for (int j = 0; j < 16; j++)
-			_colHighHuffman[i].symbols[j] = j;
-	}
-
 	_audioTracks.clear();
 	_frames.clear();
 }
@@ -205,7 +222,7 @@ const Graphics::Surface *BinkDecoder::decodeNextFrame() {
 				//                  Number of samples in bytes
 				audio.sampleCount = _bink->readUint32LE() / (2 * audio.channels);
 
-				audio.bits = new Common::BitStream32LE(*_bink, (audioPacketLength - 4) * 8);
+				audio.bits = new Common::BitReaderLE(readPacket(audioPacketLength - 4), (audioPacketLength - 4) * 8);
 
 				audioPacket(audio);
 
@@ -220,7 +237,7 @@ const Graphics::Surface *BinkDecoder::decodeNextFrame() {
 		}
 	}
 
-	frame.bits = new Common::BitStream32LE(*_bink, frameSize * 8);
+	frame.bits = new Common::BitReaderLE(readPacket(frameSize), frameSize * 8);
 
 	videoPacket(frame);
 
@@ -239,6 +256,14 @@ const Graphics::Surface *BinkDecoder::decodeNextFrame() {
 	return &_surface;
 }
 
+const byte *BinkDecoder::readPacket(uint32 size) {
+	if (size > _packet.size())
+		_packet.resize(size);
+	if (_bink->read(_packet.begin(), size) != size)
+		error("Bad Bink packet size");
+	return _packet.begin();
+}
+
 void BinkDecoder::audioPacket(AudioTrack &audio) {
 	if (!_audioStream)
 		return;
@@ -272,7 +297,7 @@ void BinkDecoder::videoPacket(VideoFrame &video) {
 		if (_id == kBIKiID)
 			video.bits->skip(32);
 
-		decodePlane(video, 3, false);
+		decodePlane(video.bits, 3, false);
 	}
 
 	if (_id == kBIKiID)
@@ -281,7 +306,7 @@ void BinkDecoder::videoPacket(VideoFrame &video) {
 	for (int i = 0; i < 3; i++) {
 		int planeIdx = ((i == 0) || !_swapPlanes) ? i : (i ^ 3);
 
-		decodePlane(video, planeIdx, i != 0);
+		decodePlane(video.bits, planeIdx, i != 0);
 
 		if (video.bits->pos() >= video.bits->size())
 			break;
@@ -290,15 +315,40 @@ void BinkDecoder::videoPacket(VideoFrame &video) {
 	// Convert the YUV data we have to our format
 	// We're ignoring alpha for now
 	assert(_curPlanes[0] && _curPlanes[1] && _curPlanes[2]);
-	Graphics::convertYUV420ToRGB(&_surface, _curPlanes[0], _curPlanes[1], _curPlanes[2],
-			_surface.w, _surface.h, _surface.w, _surface.w >> 1);
+	convertPlanes();
 
 	// And swap the planes with the reference planes
 	for (int i = 0; i < 4; i++)
 		SWAP(_curPlanes[i], _oldPlanes[i]);
 }
 
-void BinkDecoder::decodePlane(VideoFrame &video, int planeIdx, bool isChroma) {
+void BinkDecoder::convertPlanes() {
+	if (!_threadPool) {
+		Graphics::convertYUV420ToRGB(&_surface, _curPlanes[0], _curPlanes[1], _curPlanes[2],
+				_surface.w, _surface.h, _surface.w, _surface.w >> 1);
+		return;
+	}
+
+	_threadPool->run(convertSlice, this, _threadPool->getNumThreads() + 1);
+}
+
+void BinkDecoder::convertSlice(void *param, int slice) {
+	BinkDecoder *bink = (BinkDecoder *)param;
+	Graphics::Surface &surface = bink->_surface;
+
+	// Slices of an even number of rows, the chroma planes having half as many
+	int slices = bink->_threadPool->getNumThreads() + 1;
+	int rows = ((surface.h + slices - 1) / slices + 1) & ~1;
+	int yStart = MIN<int>(slice * rows, surface.h);
+	int yEnd = MIN<int>(yStart + rows, surface.h);
+	if (yStart == yEnd)
+		return;
+
+	Graphics::convertYUV420ToRGBSlice(&surface, bink->_curPlanes[0], bink->_curPlanes[1], bink->_curPlanes[2],
+			surface.w, surface.w, surface.w >> 1, yStart, yEnd);
+}
+
+void BinkDecoder::decodePlane(Common::BitReaderLE *bits, int planeIdx, bool isChroma) {
 
 	uint32 blockWidth  = isChroma ? ((_surface.w  + 15) >> 4) : ((_surface.w  + 7) >> 3);
 	uint32 blockHeight = isChroma ? ((_surface.h + 15) >> 4) : ((_surface.h + 7) >> 3);
@@ -307,7 +357,8 @@ void BinkDecoder::decodePlane(VideoFrame &video, int planeIdx, bool isChroma) {
 
 	DecodeContext ctx;
 
-	ctx.video     = &video;
+	ctx.bits      = bits;
+	ctx.bundles   = _bundles;
 	ctx.planeIdx  = planeIdx;
 	ctx.destStart = _curPlanes[planeIdx];
 	ctx.destEnd   = _curPlanes[planeIdx] + width * height;
@@ -327,25 +378,25 @@ void BinkDecoder::decodePlane(VideoFrame &video, int planeIdx, bool isChroma) {
 	for (int i = 0; i < kSourceMAX; i++) {
 		_bundles[i].countLength = _bundles[i].countLengths[isChroma ? 1 : 0];
 
-		readBundle(video, (Source) i);
+		readBundle(ctx, (Source) i);
 	}
 
 	for (ctx.blockY = 0; ctx.blockY < blockHeight; ctx.blockY++) {
-		readBlockTypes  (video, _bundles[kSourceBlockTypes]);
-		readBlockTypes  (video, _bundles[kSourceSubBlockTypes]);
-		readColors      (video, _bundles[kSourceColors]);
-		readPatterns    (video, _bundles[kSourcePattern]);
-		readMotionValues(video, _bundles[kSourceXOff]);
-		readMotionValues(video, _bundles[kSourceYOff]);
-		readDCS         (video, _bundles[kSourceIntraDC], kDCStartBits, false);
-		readDCS         (video, _bundles[kSourceInterDC], kDCStartBits, true);
-		readRuns        (video, _bundles[kSourceRun]);
+		readBlockTypes  (ctx, _bundles[kSourceBlockTypes]);
+		readBlockTypes  (ctx, _bundles[kSourceSubBlockTypes]);
+		readColors      (ctx, _bundles[kSourceColors]);
+		readPatterns    (ctx, _bundles[kSourcePattern]);
+		readMotionValues(ctx, _bundles[kSourceXOff]);
+		readMotionValues(ctx, _bundles[kSourceYOff]);
+		readDCS         (ctx, _bundles[kSourceIntraDC], kDCStartBits, false);
+		readDCS         (ctx, _bundles[kSourceInterDC], kDCStartBits, true);
+		readRuns        (ctx, _bundles[kSourceRun]);
 
 		ctx.dest = ctx.destStart + 8 * ctx.blockY * ctx.pitch;
 		ctx.prev = ctx.prevStart + 8 * ctx.blockY * ctx.pitch;
 
 		for (ctx.blockX = 0; ctx.blockX < blockWidth; ctx.blockX++, ctx.dest += 8, ctx.prev += 8) {
-			BlockType blockType = (BlockType) getBundleValue(kSourceBlockTypes);
+			BlockType blockType = (BlockType) getBundleValue(ctx, kSourceBlockTypes);
 
 			// 16x16 block type on odd line means part of the already decoded block, so skip it
 			if ((ctx.blockY & 1) && (blockType == kBlockScaled)) {
@@ -404,28 +455,28 @@ void BinkDecoder::decodePlane(VideoFrame &video, int planeIdx, bool isChroma) {
 
 	}
 
-	if (video.bits->pos() & 0x1F) // next plane data starts at 32-bit boundary
-		video.bits->skip(32 - (video.bits->pos() & 0x1F));
+	if (ctx.bits->pos() & 0x1F) // next plane data starts at 32-bit boundary
+		ctx.bits->skip(32 - (ctx.bits->pos() & 0x1F));
 
 }
 
-void BinkDecoder::readBundle(VideoFrame &video, Source source) {
+void BinkDecoder::readBundle(DecodeContext &ctx, Source source) {
 	if (source == kSourceColors) {
 		for (int i = 0; i < 16; i++)
-			readHuffman(video, _colHighHuffman[i]);
+			readHuffman(ctx, ctx.colHighHuffman[i]);
 
-		_colLastVal = 0;
+		ctx.colLastVal = 0;
 	}
 
 	if ((source != kSourceIntraDC) && (source != kSourceInterDC))
-		readHuffman(video, _bundles[source].huffman);
+		readHuffman(ctx, ctx.bundles[source].huffman);
 
-	_bundles[source].curDec = _bundles[source].data;
-	_bundles[source].curPtr = _bundles[source].data;
+	ctx.bundles[source].curDec = ctx.bundles[source].data;
+	ctx.bundles[source].curPtr = ctx.bundles[source].data;
 }
 
-void BinkDecoder::readHuffman(VideoFrame &video, Huffman &huffman) {
-	huffman.index = video.bits->getBits(4);
+void BinkDecoder::readHuffman(DecodeContext &ctx, Huffman &huffman) {
+	huffman.index = ctx.bits->getBits(4);
 
 	if (huffman.index == 0) {
 		// The first tree always gives raw nibbles
@@ -438,14 +489,14 @@ void BinkDecoder::readHuffman(VideoFrame &video, Huffman &huffman) {
 
 	byte hasSymbol[16];
 
-	if (video.bits->getBit()) {
+	if (ctx.bits->getBit()) {
 		// Symbol selection
 
 		memset(hasSymbol, 0, 16);
 
-		uint8 length = video.bits->getBits(3);
+		uint8 length = ctx.bits->getBits(3);
 		for (int i = 0; i <= length; i++) {
-			huffman.symbols[i] = video.bits->getBits(4);
+			huffman.symbols[i] = ctx.bits->getBits(4);
 			hasSymbol[huffman.symbols[i]] = 1;
 		}
 
@@ -461,7 +512,7 @@ void BinkDecoder::readHuffman(VideoFrame &video, Huffman &huffman) {
 	byte tmp1[16], tmp2[16];
 	byte *in = tmp1, *out = tmp2;
 
-	uint8 depth = video.bits->getBits(2);
+	uint8 depth = ctx.bits->getBits(2);
 
 	for (int i = 0; i < 16; i++)
 		in[i] = i;
@@ -470,7 +521,7 @@ void BinkDecoder::readHuffman(VideoFrame &video, Huffman &huffman) {
 		int size = 1 << i;
 
 		for (int j = 0; j < 16; j += (size << 1))
-			mergeHuffmanSymbols(video, out + j, in + j, size);
+			mergeHuffmanSymbols(ctx, out + j, in + j, size);
 
 		SWAP(in, out);
 	}
@@ -478,12 +529,12 @@ void BinkDecoder::readHuffman(VideoFrame &video, Huffman &huffman) {
 	memcpy(huffman.symbols, in, 16);
 }
 
-void BinkDecoder::mergeHuffmanSymbols(VideoFrame &video, byte *dst, const byte *src, int size) {
+void BinkDecoder::mergeHuffmanSymbols(DecodeContext &ctx, byte *dst, const byte *src, int size) {
 	const byte *src2  = src + size;
 	int         size2 = size;
 
 	do {
-		if (!video.bits->getBit()) {
+		if (!ctx.bits->getBit()) {
 			*dst++ = *src++;
 			size--;
 		} else {
@@ -714,38 +765,40 @@ void BinkDecoder::initBundles() {
 }
 
 void BinkDecoder::deinitBundles() {
-	for (int i = 0; i < kSourceMAX; i++)
+	for (int i = 0; i < kSourceMAX; i++) {
 		delete[] _bundles[i].data;
+		_bundles[i].data = 0;
+	}
 }
 
 void BinkDecoder::initHuffman() {
 	for (int i = 0; i < 16; i++)
-		_huffman[i] = new Common::Huffman(binkHuffmanLengths[i][15], 16, binkHuffmanCodes[i], binkHuffmanLengths[i]);
+		_huffman[i] = new Common::Huffman(binkHuffmanLengths[i][15], 16, binkHuffmanCodes[i], binkHuffmanLengths[i], 0, true);
 }
 
-byte BinkDecoder::getHuffmanSymbol(VideoFrame &video, Huffman &huffman) {
-	return huffman.symbols[_huffman[huffman.index]->getSymbol(*video.bits)];
+byte BinkDecoder::getHuffmanSymbol(DecodeContext &ctx, Huffman &huffman) {
+	return huffman.symbols[_huffman[huffman.index]->getSymbol(*ctx.bits)];
 }
 
-int32 BinkDecoder::getBundleValue(Source source) {
+int32 BinkDecoder::getBundleValue(DecodeContext &ctx, Source source) {
 	if ((source < kSourceXOff) || (source == kSourceRun))
-		return *_bundles[source].curPtr++;
+		return *ctx.bundles[source].curPtr++;
 
 	if ((source == kSourceXOff) || (source == kSourceYOff))
-		return (int8) *_bundles[source].curPtr++;
+		return (int8) *ctx.bundles[source].curPtr++;
 
-	int16 ret = *((int16 *) _bundles[source].curPtr);
+	int16 ret = *((int16 *) ctx.bundles[source].curPtr);
 
-	_bundles[source].curPtr += 2;
+	ctx.bundles[source].curPtr += 2;
 
 	return ret;
 }
 
-uint32 BinkDecoder::readBundleCount(VideoFrame &video, Bundle &bundle) {
+uint32 BinkDecoder::readBundleCount(DecodeContext &ctx, Bundle &bundle) {
 	if (!bundle.curDec || (bundle.curDec > bundle.curPtr))
 		return 0;
 
-	uint32 n = video.bits->getBits(bundle.countLength);
+	uint32 n = ctx.bits->getBits(bundle.countLength);
 	if (n == 0)
 		bundle.curDec = 0;
 
@@ -769,19 +822,19 @@ void BinkDecoder::blockScaledSkip(DecodeContext &ctx) {
 }
 
 void BinkDecoder::blockScaledRun(DecodeContext &ctx) {
-	const uint8 *scan = binkPatterns[ctx.video->bits->getBits(4)];
+	const uint8 *scan = binkPatterns[ctx.bits->getBits(4)];
 
 	int i = 0;
 	do {
-		int run = getBundleValue(kSourceRun) + 1;
+		int run = getBundleValue(ctx, kSourceRun) + 1;
 
 		i += run;
 		if (i > 64)
 			error("Run went out of bounds");
 
-		if (ctx.video->bits->getBit()) {
+		if (ctx.bits->getBit()) {
 
-			byte v = getBundleValue(kSourceColors);
+			byte v = getBundleValue(ctx, kSourceColors);
 			for (int j = 0; j < run; j++, scan++)
 				ctx.dest[ctx.coordScaledMap1[*scan]] =
 				ctx.dest[ctx.coordScaledMap2[*scan]] =
@@ -793,7 +846,7 @@ void BinkDecoder::blockScaledRun(DecodeContext &ctx) {
 				ctx.dest[ctx.coordScaledMap1[*scan]] =
 				ctx.dest[ctx.coordScaledMap2[*scan]] =
 				ctx.dest[ctx.coordScaledMap3[*scan]] =
-				ctx.dest[ctx.coordScaledMap4[*scan]] = getBundleValue(kSourceColors);
+				ctx.dest[ctx.coordScaledMap4[*scan]] = getBundleValue(ctx, kSourceColors);
 
 	} while (i < 63);
 
@@ -801,16 +854,16 @@ void BinkDecoder::blockScaledRun(DecodeContext &ctx) {
 		ctx.dest[ctx.coordScaledMap1[*scan]] =
 		ctx.dest[ctx.coordScaledMap2[*scan]] =
 		ctx.dest[ctx.coordScaledMap3[*scan]] =
-		ctx.dest[ctx.coordScaledMap4[*scan]] = getBundleValue(kSourceColors);
+		ctx.dest[ctx.coordScaledMap4[*scan]] = getBundleValue(ctx, kSourceColors);
 }
 
 void BinkDecoder::blockScaledIntra(DecodeContext &ctx) {
 	int16 block[64];
 	memset(block, 0, 64 * sizeof(int16));
 
-	block[0] = getBundleValue(kSourceIntraDC);
+	block[0] = getBundleValue(ctx, kSourceIntraDC);
 
-	readDCTCoeffs(*ctx.video, block, true);
+	readDCTCoeffs(ctx, block, true);
 
 	IDCT(block);
 
@@ -826,7 +879,7 @@ void BinkDecoder::blockScaledIntra(DecodeContext &ctx) {
 }
 
 void BinkDecoder::blockScaledFill(DecodeContext &ctx) {
-	byte v = getBundleValue(kSourceColors);
+	byte v = getBundleValue(ctx, kSourceColors);
 
 	byte *dest = ctx.dest;
 	for (int i = 0; i < 16; i++, dest += ctx.pitch)
@@ -837,12 +890,12 @@ void BinkDecoder::blockScaledPattern(DecodeContext &ctx) {
 	byte col[2];
 
 	for (int i = 0; i < 2; i++)
-		col[i] = getBundleValue(kSourceColors);
+		col[i] = getBundleValue(ctx, kSourceColors);
 
 	byte *dest1 = ctx.dest;
 	byte *dest2 = ctx.dest + ctx.pitch;
 	for (int j = 0; j < 8; j++, dest1 += (ctx.pitch << 1) - 16, dest2 += (ctx.pitch << 1) - 16) {
-		byte v = getBundleValue(kSourcePattern);
+		byte v = getBundleValue(ctx, kSourcePattern);
 
 		for (int i = 0; i < 8; i++, dest1 += 2, dest2 += 2, v >>= 1)
 			dest1[0] = dest1[1] = dest2[0] = dest2[1] = col[v & 1];
@@ -855,17 +908,17 @@ void BinkDecoder::blockScaledRaw(DecodeContext &ctx) {
 	byte *dest1 = ctx.dest;
 	byte *dest2 = ctx.dest + ctx.pitch;
 	for (int j = 0; j < 8; j++, dest1 += (ctx.pitch << 1) - 16, dest2 += (ctx.pitch << 1) - 16) {
-		memcpy(row, _bundles[kSourceColors].curPtr, 8);
+		memcpy(row, ctx.bundles[kSourceColors].curPtr, 8);
 
 		for (int i = 0; i < 8; i++, dest1 += 2, dest2 += 2)
 			dest1[0] = dest1[1] = dest2[0] = dest2[1] = row[i];
 
-		_bundles[kSourceColors].curPtr += 8;
+		ctx.bundles[kSourceColors].curPtr += 8;
 	}
 }
 
 void BinkDecoder::blockScaled(DecodeContext &ctx) {
-	BlockType blockType = (BlockType) getBundleValue(kSourceSubBlockTypes);
+	BlockType blockType = (BlockType) getBundleValue(ctx, kSourceSubBlockTypes);
 
 	switch (blockType) {
 		case kBlockRun:
@@ -898,8 +951,8 @@ void BinkDecoder::blockScaled(DecodeContext &ctx) {
 }
 
 void BinkDecoder::blockMotion(DecodeContext &ctx) {
-	int8 xOff = getBundleValue(kSourceXOff);
-	int8 yOff = getBundleValue(kSourceYOff);
+	int8 xOff = getBundleValue(ctx, kSourceXOff);
+	int8 yOff = getBundleValue(ctx, kSourceYOff);
 
 	byte *dest = ctx.dest;
 	byte *prev = ctx.prev + yOff * ((int32) ctx.pitch) + xOff;
@@ -911,41 +964,41 @@ void BinkDecoder::blockMotion(DecodeContext &ctx) {
 }
 
 void BinkDecoder::blockRun(DecodeContext &ctx) {
-	const uint8 *scan = binkPatterns[ctx.video->bits->getBits(4)];
+	const uint8 *scan = binkPatterns[ctx.bits->getBits(4)];
 
 	int i = 0;
 	do {
-		int run = getBundleValue(kSourceRun) + 1;
+		int run = getBundleValue(ctx, kSourceRun) + 1;
 
 		i += run;
 		if (i > 64)
 			error("Run went out of bounds");
 
-		if (ctx.video->bits->getBit()) {
+		if (ctx.bits->getBit()) {
 
-			byte v = getBundleValue(kSourceColors);
+			byte v = getBundleValue(ctx, kSourceColors);
 			for (int j = 0; j < run; j++)
 				ctx.dest[ctx.coordMap[*scan++]] = v;
 
 		} else
 			for (int j = 0; j < run; j++)
-				ctx.dest[ctx.coordMap[*scan++]] = getBundleValue(kSourceColors);
+				ctx.dest[ctx.coordMap[*scan++]] = getBundleValue(ctx, kSourceColors);
 
 	} while (i < 63);
 
 	if (i == 63)
-		ctx.dest[ctx.coordMap[*scan++]] = getBundleValue(kSourceColors);
+		ctx.dest[ctx.coordMap[*scan++]] = getBundleValue(ctx, kSourceColors);
 }
 
 void BinkDecoder::blockResidue(DecodeContext &ctx) {
 	blockMotion(ctx);
 
-	byte v = ctx.video->bits->getBits(7);
+	byte v = ctx.bits->getBits(7);
 
 	int16 block[64];
 	memset(block, 0, 64 * sizeof(int16));
 
-	readResidue(*ctx.video, block, v);
+	readResidue(ctx, block, v);
 
 	byte  *dst = ctx.dest;
 	int16 *src = block;
@@ -958,15 +1011,15 @@ void BinkDecoder::blockIntra(DecodeContext &ctx) {
 	int16 block[64];
 	memset(block, 0, 64 * sizeof(int16));
 
-	block[0] = getBundleValue(kSourceIntraDC);
+	block[0] = getBundleValue(ctx, kSourceIntraDC);
 
-	readDCTCoeffs(*ctx.video, block, true);
+	readDCTCoeffs(ctx, block, true);
 
 	IDCTPut(ctx, block);
 }
 
 void BinkDecoder::blockFill(DecodeContext &ctx) {
-	byte v = getBundleValue(kSourceColors);
+	byte v = getBundleValue(ctx, kSourceColors);
 
 	byte *dest = ctx.dest;
 	for (int i = 0; i < 8; i++, dest += ctx.pitch)
@@ -979,9 +1032,9 @@ void BinkDecoder::blockInter(DecodeContext &ctx) {
 	int16 block[64];
 	memset(block, 0, 64 * sizeof(int16));
 
-	block[0] = getBundleValue(kSourceInterDC);
+	block[0] = getBundleValue(ctx, kSourceInterDC);
 
-	readDCTCoeffs(*ctx.video, block, false);
+	readDCTCoeffs(ctx, block, false);
 
 	IDCTAdd(ctx, block);
 }
@@ -990,11 +1043,11 @@ void BinkDecoder::blockPattern(DecodeContext &ctx) {
 	byte col[2];
 
 	for (int i = 0; i < 2; i++)
-		col[i] = getBundleValue(kSourceColors);
+		col[i] = getBundleValue(ctx, kSourceColors);
 
 	byte *dest = ctx.dest;
 	for (int i = 0; i < 8; i++, dest += ctx.pitch - 8) {
-		byte v = getBundleValue(kSourcePattern);
+		byte v = getBundleValue(ctx, kSourcePattern);
 
 		for (int j = 0; j < 8; j++, v >>= 1)
 			*dest++ = col[v & 1];
@@ -1003,15 +1056,15 @@ void BinkDecoder::blockPattern(DecodeContext &ctx) {
 
 void BinkDecoder::blockRaw(DecodeContext &ctx) {
 	byte *dest = ctx.dest;
-	byte *data = _bundles[kSourceColors].curPtr;
+	byte *data = ctx.bundles[kSourceColors].curPtr;
 	for (int i = 0; i < 8; i++, dest += ctx.pitch, data += 8)
 		memcpy(dest, data, 8);
 
-	_bundles[kSourceColors].curPtr += 64;
+	ctx.bundles[kSourceColors].curPtr += 64;
 }
 
-void BinkDecoder::readRuns(VideoFrame &video, Bundle &bundle) {
-	uint32 n = readBundleCount(video, bundle);
+void BinkDecoder::readRuns(DecodeContext &ctx, Bundle &bundle) {
+	uint32 n = readBundleCount(ctx, bundle);
 	if (n == 0)
 		return;
 
@@ -1019,19 +1072,19 @@ void BinkDecoder::readRuns(VideoFrame &video, Bundle &bundle) {
 	if (decEnd > bundle.dataEnd)
 		error("Run value went out of bounds");
 
-	if (video.bits->getBit()) {
-		byte v = video.bits->getBits(4);
+	if (ctx.bits->getBit()) {
+		byte v = ctx.bits->getBits(4);
 
 		memset(bundle.curDec, v, n);
 		bundle.curDec += n;
 
 	} else
 		while (bundle.curDec < decEnd)
-			*bundle.curDec++ = getHuffmanSymbol(video, bundle.huffman);
+			*bundle.curDec++ = getHuffmanSymbol(ctx, bundle.huffman);
 }
 
-void BinkDecoder::readMotionValues(VideoFrame &video, Bundle &bundle) {
-	uint32 n = readBundleCount(video, bundle);
+void BinkDecoder::readMotionValues(DecodeContext &ctx, Bundle &bundle) {
+	uint32 n = readBundleCount(ctx, bundle);
 	if (n == 0)
 		return;
 
@@ -1039,11 +1092,11 @@ void BinkDecoder::readMotionValues(VideoFrame &video, Bundle &bundle) {
 	if (decEnd > bundle.dataEnd)
 		error("Too many motion values");
 
-	if (video.bits->getBit()) {
-		byte v = video.bits->getBits(4);
+	if (ctx.bits->getBit()) {
+		byte v = ctx.bits->getBits(4);
 
 		if (v) {
-			int sign = -(int)video.bits->getBit();
+			int sign = -(int)ctx.bits->getBit();
 			v = (v ^ sign) - sign;
 		}
 
@@ -1054,10 +1107,10 @@ void BinkDecoder::readMotionValues(VideoFrame &video, Bundle &bundle) {
 	}
 
 	do {
-		byte v = getHuffmanSymbol(video, bundle.huffman);
+		byte v = getHuffmanSymbol(ctx, bundle.huffman);
 
 		if (v) {
-			int sign = -(int)video.bits->getBit();
+			int sign = -(int)ctx.bits->getBit();
 			v = (v ^ sign) - sign;
 		}
 
@@ -1067,8 +1120,8 @@ void BinkDecoder::readMotionValues(VideoFrame &video, Bundle &bundle) {
 }
 
 const uint8 rleLens[4] = { 4, 8, 12, 32 };
-void BinkDecoder::readBlockTypes(VideoFrame &video, Bundle &bundle) {
-	uint32 n = readBundleCount(video, bundle);
+void BinkDecoder::readBlockTypes(DecodeContext &ctx, Bundle &bundle) {
+	uint32 n = readBundleCount(ctx, bundle);
 	if (n == 0)
 		return;
 
@@ -1076,8 +1129,8 @@ void BinkDecoder::readBlockTypes(VideoFrame &video, Bundle &bundle) {
 	if (decEnd > bundle.dataEnd)
 		error("Too many block type values");
 
-	if (video.bits->getBit()) {
-		byte v = video.bits->getBits(4);
+	if (ctx.bits->getBit()) {
+		byte v = ctx.bits->getBits(4);
 
 		memset(bundle.curDec, v, n);
 
@@ -1088,7 +1141,7 @@ void BinkDecoder::readBlockTypes(VideoFrame &video, Bundle &bundle) {
 	byte last = 0;
 	do {
 
-		byte v = getHuffmanSymbol(video, bundle.huffman);
+		byte v = getHuffmanSymbol(ctx, bundle.huffman);
 
 		if (v < 12) {
 			last = v;
@@ -1104,8 +1157,8 @@ void BinkDecoder::readBlockTypes(VideoFrame &video, Bundle &bundle) {
 	} while (bundle.curDec < decEnd);
 }
 
-void BinkDecoder::readPatterns(VideoFrame &video, Bundle &bundle) {
-	uint32 n = readBundleCount(video, bundle);
+void BinkDecoder::readPatterns(DecodeContext &ctx, Bundle &bundle) {
+	uint32 n = readBundleCount(ctx, bundle);
 	if (n == 0)
 		return;
 
@@ -1115,15 +1168,15 @@ void BinkDecoder::readPatterns(VideoFrame &video, Bundle &bundle) {
 
 	byte v;
 	while (bundle.curDec < decEnd) {
-		v  = getHuffmanSymbol(video, bundle.huffman);
-		v |= getHuffmanSymbol(video, bundle.huffman) << 4;
+		v  = getHuffmanSymbol(ctx, bundle.huffman);
+		v |= getHuffmanSymbol(ctx, bundle.huffman) << 4;
 		*bundle.curDec++ = v;
 	}
 }
 
 
-void BinkDecoder::readColors(VideoFrame &video, Bundle &bundle) {
-	uint32 n = readBundleCount(video, bundle);
+void BinkDecoder::readColors(DecodeContext &ctx, Bundle &bundle) {
+	uint32 n = readBundleCount(ctx, bundle);
 	if (n == 0)
 		return;
 
@@ -1131,12 +1184,12 @@ void BinkDecoder::readColors(VideoFrame &video, Bundle &bundle) {
 	if (decEnd > bundle.dataEnd)
 		error("Too many color values");
 
-	if (video.bits->getBit()) {
-		_colLastVal = getHuffmanSymbol(video, _colHighHuffman[_colLastVal]);
+	if (ctx.bits->getBit()) {
+		ctx.colLastVal = getHuffmanSymbol(ctx, ctx.colHighHuffman[ctx.colLastVal]);
 
 		byte v;
-		v = getHuffmanSymbol(video, bundle.huffman);
-		v = (_colLastVal << 4) | v;
+		v = getHuffmanSymbol(ctx, bundle.huffman);
+		v = (ctx.colLastVal << 4) | v;
 
 		if (_id != kBIKiID) {
 			int sign = ((int8) v) >> 7;
@@ -1151,11 +1204,11 @@ void BinkDecoder::readColors(VideoFrame &video, Bundle &bundle) {
 	}
 
 	while (bundle.curDec < decEnd) {
-		_colLastVal = getHuffmanSymbol(video, _colHighHuffman[_colLastVal]);
+		ctx.colLastVal = getHuffmanSymbol(ctx, ctx.colHighHuffman[ctx.colLastVal]);
 
 		byte v;
-		v = getHuffmanSymbol(video, bundle.huffman);
-		v = (_colLastVal << 4) | v;
+		v = getHuffmanSymbol(ctx, bundle.huffman);
+		v = (ctx.colLastVal << 4) | v;
 
 		if (_id != kBIKiID) {
 			int sign = ((int8) v) >> 7;
@@ -1166,16 +1219,16 @@ void BinkDecoder::readColors(VideoFrame &video, Bundle &bundle) {
 	}
 }
 
-void BinkDecoder::readDCS(VideoFrame &video, Bundle &bundle, int startBits, bool hasSign) {
-	uint32 length = readBundleCount(video, bundle);
+void BinkDecoder::readDCS(DecodeContext &ctx, Bundle &bundle, int startBits, bool hasSign) {
+	uint32 length = readBundleCount(ctx, bundle);
 	if (length == 0)
 		return;
 
 	int16 *dest = (int16 *) bundle.curDec;
 
-	int32 v = video.bits->getBits(startBits - (hasSign ? 1 : 0));
+	int32 v = ctx.bits->getBits(startBits - (hasSign ? 1 : 0));
 	if (v && hasSign) {
-		int sign = -(int)video.bits->getBit();
+		int sign = -(int)ctx.bits->getBit();
 		v = (v ^ sign) - sign;
 	}
 
@@ -1185,14 +1238,14 @@ void BinkDecoder::readDCS(VideoFrame &video, Bundle &bundle, int startBits, bool
 	for (uint32 i = 0; i < length; i += 8) {
 		uint32 length2 = MIN<uint32>(length - i, 8);
 
-		byte bSize = video.bits->getBits(4);
+		byte bSize = ctx.bits->getBits(4);
 
 		if (bSize) {
 
 			for (uint32 j = 0; j < length2; j++) {
-				int16 v2 = video.bits->getBits(bSize);
+				int16 v2 = ctx.bits->getBits(bSize);
 				if (v2) {
-					int sign = -(int)video.bits->getBit();
+					int sign = -(int)ctx.bits->getBit();
 					v2 = (v2 ^ sign) - sign;
 				}
 
@@ -1212,7 +1265,7 @@ void BinkDecoder::readDCS(VideoFrame &video, Bundle &bundle, int startBits, bool
 }
 
 /** Reads 8x8 block of DCT coefficients. */
-void BinkDecoder::readDCTCoeffs(VideoFrame &video, int16 *block, bool isIntra) {
+void BinkDecoder::readDCTCoeffs(DecodeContext &ctx, int16 *block, bool isIntra) {
 	int coefCount = 0;
 	int coefIdx[64];
 
@@ -1227,13 +1280,13 @@ void BinkDecoder::readDCTCoeffs(VideoFrame &video, int16 *block, bool isIntra) {
 	coefList[listEnd] = 2;  modeList[listEnd++] = 3;
 	coefList[listEnd] = 3;  modeList[listEnd++] = 3;
 
-	int bits = video.bits->getBits(4) - 1;
+	int bits = ctx.bits->getBits(4) - 1;
 	for (int mask = 1 << bits; bits >= 0; mask >>= 1, bits--) {
 		int listPos = listStart;
 
 		while (listPos < listEnd) {
 
-			if (!(modeList[listPos] | coefList[listPos]) || !video.bits->getBit()) {
+			if (!(modeList[listPos] | coefList[listPos]) || !ctx.bits->getBit()) {
 				listPos++;
 				continue;
 			}
@@ -1251,17 +1304,17 @@ void BinkDecoder::readDCTCoeffs(VideoFrame &video, int16 *block, bool isIntra) {
 					modeList[listPos++] = 0;
 				}
 				for (int i = 0; i < 4; i++, ccoef++) {
-					if (video.bits->getBit()) {
+					if (ctx.bits->getBit()) {
 						coefList[--listStart] = ccoef;
 						modeList[  listStart] = 3;
 					} else {
 						int t;
 						if (!bits) {
-							t = 1 - (video.bits->getBit() << 1);
+							t = 1 - (ctx.bits->getBit() << 1);
 						} else {
-							t = video.bits->getBits(bits) | mask;
+							t = ctx.bits->getBits(bits) | mask;
 
-							int sign = -(int)video.bits->getBit();
+							int sign = -(int)ctx.bits->getBit();
 							t = (t ^ sign) - sign;
 						}
 						block[binkScan[ccoef]] = t;
@@ -1282,11 +1335,11 @@ void BinkDecoder::readDCTCoeffs(VideoFrame &video, int16 *block, bool isIntra) {
 			case 3:
 				int t;
 				if (!bits) {
-					t = 1 - (video.bits->getBit() << 1);
+					t = 1 - (ctx.bits->getBit() << 1);
 				} else {
-					t = video.bits->getBits(bits) | mask;
+					t = ctx.bits->getBits(bits) | mask;
 
-					int sign = -(int)video.bits->getBit();
+					int sign = -(int)ctx.bits->getBit();
 					t = (t ^ sign) - sign;
 				}
 				block[binkScan[ccoef]] = t;
@@ -1298,7 +1351,7 @@ void BinkDecoder::readDCTCoeffs(VideoFrame &video, int16 *block, bool isIntra) {
 		}
 	}
 
-	uint8 quantIdx = video.bits->getBits(4);
+	uint8 quantIdx = ctx.bits->getBits(4);
 	const uint32 *quant = isIntra ? binkIntraQuant[quantIdx] : binkInterQuant[quantIdx];
 	block[0] = (block[0] * quant[0]) >> 11;
 
@@ -1310,7 +1363,7 @@ void BinkDecoder::readDCTCoeffs(VideoFrame &video, int16 *block, bool isIntra) {
 }
 
 /** Reads 8x8 block with residue after motion compensation. */
-void BinkDecoder::readResidue(VideoFrame &video, int16 *block, int masksCount) {
+void BinkDecoder::readResidue(DecodeContext &ctx, int16 *block, int masksCount) {
 	int nzCoeff[64];
 	int nzCoeffCount = 0;
 
@@ -1323,10 +1376,10 @@ void BinkDecoder::readResidue(VideoFrame &video, int16 *block, int masksCount) {
 	coefList[listEnd] = 44; modeList[listEnd++] = 0;
 	coefList[listEnd] =  0; modeList[listEnd++] = 2;
 
-	for (int mask = 1 << video.bits->getBits(3); mask; mask >>= 1) {
+	for (int mask = 1 << ctx.bits->getBits(3); mask; mask >>= 1) {
 
 		for (int i = 0; i < nzCoeffCount; i++) {
-			if (!video.bits->getBit())
+			if (!ctx.bits->getBit())
 				continue;
 			if (block[nzCoeff[i]] < 0)
 				block[nzCoeff[i]] -= mask;
@@ -1340,7 +1393,7 @@ void BinkDecoder::readResidue(VideoFrame &video, int16 *block, int masksCount) {
 		int listPos = listStart;
 		while (listPos < listEnd) {
 
-			if (!(coefList[listPos] | modeList[listPos]) || !video.bits->getBit()) {
+			if (!(coefList[listPos] | modeList[listPos]) || !ctx.bits->getBit()) {
 				listPos++;
 				continue;
 			}
@@ -1359,13 +1412,13 @@ void BinkDecoder::readResidue(VideoFrame &video, int16 *block, int masksCount) {
 				}
 
 				for (int i = 0; i < 4; i++, ccoef++) {
-					if (video.bits->getBit()) {
+					if (ctx.bits->getBit()) {
 						coefList[--listStart] = ccoef;
 						modeList[  listStart] = 3;
 					} else {
 						nzCoeff[nzCoeffCount++] = binkScan[ccoef];
 
-						int sign = -(int)video.bits->getBit();
+						int sign = -(int)ctx.bits->getBit();
 						block[binkScan[ccoef]] = (mask ^ sign) - sign;
 
 						masksCount--;
@@ -1387,7 +1440,7 @@ void BinkDecoder::readResidue(VideoFrame &video, int16 *block, int masksCount) {
 			case 3:
 				nzCoeff[nzCoeffCount++] = binkScan[ccoef];
 
-				int sign = -(int)video.bits->getBit();
+				int sign = -(int)ctx.bits->getBit();
 				block[binkScan[ccoef]] = (mask ^ sign) - sign;
 
 				coefList[listPos]   = 0;
@@ -1593,6 +1646,236 @@ void BinkDecoder::floatToInt16Interleave(int16 *dst, const float **src, uint32 l
 #define MUNGE_ROW(x) (((x) + 0x7F)>>8)
 #define IDCT_ROW(dest,src) IDCT_TRANSFORM(dest,0,1,2,3,4,5,6,7,0,1,2,3,4,5,6,7,MUNGE_ROW,src)
 
+#if defined(BINK_IDCT_SSE2)
+
+// madd of s0, s1 interleaved with the constant pair (c0, c1): s0 * c0 + s1 * c1
+// for 4 columns, exactly in 32 bits
+static inline __m128i IDCTMadd(__m128i pair, int16 c0, int16 c1) {
+	return _mm_madd_epi16(pair, _mm_set_epi16(c1, c0, c1, c0, c1, c0, c1, c0));
+}
+
+// IDCT_TRANSFORM on 4 columns at once, the inputs being int16 and
+// interleaved in pairs: (s0, s4), (s2, s6), (s5, s3) and (s1, s7)
+static inline void IDCTTransform4(__m128i *d, __m128i p04, __m128i p26, __m128i p53, __m128i p17) {
+	const __m128i a0 = IDCTMadd(p04, 1, 1);
+	const __m128i a1 = IDCTMadd(p04, 1, -1);
+	const __m128i a2 = IDCTMadd(p26, 1, 1);
+	const __m128i a3 = _mm_srai_epi32(IDCTMadd(p26, A1, -A1), 11);
+	const __m128i a4 = IDCTMadd(p53, 1, 1);
+	const __m128i a6 = IDCTMadd(p17, 1, 1);
+	const __m128i b0 = _mm_add_epi32(a4, a6);
+	const __m128i b1 = _mm_srai_epi32(_mm_add_epi32(IDCTMadd(p53, A3, -A3), IDCTMadd(p17, A3, -A3)), 11);
+	const __m128i b2 = _mm_add_epi32(_mm_sub_epi32(_mm_srai_epi32(IDCTMadd(p53, A4, -A4), 11), b0), b1);
+	const __m128i b3 = _mm_sub_epi32(_mm_srai_epi32(_mm_add_epi32(IDCTMadd(p17, A1, A1), IDCTMadd(p53, -A1, -A1)), 11), b2);
+	const __m128i b4 = _mm_sub_epi32(_mm_add_epi32(_mm_srai_epi32(IDCTMadd(p17, A2, -A2), 11), b3), b1);
+	const __m128i c0 = _mm_add_epi32(a0, a2);
+	const __m128i c1 = _mm_sub_epi32(_mm_add_epi32(a1, a3), a2);
+	const __m128i c2 = _mm_add_epi32(_mm_sub_epi32(a1, a3), a2);
+	const __m128i c3 = _mm_sub_epi32(a0, a2);
+	d[0] = _mm_add_epi32(c0, b0);
+	d[1] = _mm_add_epi32(c1, b2);
+	d[2] = _mm_add_epi32(c2, b3);
+	d[3] = _mm_sub_epi32(c3, b4);
+	d[4] = _mm_add_epi32(c3, b4);
+	d[5] = _mm_sub_epi32(c2, b3);
+	d[6] = _mm_sub_epi32(c1, b2);
+	d[7] = _mm_sub_epi32(c0, b0);
+}
+
+// Apply the transform down the columns of 8 rows of 8 int16, keeping the low
+// 16 bits of the results
+static inline void IDCTColumns(__m128i *rows, bool munge) {
+	__m128i lo[8], hi[8];
+
+	IDCTTransform4(lo, _mm_unpacklo_epi16(rows[0], rows[4]), _mm_unpacklo_epi16(rows[2], rows[6]),
+	               _mm_unpacklo_epi16(rows[5], rows[3]), _mm_unpacklo_epi16(rows[1], rows[7]));
+	IDCTTransform4(hi, _mm_unpackhi_epi16(rows[0], rows[4]), _mm_unpackhi_epi16(rows[2], rows[6]),
+	               _mm_unpackhi_epi16(rows[5], rows[3]), _mm_unpackhi_epi16(rows[1], rows[7]));
+
+	for (int i = 0; i < 8; i++) {
+		if (munge) {
+			lo[i] = _mm_srai_epi32(_mm_add_epi32(lo[i], _mm_set1_epi32(0x7F)), 8);
+			hi[i] = _mm_srai_epi32(_mm_add_epi32(hi[i], _mm_set1_epi32(0x7F)), 8);
+		}
+		lo[i] = _mm_srai_epi32(_mm_slli_epi32(lo[i], 16), 16);
+		hi[i] = _mm_srai_epi32(_mm_slli_epi32(hi[i], 16), 16);
+		rows[i] = _mm_packs_epi32(lo[i], hi[i]);
+	}
+}
+
+static inline void transpose8x8(__m128i *r) {
+	__m128i a0 = _mm_unpacklo_epi16(r[0], r[1]), a1 = _mm_unpackhi_epi16(r[0], r[1]);
+	__m128i a2 = _mm_unpacklo_epi16(r[2], r[3]), a3 = _mm_unpackhi_epi16(r[2], r[3]);
+	__m128i a4 = _mm_unpacklo_epi16(r[4], r[5]), a5 = _mm_unpackhi_epi16(r[4], r[5]);
+	__m128i a6 = _mm_unpacklo_epi16(r[6], r[7]), a7 = _mm_unpackhi_epi16(r[6], r[7]);
+	__m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+	__m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+	__m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+	__m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+	r[0] = _mm_unpacklo_epi64(b0, b4); r[1] = _mm_unpackhi_epi64(b0, b4);
+	r[2] = _mm_unpacklo_epi64(b1, b5); r[3] = _mm_unpackhi_epi64(b1, b5);
+	r[4] = _mm_unpacklo_epi64(b2, b6); r[5] = _mm_unpackhi_epi64(b2, b6);
+	r[6] = _mm_unpacklo_epi64(b3, b7); r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+// The whole IDCT, the rows of the result being left in rows
+static inline void IDCTRows(__m128i *rows, const int16 *block) {
+	for (int i = 0; i < 8; i++)
+		rows[i] = _mm_loadu_si128((const __m128i *)(block + 8 * i));
+
+	IDCTColumns(rows, false);
+	transpose8x8(rows);
+	IDCTColumns(rows, true);
+	transpose8x8(rows);
+}
+
+void BinkDecoder::IDCT(int16 *block) {
+	__m128i rows[8];
+	IDCTRows(rows, block);
+
+	for (int i = 0; i < 8; i++)
+		_mm_storeu_si128((__m128i *)(block + 8 * i), rows[i]);
+}
+
+void BinkDecoder::IDCTAdd(DecodeContext &ctx, int16 *block) {
+	__m128i rows[8];
+	IDCTRows(rows, block);
+
+	// Only the low 8 bits of the sums are kept, as with the C version
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i mask = _mm_set1_epi16(0xFF);
+	byte *dest = ctx.dest;
+	for (int i = 0; i < 8; i++, dest += ctx.pitch) {
+		__m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)dest), zero);
+		d = _mm_and_si128(_mm_add_epi16(d, rows[i]), mask);
+		_mm_storel_epi64((__m128i *)dest, _mm_packus_epi16(d, zero));
+	}
+}
+
+void BinkDecoder::IDCTPut(DecodeContext &ctx, int16 *block) {
+	__m128i rows[8];
+	IDCTRows(rows, block);
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i mask = _mm_set1_epi16(0xFF);
+	byte *dest = ctx.dest;
+	for (int i = 0; i < 8; i++, dest += ctx.pitch)
+		_mm_storel_epi64((__m128i *)dest, _mm_packus_epi16(_mm_and_si128(rows[i], mask), zero));
+}
+
+#elif defined(BINK_IDCT_NEON)
+
+// IDCT_TRANSFORM on 4 lanes at once, s being the 8 inputs
+static inline void IDCTTransform4(int32x4_t *d, const int32x4_t *s) {
+	const int32x4_t a0 = vaddq_s32(s[0], s[4]);
+	const int32x4_t a1 = vsubq_s32(s[0], s[4]);
+	const int32x4_t a2 = vaddq_s32(s[2], s[6]);
+	const int32x4_t a3 = vshrq_n_s32(vmulq_n_s32(vsubq_s32(s[2], s[6]), A1), 11);
+	const int32x4_t a4 = vaddq_s32(s[5], s[3]);
+	const int32x4_t a5 = vsubq_s32(s[5], s[3]);
+	const int32x4_t a6 = vaddq_s32(s[1], s[7]);
+	const int32x4_t a7 = vsubq_s32(s[1], s[7]);
+	const int32x4_t b0 = vaddq_s32(a4, a6);
+	const int32x4_t b1 = vshrq_n_s32(vmulq_n_s32(vaddq_s32(a5, a7), A3), 11);
+	const int32x4_t b2 = vaddq_s32(vsubq_s32(vshrq_n_s32(vmulq_n_s32(a5, A4), 11), b0), b1);
+	const int32x4_t b3 = vsubq_s32(vshrq_n_s32(vmulq_n_s32(vsubq_s32(a6, a4), A1), 11), b2);
+	const int32x4_t b4 = vsubq_s32(vaddq_s32(vshrq_n_s32(vmulq_n_s32(a7, A2), 11), b3), b1);
+	const int32x4_t c0 = vaddq_s32(a0, a2);
+	const int32x4_t c1 = vsubq_s32(vaddq_s32(a1, a3), a2);
+	const int32x4_t c2 = vaddq_s32(vsubq_s32(a1, a3), a2);
+	const int32x4_t c3 = vsubq_s32(a0, a2);
+	d[0] = vaddq_s32(c0, b0);
+	d[1] = vaddq_s32(c1, b2);
+	d[2] = vaddq_s32(c2, b3);
+	d[3] = vsubq_s32(c3, b4);
+	d[4] = vaddq_s32(c3, b4);
+	d[5] = vsubq_s32(c2, b3);
+	d[6] = vsubq_s32(c1, b2);
+	d[7] = vsubq_s32(c0, b0);
+}
+
+// Apply the transform down the columns of 8 rows of 8 int16, keeping the low
+// 16 bits of the results
+static inline void IDCTColumns(int16x8_t *rows, bool munge) {
+	int32x4_t s[8], lo[8], hi[8];
+
+	for (int i = 0; i < 8; i++)
+		s[i] = vmovl_s16(vget_low_s16(rows[i]));
+	IDCTTransform4(lo, s);
+	for (int i = 0; i < 8; i++)
+		s[i] = vmovl_s16(vget_high_s16(rows[i]));
+	IDCTTransform4(hi, s);
+
+	for (int i = 0; i < 8; i++) {
+		if (munge) {
+			lo[i] = vshrq_n_s32(vaddq_s32(lo[i], vdupq_n_s32(0x7F)), 8);
+			hi[i] = vshrq_n_s32(vaddq_s32(hi[i], vdupq_n_s32(0x7F)), 8);
+		}
+		rows[i] = vcombine_s16(vmovn_s32(lo[i]), vmovn_s32(hi[i]));
+	}
+}
+
+static inline void transpose8x8(int16x8_t *r) {
+	int16x8x2_t t01 = vtrnq_s16(r[0], r[1]);
+	int16x8x2_t t23 = vtrnq_s16(r[2], r[3]);
+	int16x8x2_t t45 = vtrnq_s16(r[4], r[5]);
+	int16x8x2_t t67 = vtrnq_s16(r[6], r[7]);
+	int32x4x2_t u02 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[0]), vreinterpretq_s32_s16(t23.val[0]));
+	int32x4x2_t u13 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[1]), vreinterpretq_s32_s16(t23.val[1]));
+	int32x4x2_t u46 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[0]), vreinterpretq_s32_s16(t67.val[0]));
+	int32x4x2_t u57 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[1]), vreinterpretq_s32_s16(t67.val[1]));
+	r[0] = vcombine_s16(vget_low_s16(vreinterpretq_s16_s32(u02.val[0])), vget_low_s16(vreinterpretq_s16_s32(u46.val[0])));
+	r[1] = vcombine_s16(vget_low_s16(vreinterpretq_s16_s32(u13.val[0])), vget_low_s16(vreinterpretq_s16_s32(u57.val[0])));
+	r[2] = vcombine_s16(vget_low_s16(vreinterpretq_s16_s32(u02.val[1])), vget_low_s16(vreinterpretq_s16_s32(u46.val[1])));
+	r[3] = vcombine_s16(vget_low_s16(vreinterpretq_s16_s32(u13.val[1])), vget_low_s16(vreinterpretq_s16_s32(u57.val[1])));
+	r[4] = vcombine_s16(vget_high_s16(vreinterpretq_s16_s32(u02.val[0])), vget_high_s16(vreinterpretq_s16_s32(u46.val[0])));
+	r[5] = vcombine_s16(vget_high_s16(vreinterpretq_s16_s32(u13.val[0])), vget_high_s16(vreinterpretq_s16_s32(u57.val[0])));
+	r[6] = vcombine_s16(vget_high_s16(vreinterpretq_s16_s32(u02.val[1])), vget_high_s16(vreinterpretq_s16_s32(u46.val[1])));
+	r[7] = vcombine_s16(vget_high_s16(vreinterpretq_s16_s32(u13.val[1])), vget_high_s16(vreinterpretq_s16_s32(u57.val[1])));
+}
+
+// The whole IDCT, the rows of the result being left in rows
+static inline void IDCTRows(int16x8_t *rows, const int16 *block) {
+	for (int i = 0; i < 8; i++)
+		rows[i] = vld1q_s16(block + 8 * i);
+
+	IDCTColumns(rows, false);
+	transpose8x8(rows);
+	IDCTColumns(rows, true);
+	transpose8x8(rows);
+}
+
+void BinkDecoder::IDCT(int16 *block) {
+	int16x8_t rows[8];
+	IDCTRows(rows, block);
+
+	for (int i = 0; i < 8; i++)
+		vst1q_s16(block + 8 * i, rows[i]);
+}
+
+void BinkDecoder::IDCTAdd(DecodeContext &ctx, int16 *block) {
+	int16x8_t rows[8];
+	IDCTRows(rows, block);
+
+	// Only the low 8 bits of the sums are kept, as with the C version
+	byte *dest = ctx.dest;
+	for (int i = 0; i < 8; i++, dest += ctx.pitch) {
+		int16x8_t d = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(dest)));
+		vst1_u8(dest, vmovn_u16(vreinterpretq_u16_s16(vaddq_s16(d, rows[i]))));
+	}
+}
+
+void BinkDecoder::IDCTPut(DecodeContext &ctx, int16 *block) {
+	int16x8_t rows[8];
+	IDCTRows(rows, block);
+
+	byte *dest = ctx.dest;
+	for (int i = 0; i < 8; i++, dest += ctx.pitch)
+		vst1_u8(dest, vmovn_u16(vreinterpretq_u16_s16(rows[i])));
+}
+
+#else
+
 static inline void IDCTCol(int16 *dest, const int16 *src)
 {
 	if ((src[8] | src[16] | src[24] | src[32] | src[40] | src[48] | src[56]) == 0) {
@@ -1640,4 +1923,6 @@ void BinkDecoder::IDCTPut(DecodeContext &ctx, int16 *block) {
 	}
 }
 
+#endif
+
 } // End of namespace Video
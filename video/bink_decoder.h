@@ -34,14 +34,15 @@
 #include "audio/audiostream.h"
 #include "audio/mixer.h"
 #include "common/array.h"
+#include "common/bitstream.h"
 #include "common/rational.h"
 
 #include "video/video_decoder.h"
 
 namespace Common {
 	class SeekableReadStream;
-	class BitStream;
 	class Huffman;
+	class WorkerPool;
 
 	class RDFT;
 	class DCT;
@@ -74,6 +75,13 @@ public:
 	// FixedRateVideoDecoder
 	Common::Rational getFrameRate() const { return _frameRate; }
 
+	/**
+	 * Set the number of threads decoding the frames, the calling one
+	 * included. With more than one, each frame is converted to RGB by slices
+	 * in parallel.
+	 */
+	void setThreadCount(int numThreads);
+
 private:
 	static const int kAudioChannelsMax  = 2;
 	static const int kAudioBlockSizeMax = (kAudioChannelsMax << 11);
@@ -146,7 +154,7 @@ private:
 
 		uint32 sampleCount;
 
-		Common::BitStream *bits;
+		Common::BitReaderLE *bits;
 
 		bool first;
 
@@ -179,7 +187,7 @@ private:
 		uint32 offset;
 		uint32 size;
 
-		Common::BitStream *bits;
+		Common::BitReaderLE *bits;
 
 		VideoFrame();
 		~VideoFrame();
@@ -187,7 +195,13 @@ private:
 
 	/** A decoder state. */
 	struct DecodeContext {
-		VideoFrame *video;
+		Common::BitReaderLE *bits; ///< The bits of the plane.
+		Bundle *bundles;           ///< The bundles of the plane, one for each data type.
+
+		/** Huffman codebooks to use for decoding high nibbles in color data types. */
+		Huffman colHighHuffman[16];
+		/** Value of the last decoded high nibble in color data types. */
+		int colLastVal;
 
 		uint32 planeIdx;
 
@@ -210,6 +224,7 @@ private:
 	};
 
 	Common::SeekableReadStream *_bink;
+	Common::Array<byte> _packet; ///< The packet being decoded.
 
 	uint32 _id; ///< The BIK FourCC.
 
@@ -237,14 +252,10 @@ private:
 
 	Bundle _bundles[kSourceMAX]; ///< Bundles for decoding all data types.
 
-	/** Huffman codebooks to use for decoding high nibbles in color data types. */
-	Huffman _colHighHuffman[16];
-	/** Value of the last decoded high nibble in color data types. */
-	int _colLastVal;
-
 	byte *_curPlanes[4]; ///< The 4 color planes, YUVA, current frame.
 	byte *_oldPlanes[4]; ///< The 4 color planes, YUVA, last frame.
 
+	Common::WorkerPool *_threadPool; ///< Helper threads, or 0 if decoding on the calling thread only.
 
 	/** Initialize the bundles. */
 	void initBundles();
@@ -254,29 +265,37 @@ private:
 	/** Initialize the Huffman decoders. */
 	void initHuffman();
 
+	/** Read the next size bytes of the file into _packet. */
+	const byte *readPacket(uint32 size);
+
 	/** Decode an audio packet. */
 	void audioPacket(AudioTrack &audio);
 	/** Decode a video packet. */
 	void videoPacket(VideoFrame &video);
 
 	/** Decode a plane. */
-	void decodePlane(VideoFrame &video, int planeIdx, bool isChroma);
+	void decodePlane(Common::BitReaderLE *bits, int planeIdx, bool isChroma);
+
+	/** Convert the current planes to RGB into _surface. */
+	void convertPlanes();
+	/** Convert one slice of the current planes, for the thread pool. */
+	static void convertSlice(void *param, int slice);
 
 	/** Read/Initialize a bundle for decoding a plane. */
-	void readBundle(VideoFrame &video, Source source);
+	void readBundle(DecodeContext &ctx, Source source);
 
 	/** Read the symbols for a Huffman code. */
-	void readHuffman(VideoFrame &video, Huffman &huffman);
+	void readHuffman(DecodeContext &ctx, Huffman &huffman);
 	/** Merge two Huffman symbol lists. */
-	void mergeHuffmanSymbols(VideoFrame &video, byte *dst, const byte *src, int size);
+	void mergeHuffmanSymbols(DecodeContext &ctx, byte *dst, const byte *src, int size);
 
 	/** Read and translate a symbol out of a Huffman code. */
-	byte getHuffmanSymbol(VideoFrame &video, Huffman &huffman);
+	byte getHuffmanSymbol(DecodeContext &ctx, Huffman &huffman);
 
 	/** Get a direct value out of a bundle. */
-	int32 getBundleValue(Source source);
+	int32 getBundleValue(DecodeContext &ctx, Source source);
 	/** Read a count value out of a bundle. */
-	uint32 readBundleCount(VideoFrame &video, Bundle &bundle);
+	uint32 readBundleCount(DecodeContext &ctx, Bundle &bundle);
 
 	// Handle the block types
 	void blockSkip         (DecodeContext &ctx);
@@ -297,14 +316,14 @@ private:
 	void blockRaw          (DecodeContext &ctx);
 
 	// Read the bundles
-	void readRuns        (VideoFrame &video, Bundle &bundle);
-	void readMotionValues(VideoFrame &video, Bundle &bundle);
-	void readBlockTypes  (VideoFrame &video, Bundle &bundle);
-	void readPatterns    (VideoFrame &video, Bundle &bundle);
-	void readColors      (VideoFrame &video, Bundle &bundle);
-	void readDCS         (VideoFrame &video, Bundle &bundle, int startBits, bool hasSign);
-	void readDCTCoeffs   (VideoFrame &video, int16 *block, bool isIntra);
-	void readResidue     (VideoFrame &video, int16 *block, int masksCount);
+	void readRuns        (DecodeContext &ctx, Bundle &bundle);
+	void readMotionValues(DecodeContext &ctx, Bundle &bundle);
+	void readBlockTypes  (DecodeContext &ctx, Bundle &bundle);
+	void readPatterns    (DecodeContext &ctx, Bundle &bundle);
+	void readColors      (DecodeContext &ctx, Bundle &bundle);
+	void readDCS         (DecodeContext &ctx, Bundle &bundle, int startBits, bool hasSign);
+	void readDCTCoeffs   (DecodeContext &ctx, int16 *block, bool isIntra);
+	void readResidue     (DecodeContext &ctx, int16 *block, int masksCount);
 
 	void initAudioTrack(AudioTrack &audio);
 